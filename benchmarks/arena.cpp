@@ -0,0 +1,45 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "benchmarks/bench.hpp"
+#include "parser/arena.hpp"
+#include "parser/parser.hpp"
+#include "shared/errors.hpp"
+
+/*
+ * parse and teardown time of a large generated program, whose tree is freed by clearing the node arena ( see
+ * parser/arena.hpp ), and the most memory the process had resident while it was parsed
+ */
+
+const size_t RUNS = 3;
+
+int main( int argc, char* argv[] ) {
+  std::string program = generateProgram( argumentCount( argc, argv, 50000 ) );
+  std::string path = writeProgram( "arena", program );
+  double resident = peakResidentMegabytes();
+
+  std::cout << "input:     " << program.length() / 1e6 << " MB" << std::endl;
+
+  for ( size_t run = 0; run < RUNS; run++ ) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Node* root = parse( path );
+    double parsing = secondsSince( start );
+    size_t bytes = nodeArena.size();
+
+    if ( !root ) {
+      printErrors();
+      return 1;
+    }
+
+    start = std::chrono::steady_clock::now();
+    nodeArena.clear();
+
+    std::cout << "run " << run + 1 << ":     parse " << parsing * 1e3 << " ms, teardown " << secondsSince( start ) * 1e3
+              << " ms, " << bytes / 1e6 << " MB of nodes" << std::endl;
+  }
+
+  std::cout << "peak RSS:  " << peakResidentMegabytes() << " MB, " << resident << " MB before parsing" << std::endl;
+
+  return 0;
+}
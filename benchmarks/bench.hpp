@@ -0,0 +1,68 @@
+#ifndef _BENCH_HPP
+#define _BENCH_HPP
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <sys/resource.h>
+
+/*
+ * what the benchmarks share: a large generated program that is valid kubic, written out to be loaded as a source,
+ * and the clock and memory figures they report
+ */
+
+/* _bindings bindings of arithmetic, each read by the next and branched on, the way a long script is written */
+std::string generateProgram( const size_t _bindings ) {
+  std::string program = "define x0 :: integer = 1\n\n";
+
+  for ( size_t index = 1; index < _bindings; index++ ) {
+    std::string name = "x" + std::to_string( index );
+    std::string flag = "b" + std::to_string( index );
+    std::string previous = "x" + std::to_string( index - 1 );
+    std::string number = std::to_string( index % 1000 );
+
+    program += "define " + name + " :: integer = " + number + " * 3 + ( " + previous + " - 7 ) / 2\n";
+    program += "define " + flag + " :: boolean = " + name + " > " + number + "\n";
+    program += "if ( " + flag + " ) {\n";
+    program += "  print( " + name + " * 0x1f )\n";
+    program += "} elif ( " + name + " == " + number + " ) {\n";
+    program += "  print( " + name + " - 1 )\n";
+    program += "} else {\n";
+    program += "  print( " + name + " )\n";
+    program += "}\n\n";
+  }
+
+  return program;
+}
+
+/* writes _program to the temporary directory, returning its path */
+std::string writeProgram( const std::string& _name, const std::string& _program ) {
+  std::string path = ( std::filesystem::temp_directory_path() / ( _name + ".kbc" ) ).string();
+  std::ofstream file( path, std::ios::binary );
+
+  file << _program;
+
+  return path;
+}
+
+/* the count the benchmark was given as its first argument, _default without one */
+size_t argumentCount( const int _argc, char* _argv[], const size_t _default ) {
+  return _argc > 1 ? std::strtoull( _argv[1], nullptr, 10 ) : _default;
+}
+
+double secondsSince( const std::chrono::steady_clock::time_point _start ) {
+  return std::chrono::duration<double>( std::chrono::steady_clock::now() - _start ).count();
+}
+
+/* the most memory the process has had resident so far */
+double peakResidentMegabytes() {
+  struct rusage usage;
+
+  getrusage( RUSAGE_SELF, &usage );
+
+  return static_cast<double>( usage.ru_maxrss ) / 1024;
+}
+
+#endif
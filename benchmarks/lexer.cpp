@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <string>
+#include <string_view>
+
+#include "benchmarks/bench.hpp"
+#include "parser/lexer.hpp"
+
+/*
+ * lexer throughput in MB/s over a large generated program, and the speedup of classifying its characters through
+ * the table and vectorized scans ( see parser/charclass.hpp ) over the std::set<char> lookups the lexer made for
+ * every character before, both splitting the same text into the same words
+ */
+
+const size_t RUNS = 5;
+
+const std::set<char> SET_WHITESPACES = { ' ', '\t' };
+
+const std::set<char> SET_OPERATORS = { ':', '\\', '&', '|', '^', '!', '=', '>', '<', '%', '+', '-', '*', '/' };
+
+const std::set<char> SET_ARITHMETIC_GROUPERS = { '(', ')' };
+
+const std::set<char> SET_STATEMENT_GROUPERS = { '{', '}' };
+
+/* words in _text, each character looked up in every set in turn as the lexer did */
+size_t splitBySets( const std::string_view _text ) {
+  size_t words = 0;
+  bool inWord = false;
+
+  for ( char c : _text ) {
+    bool delimiter = SET_WHITESPACES.count( c ) || SET_OPERATORS.count( c ) || SET_ARITHMETIC_GROUPERS.count( c ) ||
+                     SET_STATEMENT_GROUPERS.count( c ) || c == '\n' || c == ',';
+
+    if ( !delimiter && !inWord ) words++;
+
+    inWord = !delimiter;
+  }
+
+  return words;
+}
+
+size_t splitByTable( const std::string_view _text ) {
+  const char* current = _text.data();
+  const char* end = current + _text.length();
+  size_t words = 0;
+
+  while ( ( current = skipWhitespace( current, end ) ) < end ) {
+    if ( hasCharClass( *current, CHAR_DELIMITER ) ) {
+      current++;
+    } else {
+      current = scanWord( current, end );
+      words++;
+    }
+  }
+
+  return words;
+}
+
+size_t lex( const SourceFile* _source ) {
+  Lexer lexer( _source );
+  Token token;
+  size_t tokens = 0;
+
+  while ( lexer.next( token ) ) {
+    tokens++;
+  }
+
+  return tokens;
+}
+
+/* the best MB/s over RUNS runs of _run over _bytes bytes, with the count the last run returned */
+template<typename Run>
+double throughput( const size_t _bytes, size_t& _count, Run _run ) {
+  double best = 0;
+
+  for ( size_t run = 0; run < RUNS; run++ ) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    _count = _run();
+    best = std::max( best, static_cast<double>( _bytes ) / 1e6 / secondsSince( start ) );
+  }
+
+  return best;
+}
+
+int main( int argc, char* argv[] ) {
+  std::string program = generateProgram( argumentCount( argc, argv, 160000 ) );
+  const SourceFile* source = sourceManager.load( writeProgram( "lexer", program ) );
+  std::string_view content = source->getContent();
+  size_t tokens;
+  size_t tableWords;
+  size_t setWords;
+
+  double lexer = throughput( content.length(), tokens, [ source ]() { return lex( source ); } );
+  double table = throughput( content.length(), tableWords, [ content ]() { return splitByTable( content ); } );
+  double sets = throughput( content.length(), setWords, [ content ]() { return splitBySets( content ); } );
+
+  std::cout << "input:          " << content.length() / 1e6 << " MB, " << tokens << " tokens" << std::endl;
+  std::cout << "lexer:          " << lexer << " MB/s" << std::endl;
+  std::cout << "table split:    " << table << " MB/s, " << tableWords << " words" << std::endl;
+  std::cout << "std::set split: " << sets << " MB/s, " << setWords << " words" << std::endl;
+  std::cout << "speedup:        " << table / sets << "x" << std::endl;
+
+  return tableWords == setWords ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+#include <deque>
+#include <iostream>
+#include <malloc.h>
+#include <string>
+#include <string_view>
+
+#include "benchmarks/bench.hpp"
+#include "parser/lexer.hpp"
+#include "parser/tokenbuffer.hpp"
+
+/*
+ * bytes per token of the tokens of a large generated program, as TokenBuffer stores them ( see
+ * parser/tokenbuffer.hpp ) and as tokens were held before it, each a value in a deque with a position that copied
+ * its filename; the heap is measured as malloc counts it, so the room it keeps for each allocation is counted too
+ */
+
+/* bytes malloc has handed out and not had back, with what it keeps alongside each allocation */
+size_t heapInUse() {
+  struct mallinfo2 info = mallinfo2();
+
+  return info.uordblks + info.hblkhd;
+}
+
+/* a token as it was before TokenBuffer, text viewing into its source and a position holding its own filename */
+struct PositionedToken {
+  std::string_view text;
+  TokenType type;
+  unsigned int line;
+  unsigned int column;
+  std::string filename;
+};
+
+/* the heap what _build builds is left holding, per token of _tokens */
+template<typename Build>
+double bytesPerToken( const size_t _tokens, Build _build ) {
+  size_t inUse = heapInUse();
+
+  _build();
+
+  return static_cast<double>( heapInUse() - inUse ) / static_cast<double>( _tokens );
+}
+
+int main( int argc, char* argv[] ) {
+  std::string program = generateProgram( argumentCount( argc, argv, 40000 ) );
+  const SourceFile* source = sourceManager.load( writeProgram( "tokenbuffer", program ) );
+  std::deque<PositionedToken> positioned;
+  TokenBuffer buffer;
+  TokenBuffer held;
+  size_t tokens = 0;
+  size_t constants = 0;
+  Token token;
+
+  for ( Lexer lexer( source ); lexer.next( token ); tokens++ ) {
+    constants += token.getType() == TokenType::TokenConstant;
+  }
+
+  double before = bytesPerToken( tokens, [ source, &positioned ]() {
+    Lexer lexer( source );
+    Token token;
+
+    /* lines and columns are not tracked, only the room they took matters */
+    while ( lexer.next( token ) ) {
+      positioned.push_back( { token.getText(), token.getType(), 0, 0, source->getFilename() } );
+    }
+  } );
+
+  double allocated = bytesPerToken( tokens, [ source, &buffer ]() {
+    Lexer lexer( source );
+    Token token;
+
+    while ( lexer.next( token ) ) {
+      buffer.push( token );
+    }
+  } );
+
+  /* a copy has its arrays sized to what they hold, without the room left to grow */
+  double stored = bytesPerToken( tokens, [ &buffer, &held ]() { held = buffer; } );
+
+  std::cout << "tokens:                 " << tokens << ", " << constants << " numeric literals" << std::endl;
+  std::cout << "before:                 " << before << " bytes per token" << std::endl;
+  std::cout << "TokenBuffer:            " << allocated << " bytes per token" << std::endl;
+  std::cout << "TokenBuffer, no growth: " << stored << " bytes per token" << std::endl;
+
+  return 0;
+}
@@ -1,10 +1,15 @@
 #ifndef _ASSEMBLY_HPP
 #define _ASSEMBLY_HPP
 
+#include <array>
 #include <boost/format.hpp>
+#include <cctype>
+#include <cstdint>
+#include <filesystem>
 #include <iostream>
-#include <map>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "parser/node.hpp"
 
@@ -12,31 +17,124 @@ const std::string ASM_FALSE = "0x7FFFFFFFFFFFFFFF";
 
 const std::string ASM_TRUE = "0xFFFFFFFFFFFFFFFF";
 
+/* the same words as the generated code holds them */
+const int64_t WORD_FALSE = INT64_MAX;
+
+const int64_t WORD_TRUE = -1;
+
 enum Register {
   RAX, RBX, RCX, RDX,
 
   RSI, RDI,
 
   RSP, RBP,
+
+  R8, R9, R10, R11, R12, R13, R14, R15,
 };
 
-const std::map<Register, std::string> REGISTER_MAP = {
-  { Register::RAX, "rax" }, { Register::RBX, "rbx" }, { Register::RCX, "rcx" }, { Register::RDX, "rdx" },
+const std::array<std::string, 16> REGISTER_NAMES = {
+  "rax", "rbx", "rcx", "rdx",
 
-  { Register::RSI, "rsi" }, { Register::RDI, "rdi" },
+  "rsi", "rdi",
 
-  { Register::RSP, "rsp" }, { Register::RBP, "rbp" },
+  "rsp", "rbp",
+
+  "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15",
 };
 
-const std::map<std::string, std::string> BINARY_OPERATOR_ASM = {
-  { "+", "add" }, { "-", "sub" }, { "*", "imul" }, { "/", "idiv" },
-  { "<", "jl" }, { ">", "jg" }, { "<=", "jle" }, { ">=", "jge" },
-  { "&&", "and" }, { "||", "or" }, { "^", "xor" }, { "!", "not" },
-  { "==", "je" }, { "!=", "jne" },
+/* integer arguments of a call in order, as the System V ABI passes them; any further ones go on the stack */
+const std::array<Register, 6> ARGUMENT_REGISTERS = {
+  Register::RDI, Register::RSI, Register::RDX, Register::RCX, Register::R8, Register::R9,
 };
 
+/* instruction a binary operator other than a comparison compiles to */
+constexpr const char* binaryOperatorAsm( const OperatorId _operator ) {
+  switch ( _operator ) {
+    case OperatorId::OperatorAdd:
+      return "add";
+    case OperatorId::OperatorSubtract:
+      return "sub";
+    case OperatorId::OperatorMultiply:
+      return "imul";
+    case OperatorId::OperatorDivide:
+      return "idiv";
+    case OperatorId::OperatorAnd:
+      return "and";
+    case OperatorId::OperatorOr:
+      return "or";
+    case OperatorId::OperatorXor:
+      return "xor";
+    case OperatorId::OperatorNot:
+      return "not";
+    default:
+      return "";
+  }
+}
+
+/* whether _operator compares two integers, rather than computing a word from them */
+constexpr bool isComparison( const OperatorId _operator ) {
+  switch ( _operator ) {
+    case OperatorId::OperatorLess:
+    case OperatorId::OperatorGreater:
+    case OperatorId::OperatorLessEqual:
+    case OperatorId::OperatorGreaterEqual:
+    case OperatorId::OperatorEqual:
+    case OperatorId::OperatorNotEqual:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/* condition code under which a comparison holds, as jcc, setcc and cmovcc are suffixed with it */
+constexpr const char* conditionCode( const OperatorId _operator ) {
+  switch ( _operator ) {
+    case OperatorId::OperatorLess:
+      return "l";
+    case OperatorId::OperatorGreater:
+      return "g";
+    case OperatorId::OperatorLessEqual:
+      return "le";
+    case OperatorId::OperatorGreaterEqual:
+      return "ge";
+    case OperatorId::OperatorEqual:
+      return "e";
+    case OperatorId::OperatorNotEqual:
+      return "ne";
+    default:
+      return "";
+  }
+}
+
+/* the condition code that holds exactly when _condition does not, empty for anything else */
+std::string invertedCondition( const std::string& _condition ) {
+  const std::array<std::pair<const char*, const char*>, 8> inverses = { {
+    { "e", "ne" }, { "ne", "e" }, { "l", "ge" }, { "ge", "l" }, { "g", "le" }, { "le", "g" },
+    { "s", "ns" }, { "ns", "s" },
+  } };
+
+  for ( const std::pair<const char*, const char*>& inverse : inverses ) {
+    if ( _condition == inverse.first ) return inverse.second;
+  }
+
+  return "";
+}
+
+/* the condition code that holds for b and a exactly when _condition holds for a and b */
+std::string swappedCondition( const std::string& _condition ) {
+  const std::array<std::pair<const char*, const char*>, 4> swaps = { {
+    { "l", "g" }, { "g", "l" }, { "le", "ge" }, { "ge", "le" },
+  } };
+
+  for ( const std::pair<const char*, const char*>& swap : swaps ) {
+    if ( _condition == swap.first ) return swap.second;
+  }
+
+  return _condition;
+}
+
 std::string reg( const Register _register ) {
-  return REGISTER_MAP.at( _register );
+  return REGISTER_NAMES[_register];
 }
 
 std::string regOffset( const Register _register, const signed int _offset ) {
@@ -47,72 +145,141 @@ std::string regOffset( const Register _register, const signed int _offset ) {
   }
 }
 
-std::string insn( const std::string _operator, const Register _register, const std::string _src ) {
-  return ( boost::format( "  %1% qword %2%, %3%\n" ) % _operator % reg( _register ) % _src ).str(); 
+/*
+ * one line of a function's code, a label when the mnemonic is empty; code is kept as a list of these until the
+ * peephole pass ( see compiler/peephole.hpp ) has run over it, and only written out as text after
+ */
+struct AsmInstruction {
+  std::string mnemonic;
+  std::string destination;
+  std::string source;
+  /* third operand of the few instructions taking one, such as imul by an immediate */
+  std::string immediate = "";
+};
+
+typedef std::vector<AsmInstruction> AsmCode;
+
+AsmInstruction insn( const std::string _operator, const std::string _dst = "", const std::string _src = "" ) {
+  return { _operator, _dst, _src };
+}
+
+AsmInstruction insn( const std::string _operator, const Register _register, const std::string _src ) {
+  return { _operator, reg( _register ), _src };
 }
 
-std::string insn( const std::string _operator, const std::string _dst, const Register _register ) {
-  return ( boost::format( "  %1% %2%, %3%\n" ) % _operator % _dst % reg( _register ) ).str(); 
+AsmInstruction insn( const std::string _operator, const Register _registerA, const Register _registerB ) {
+  return { _operator, reg( _registerA ), reg( _registerB ) };
 }
 
-std::string insn( const std::string _operator, const Register _registerA, const Register _registerB ) {
-  return ( boost::format( "  %1% %2%, %3%\n" ) % _operator % reg( _registerA ) % reg( _registerB ) ).str(); 
+AsmInstruction pushInsn( const Register _register ) {
+  return { "push", reg( _register ), "" };
 }
 
-std::string pushInsn( const Register _register ) {
-  return ( boost::format( "  push %1%\n" ) % reg( _register ) ).str();
+AsmInstruction pushInsn( const std::string _value ) {
+  return { "push", _value, "" };
 }
 
-std::string pushInsn( const std::string _value ) {
-  return ( boost::format( "  push %1%\n" ) % _value ).str();
+AsmInstruction popInsn( const Register _register ) {
+  return { "pop", reg( _register ), "" };
 }
 
-std::string popInsn( const Register _register ) {
-  return ( boost::format( "  pop %1%\n" ) % reg( _register ) ).str(); 
+AsmInstruction popInsn( const std::string _value ) {
+  return { "pop", _value, "" };
 }
 
-std::string jumpInsn(  const std::string _condition, const std::string _labelPrefix, const unsigned int _labelCounter ) {
-  return ( boost::format( "  %1% %2%_%3%\n" ) % _condition %  _labelPrefix % _labelCounter ).str();
+std::string labelName( const std::string _labelPrefix, const unsigned int _labelCounter ) {
+  return _labelPrefix + "_" + std::to_string( _labelCounter );
 }
 
-std::string label( const std::string _labelPrefix, const unsigned int _labelCounter ) {
-  return ( boost::format( "%1%_%2%:\n" ) % _labelPrefix % _labelCounter ).str();
+AsmInstruction jumpInsn(
+  const std::string _condition,
+  const std::string _labelPrefix,
+  const unsigned int _labelCounter
+) {
+  return { _condition, labelName( _labelPrefix, _labelCounter ), "" };
 }
 
-std::string callInsn( const std::string _function ) {
-  return ( boost::format( "  call %1%\n" ) % _function ).str();
+AsmInstruction label( const std::string _labelPrefix, const unsigned int _labelCounter ) {
+  return { "", labelName( _labelPrefix, _labelCounter ), "" };
 }
 
-std::string formatValue( const Node* _node ) {
-  int convertedValue;
-  std::string value = _node->getText();
-  std::string base = value.substr( 0, 2 );
-  ValueType valueType = _node->getValueType();
+AsmInstruction label( const std::string _name ) {
+  return { "", _name, "" };
+}
 
-  switch( valueType ) {
+AsmInstruction callInsn( const std::string _function ) {
+  return { "call", _function, "" };
+}
+
+bool isLabel( const AsmInstruction& _instruction ) {
+  return _instruction.mnemonic.empty();
+}
+
+void formatInstruction( std::string& _text, const AsmInstruction& _instruction ) {
+  if ( isLabel( _instruction ) ) {
+    _text += _instruction.destination + ":\n";
+    return;
+  }
+
+  _text += "  " + _instruction.mnemonic;
+
+  if ( !_instruction.destination.empty() ) {
+    _text += " " + _instruction.destination;
+  }
+
+  if ( !_instruction.source.empty() ) {
+    _text += ", " + _instruction.source;
+  }
+
+  if ( !_instruction.immediate.empty() ) {
+    _text += ", " + _instruction.immediate;
+  }
+
+  _text += "\n";
+}
+
+/* init function of the module at _path, every character of the path other than letters and digits is escaped */
+std::string moduleSymbol( const std::string _path ) {
+  std::string symbol = "kubic_init_";
+
+  for ( char c : std::filesystem::path( _path ).replace_extension().string() ) {
+    if ( std::isalnum( static_cast<unsigned char>( c ) ) ) {
+      symbol += c;
+    } else {
+      unsigned int code = static_cast<uint8_t>( c );
+      symbol += ( boost::format( "_%02x" ) % code ).str();
+    }
+  }
+
+  return symbol;
+}
+
+/* a function defined in a module, which only the module's own code calls */
+std::string functionSymbol( const std::string _name ) {
+  return "kubic_function_" + _name;
+}
+
+/* a word of the given value type as an immediate, written the way formatValue() writes literals */
+std::string formatWord( const ValueType _type, const int64_t _word ) {
+  if ( _type == ValueType::ValueBoolean ) {
+    return _word == WORD_TRUE ? ASM_TRUE : ASM_FALSE;
+  }
+
+  return std::to_string( _word );
+}
+
+std::string formatValue( const Node* _node ) {
+  switch( _node->getValueType() ) {
     case ValueType::ValueBoolean:
-      if ( value == "false" ) {
-        return ASM_FALSE;
-      } else {
+      if ( ( (BooleanNode*) _node )->getValue() ) {
         return ASM_TRUE;
+      } else {
+        return ASM_FALSE;
       }
       break;
     case ValueType::ValueConstant:
-      if ( base == "0b" ) {
-        convertedValue = std::stoi( value.substr( 2 ), nullptr, 2 );
-      } else if ( base == "0o" ) {
-        convertedValue = std::stoi( value.substr( 2 ), nullptr, 8 );
-      } else if ( base == "0d" ) {
-        convertedValue = std::stoi( value.substr( 2 ), nullptr, 10 );
-      } else if ( base == "0x" ) {
-        convertedValue = std::stoi( value.substr( 2 ), nullptr, 16 );
-      } else {
-        convertedValue = std::stoi( value );
-      }
-
-      convertedValue = convertedValue << 1;
-
-      return std::to_string( convertedValue );
+      /* integers are tagged, shifted left by one */
+      return std::to_string( ( (ConstantNode*) _node )->getValue() << 1 );
       break;
     default:
       return "";
@@ -1,12 +1,23 @@
 #ifndef _COMPILER_HPP
 #define _COMPILER_HPP
 
-#include <boost/range/adaptors.hpp>
+#include <algorithm>
 #include <fstream>
+#include <sstream>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "compiler/assembly.hpp"
+#include "compiler/inline.hpp"
+#include "compiler/ir.hpp"
+#include "compiler/loops.hpp"
+#include "compiler/lower.hpp"
+#include "compiler/peephole.hpp"
+#include "compiler/regalloc.hpp"
+#include "compiler/select.hpp"
+#include "compiler/strength.hpp"
 #include "parser/node.hpp"
 #include "shared/errors.hpp"
 
@@ -14,120 +25,801 @@ std::set<std::string> EXTERNAL_FUNCTIONS = {
   "print",
 };
 
-static unsigned int labelCounter = 0;
-
 bool nodeTypeMatch( const Node* _node, const NodeType _nodeType ) {
   return _node->getNodeType() == _nodeType;
 }
 
-std::string binaryOperator( const Node* _node ) {
-  return mapping( BINARY_OPERATOR_ASM, _node->getText(), std::string( "" ) );
+/* imports anywhere in the tree, a conditional import only runs its module if its branch is taken, one in a loop once */
+void collectImports( Node* _node, std::vector<ImportNode*>& _imports ) {
+  if ( !_node ) {
+    return;
+  } else if ( nodeTypeMatch( _node, NodeType::NodeImport ) ) {
+    _imports.push_back( (ImportNode*) _node );
+  } else if ( nodeTypeMatch( _node, NodeType::NodeMultiStatement ) ) {
+    for ( Node* statement : ( (MultiStatementNode*) _node )->getStatements() ) {
+      collectImports( statement, _imports );
+    }
+  } else if ( nodeTypeMatch( _node, NodeType::NodeConditional ) ) {
+    collectImports( ( (ConditionalNode*) _node )->getUpperBody(), _imports );
+    collectImports( ( (ConditionalNode*) _node )->getLowerBody(), _imports );
+  } else if ( nodeTypeMatch( _node, NodeType::NodeFunction ) ) {
+    collectImports( ( (FunctionNode*) _node )->getBody(), _imports );
+  } else if ( nodeTypeMatch( _node, NodeType::NodeWhile ) ) {
+    collectImports( ( (WhileNode*) _node )->getBody(), _imports );
+  } else if ( nodeTypeMatch( _node, NodeType::NodeFor ) ) {
+    collectImports( ( (ForNode*) _node )->getBody(), _imports );
+  }
 }
 
-std::string compile( Node* _node );
+/* register or stack slot _value is kept in, spill slots sit below the saved registers */
+std::string valueLocation( const Allocation& _allocation, const Value _value ) {
+  const Location& location = _allocation.locations[_value];
+
+  if ( location.inRegister ) {
+    return reg( location.reg );
+  }
 
-void compile( std::stringstream& _representation, const BooleanNode* _node ) {
-  _representation << insn( "mov", Register::RAX, formatValue( _node ) );
+  return regOffset( Register::RBP, static_cast<int>( _allocation.savedRegisters.size() + location.slot ) + 1 );
 }
 
-void compile( std::stringstream& _representation, const ConstantNode* _node ) {
-  _representation << insn( "mov", Register::RAX, formatValue( _node ) );
+bool inMemory( const std::string _location ) {
+  return _location[0] == '[';
 }
 
-void compile( std::stringstream& _representation, const VariableNode* _node ) {
-  _representation << insn( "mov", Register::RAX, regOffset( Register::RBP, getVariableOffset( _node->getText() ) ) );
+/* _value as an instruction reading it in _form takes it, as an immediate or from where it is kept */
+std::string operand(
+  const Selection& _selection,
+  const Allocation& _allocation,
+  const Value _value,
+  const Form _form
+) {
+  const Instruction& definition = *_selection.definitions[_value];
+
+  /* a word that fits is written as the number an instruction sign-extends, booleans included */
+  if ( _form == Form::FormImmediate && fitsImmediate( definition.word ) ) {
+    return std::to_string( definition.word );
+  } else if ( _form == Form::FormImmediate ) {
+    return formatWord( definition.type, definition.word );
+  }
+
+  return valueLocation( _allocation, _value );
 }
 
-void compile( std::stringstream& _representation, const BindingNode* _node ) {
-  _representation << compile( _node->getBindingExpression() )
-                  << pushInsn( Register::RAX );
+/* _value as an instruction taking any operand reads it, a constant as an immediate */
+std::string operand( const Selection& _selection, const Allocation& _allocation, const Value _value ) {
+  bool constant = _selection.definitions[_value]->opcode == Opcode::OpConstant;
+
+  return operand( _selection, _allocation, _value, constant ? Form::FormImmediate : Form::FormRegister );
 }
 
-void compile( std::stringstream& _representation, const BinaryOperatorNode* _node ) {
-    _representation << compile( _node->getRightOperand() )
-                    << pushInsn( Register::RAX )
-                    << compile( _node->getLeftOperand() )
-                    << popInsn( Register::RBX );
+/*
+ * a copy between any two locations or of an immediate into one, from one stack slot to another through the stack
+ * and an immediate too wide for a store through rax
+ */
+void move( AsmCode& _code, const std::string _destination, const std::string _source ) {
+  int64_t value;
 
-    if ( _node->getValueType() == ValueType::ValueBoolean ) {
-      unsigned int currentCounter = labelCounter++;
+  if ( _destination == _source ) {
+    return;
+  } else if ( inMemory( _destination ) && inMemory( _source ) ) {
+    _code.push_back( pushInsn( "qword " + _source ) );
+    _code.push_back( popInsn( "qword " + _destination ) );
+    return;
+  } else if ( inMemory( _destination ) && immediate32( _source, value ) ) {
+    _code.push_back( insn( "mov", "qword " + _destination, std::to_string( value ) ) );
+    return;
+  } else if ( inMemory( _destination ) && !isRegisterOperand( _source ) ) {
+    _code.push_back( insn( "mov", reg( Register::RAX ), _source ) );
+    _code.push_back( insn( "mov", _destination, reg( Register::RAX ) ) );
+    return;
+  }
 
-      _representation << insn( "cmp", Register::RAX, Register::RBX )
-                      << jumpInsn( binaryOperator( _node ), "conditional", currentCounter )
-                      << insn( "mov", Register::RAX, ASM_FALSE )
-                      << jumpInsn( "jmp", "conditional_end", currentCounter )
-                      << label( "conditional", currentCounter )
-                      << insn( "mov", Register::RAX, ASM_TRUE )
-                      << label( "conditional_end", currentCounter );
-    } else {
-      _representation << insn( binaryOperator( _node ), Register::RAX, Register::RBX );
+  _code.push_back( insn( "mov", _destination, _source ) );
+}
+
+/* sets the flags from comparing _left with _right, there is no comparison between two stack slots */
+void compare( AsmCode& _code, std::string _left, const std::string _right ) {
+  if ( inMemory( _left ) && inMemory( _right ) ) {
+    move( _code, reg( Register::RAX ), _left );
+    _left = reg( Register::RAX );
+  } else if ( inMemory( _left ) && !isRegisterOperand( _right ) ) {
+    /* against an immediate, nothing tells the size */
+    _left = "qword " + _left;
+  }
+
+  _code.push_back( insn( "cmp", _left, _right ) );
+}
+
+/*
+ * makes every copy of _copies, a destination and a source each, as if all at once; no two copies share a destination,
+ * and rax is free
+ */
+void compileCopies( AsmCode& _code, const std::vector<std::pair<std::string, std::string>>& _copies ) {
+  /* copies still to be made between locations, and those of an immediate, made last */
+  std::vector<std::pair<std::string, std::string>> copies;
+  std::vector<std::pair<std::string, std::string>> immediates;
+
+  for ( const std::pair<std::string, std::string>& copy : _copies ) {
+    if ( !inMemory( copy.second ) && !isRegisterOperand( copy.second ) ) {
+      /* no other copy reads the destination by then, and rax is free again for a wide immediate */
+      immediates.push_back( copy );
+    } else if ( copy.first != copy.second ) {
+      copies.push_back( copy );
+    }
+  }
+
+  while ( !copies.empty() ) {
+    /* a copy into a location no other copy still reads can be made straight away */
+    auto ready = std::find_if( copies.begin(), copies.end(), [ &copies ]( const auto& _copy ) {
+      return std::none_of( copies.begin(), copies.end(), [ &_copy ]( const auto& _other ) {
+        return _other.second == _copy.first;
+      } );
+    } );
+
+    if ( ready != copies.end() ) {
+      move( _code, ready->first, ready->second );
+      copies.erase( ready );
+      continue;
+    }
+
+    /* only cycles are left, one of their locations is set aside in rax to break them */
+    std::string blocked = copies.front().first;
+    move( _code, reg( Register::RAX ), blocked );
+
+    for ( std::pair<std::string, std::string>& copy : copies ) {
+      if ( copy.second == blocked ) copy.second = reg( Register::RAX );
+    }
+  }
+
+  for ( const std::pair<std::string, std::string>& immediate : immediates ) {
+    move( _code, immediate.first, immediate.second );
+  }
+}
+
+/* _source as an operand of an instruction taking no other, which cannot tell its size from a register */
+std::string sized( const std::string _source ) {
+  return inMemory( _source ) ? "qword " + _source : _source;
+}
+
+/* _source times the untagged _multiplier into _target, by a shift and lea where they do */
+void compileMultiply(
+  AsmCode& _code,
+  const std::string _target,
+  const std::string _source,
+  const int64_t _multiplier
+) {
+  int64_t factor;
+  int shift;
+
+  if ( _multiplier == 0 ) {
+    _code.push_back( insn( "mov", _target, "0" ) );
+    return;
+  } else if ( !shiftedMultiplier( magnitude( _multiplier ), factor, shift ) ) {
+    _code.push_back( { "imul", _target, _source, std::to_string( _multiplier ) } );
+    return;
+  }
+
+  if ( factor > 1 ) {
+    std::string base = _source;
+
+    /* lea only adds registers */
+    if ( inMemory( base ) ) {
+      move( _code, _target, base );
+      base = _target;
+    }
+
+    _code.push_back( insn( "lea", _target, "[" + base + " + " + base + " * " + std::to_string( factor - 1 ) + "]" ) );
+  } else {
+    move( _code, _target, _source );
+  }
+
+  if ( shift > 0 ) {
+    _code.push_back( insn( "shl", _target, std::to_string( shift ) ) );
+  }
+
+  if ( _multiplier < 0 ) {
+    _code.push_back( insn( "neg", _target ) );
+  }
+}
+
+/* _dividend divided by _divisor, tagged again; the quotient is left in rax, which is returned */
+std::string compileDivide( AsmCode& _code, const std::string _dividend, const std::string _divisor ) {
+  std::string scratch = reg( Register::RAX );
+
+  move( _code, scratch, _dividend );
+  _code.push_back( insn( "cqo" ) );
+  _code.push_back( insn( "idiv", sized( _divisor ) ) );
+  _code.push_back( insn( "add", scratch, scratch ) );
+
+  return scratch;
+}
+
+/*
+ * _dividend divided by the constant whose word is _divisor, tagged again, by shifts or a multiplication by a magic
+ * number; the quotient is left in rax or rdx, whichever is returned
+ */
+std::string compileDivide( AsmCode& _code, const std::string _dividend, const int64_t _divisor ) {
+  std::string scratch = reg( Register::RAX );
+  std::string high = reg( Register::RDX );
+  int exponent = powerOfTwo( magnitude( _divisor ) );
 
-      if ( _node->getText() == "*" ) {
-        _representation << insn( "sar", Register::RAX, "1" );
+  if ( exponent == 1 ) {
+    /* by one, the tag is what the word is divided by */
+    move( _code, scratch, _dividend );
+  } else if ( exponent > 1 ) {
+    /* rounds towards zero, a negative dividend is biased by one less than the divisor first */
+    move( _code, scratch, _dividend );
+    _code.push_back( insn( "sar", scratch, "63" ) );
+    _code.push_back( insn( "shr", scratch, std::to_string( 64 - exponent ) ) );
+    _code.push_back( insn( "add", scratch, _dividend ) );
+    _code.push_back( insn( "sar", scratch, std::to_string( exponent ) ) );
+    _code.push_back( insn( "add", scratch, scratch ) );
+  }
+
+  if ( exponent > 0 ) {
+    if ( _divisor < 0 ) _code.push_back( insn( "neg", scratch ) );
+
+    return scratch;
+  }
+
+  DivisionMagic magic = divisionMagic( _divisor );
+
+  /* the high half of the product, corrected as the multiplier overflowed into the sign, rounded towards zero */
+  _code.push_back( insn( "mov", scratch, std::to_string( magic.multiplier ) ) );
+  _code.push_back( insn( "imul", sized( _dividend ) ) );
+
+  if ( _divisor > 0 && magic.multiplier < 0 ) {
+    _code.push_back( insn( "add", high, _dividend ) );
+  } else if ( _divisor < 0 && magic.multiplier > 0 ) {
+    _code.push_back( insn( "sub", high, _dividend ) );
+  }
+
+  if ( magic.shift > 0 ) {
+    _code.push_back( insn( "sar", high, std::to_string( magic.shift ) ) );
+  }
+
+  _code.push_back( insn( "mov", scratch, high ) );
+  _code.push_back( insn( "shr", scratch, "63" ) );
+  _code.push_back( insn( "add", high, scratch ) );
+  _code.push_back( insn( "add", high, high ) );
+
+  return high;
+}
+
+/*
+ * the sum _terms describe into _target by a single lea, or added up in rax when a term was spilled, as an address
+ * only takes registers; the register holding it is returned
+ */
+std::string compileAddress(
+  AsmCode& _code,
+  const Allocation& _allocation,
+  const std::string _target,
+  const AddressTerms& _terms
+) {
+  std::string scratch = reg( Register::RAX );
+  std::string base = _terms.base != NO_VALUE ? valueLocation( _allocation, _terms.base ) : "";
+  std::string index = _terms.index != NO_VALUE ? valueLocation( _allocation, _terms.index ) : "";
+  std::string displacement = std::to_string( _terms.displacement < 0 ? -_terms.displacement : _terms.displacement );
+  std::string address = base;
+
+  if ( inMemory( base ) || inMemory( index ) ) {
+    if ( !index.empty() ) {
+      move( _code, scratch, index );
+
+      if ( _terms.scale > 1 ) {
+        _code.push_back( insn( "shl", scratch, std::to_string( powerOfTwo( magnitude( _terms.scale ) ) ) ) );
       }
+
+      if ( !base.empty() ) _code.push_back( insn( "add", scratch, base ) );
+    } else {
+      move( _code, scratch, base );
     }
+
+    if ( _terms.displacement != 0 ) {
+      _code.push_back( insn( _terms.displacement < 0 ? "sub" : "add", scratch, displacement ) );
+    }
+
+    return scratch;
+  }
+
+  if ( _terms.displacement == 0 && ( index.empty() || ( base.empty() && _terms.scale == 1 ) ) ) {
+    move( _code, _target, base.empty() ? index : base );
+    return _target;
+  }
+
+  if ( !index.empty() ) {
+    address += ( address.empty() ? "" : " + " ) + index;
+  }
+
+  if ( _terms.scale > 1 ) {
+    address += " * " + std::to_string( _terms.scale );
+  }
+
+  if ( address.empty() ) {
+    address = std::to_string( _terms.displacement );
+  } else if ( _terms.displacement != 0 ) {
+    address += ( _terms.displacement < 0 ? " - " : " + " ) + displacement;
+  }
+
+  _code.push_back( insn( "lea", _target, "[" + address + "]" ) );
+
+  return _target;
 }
 
-void compile( std::stringstream& _representation, const MultiStatementNode* _node ) {
-  for ( Node* statement : _node->getStatements() ) {
-    _representation << compile( statement );
+/* sets the flags for the comparison defining _value, the condition code it holds under is returned */
+std::string compileFlags(
+  AsmCode& _code,
+  const Selection& _selection,
+  const Allocation& _allocation,
+  const Value _value
+) {
+  const Instruction& comparison = *_selection.definitions[_value];
+  const SelectionRule& rule = selectedRule( _selection, _value, Form::FormFlags );
+  std::string left = operand( _selection, _allocation, comparison.operands[0], rule.left );
+  std::string right = operand( _selection, _allocation, comparison.operands[1], rule.right );
+
+  /* cmp takes an immediate on the right only */
+  if ( rule.pattern == Pattern::PatternSwappedCompare ) {
+    compare( _code, right, left );
+    return swappedCondition( conditionCode( comparison.operation ) );
   }
+
+  compare( _code, left, right );
+  return conditionCode( comparison.operation );
 }
 
-void compile( std::stringstream& _representation, const ConditionalNode* _node ) {
-  unsigned int currentCounter = labelCounter++;
+bool commutative( const OperatorId _operator ) {
+  return _operator != OperatorId::OperatorSubtract && _operator != OperatorId::OperatorDivide;
+}
+
+/*
+ * a call as the System V ABI makes it, the first arguments in ARGUMENT_REGISTERS and the rest pushed right to left,
+ * padded so rsp stays 16-byte aligned at the call as the frame keeps it; nothing is saved around it, as no value live
+ * across a call is kept in a caller-saved register ( see compiler/regalloc.hpp )
+ */
+void compileCall(
+  AsmCode& _code,
+  const Selection& _selection,
+  const Allocation& _allocation,
+  const Instruction& _instruction
+) {
+  std::vector<std::pair<std::string, std::string>> arguments;
+  size_t registerArguments = std::min( _instruction.operands.size(), ARGUMENT_REGISTERS.size() );
+  size_t stackArguments = _instruction.operands.size() - registerArguments;
+  size_t padding = stackArguments % 2;
+  int64_t value;
+
+  if ( padding > 0 ) {
+    _code.push_back( insn( "sub", Register::RSP, "8" ) );
+  }
+
+  for ( size_t index = _instruction.operands.size(); index > registerArguments; index-- ) {
+    std::string argument = operand( _selection, _allocation, _instruction.operands[index - 1] );
+
+    if ( immediate32( argument, value ) ) {
+      argument = std::to_string( value );
+    } else if ( !inMemory( argument ) && !isRegisterOperand( argument ) ) {
+      /* push sign-extends an immediate from 32 bits, a wider one is pushed from rax */
+      move( _code, reg( Register::RAX ), argument );
+      argument = reg( Register::RAX );
+    }
+
+    _code.push_back( pushInsn( sized( argument ) ) );
+  }
 
-  _representation << compile( _node->getConditional() )
-                  << insn( "cmp", Register::RAX, ASM_TRUE )
-                  << jumpInsn( "jne", "else_body", currentCounter )
-                  << compile( _node->getUpperBody() )
-                  << jumpInsn( "jmp", "end_if_else", currentCounter )
-                  << label( "else_body", currentCounter )
-                  << compile( _node->getLowerBody() )
-                  << label( "end_if_else", currentCounter );
+  for ( size_t index = 0; index < registerArguments; index++ ) {
+    arguments.push_back( {
+      reg( ARGUMENT_REGISTERS[index] ),
+      operand( _selection, _allocation, _instruction.operands[index] ),
+    } );
+  }
+
+  compileCopies( _code, arguments );
+  _code.push_back( callInsn( std::string( interner.getName( _instruction.callee ) ) ) );
+
+  if ( stackArguments + padding > 0 ) {
+    _code.push_back( insn( "add", Register::RSP, std::to_string( 8 * ( stackArguments + padding ) ) ) );
+  }
 }
 
-void compile( std::stringstream& _representation, const FunctionCallNode* _node ) {
-    std::vector<Node*> arguments = _node->getArguments();
+/* the code selected for an instruction that is kept, computing its value together with those folded into it */
+void compile(
+  AsmCode& _code,
+  const Selection& _selection,
+  const Allocation& _allocation,
+  const Instruction& _instruction
+) {
+  std::string scratch = reg( Register::RAX );
+  std::string destination = _instruction.result != NO_VALUE ? valueLocation( _allocation, _instruction.result ) : "";
+  /* where the result is computed, straight into its register unless it was spilled */
+  std::string target = inMemory( destination ) ? scratch : destination;
+
+  if ( _instruction.opcode == Opcode::OpCall ) {
+    compileCall( _code, _selection, _allocation, _instruction );
+
+    if ( !destination.empty() ) move( _code, destination, scratch );
+    return;
+  }
+
+  const SelectionRule& rule = selectedRule( _selection, _instruction.result, Form::FormRegister );
+  std::string left;
+  std::string right;
+
+  if ( _instruction.opcode == Opcode::OpBinary ) {
+    left = operand( _selection, _allocation, _instruction.operands[0], rule.left );
+    right = operand( _selection, _allocation, _instruction.operands[1], rule.right );
+  }
 
-    for ( Node* argument : boost::adaptors::reverse( arguments ) ) {
-      _representation << compile( argument );
-      /* TODO -- order of function arguments RDI, RSI, RDX, RCX, R8, R9 */
-      _representation << insn( "mov", Register::RDI, Register::RAX );
+  switch ( rule.pattern ) {
+    case Pattern::PatternLoad:
+      /* a 64-bit immediate can only be moved into a register */
+      _code.push_back( insn( "mov", target, formatWord( _instruction.type, _instruction.word ) ) );
+      break;
+    case Pattern::PatternLea: {
+      AddressTerms terms;
+
+      addressTerms( _selection, _instruction.result, Form::FormAddress, terms );
+      target = compileAddress( _code, _allocation, target, terms );
+      break;
+    }
+    case Pattern::PatternMaterialize: {
+      std::string failed = invertedCondition( compileFlags( _code, _selection, _allocation, _instruction.result ) );
+
+      if ( target != scratch ) {
+        /* moves leave the flags alone, the result is true unless the comparison failed */
+        _code.push_back( insn( "mov", scratch, ASM_FALSE ) );
+        _code.push_back( insn( "mov", target, ASM_TRUE ) );
+        _code.push_back( insn( "cmov" + failed, target, scratch ) );
+      } else {
+        /* spilled, a 1 for a failed comparison is rotated into the top bit and every bit flipped */
+        _code.push_back( insn( "set" + failed, "al" ) );
+        _code.push_back( insn( "movzx", "eax", "al" ) );
+        _code.push_back( insn( "ror", scratch, "1" ) );
+        _code.push_back( insn( "not", scratch ) );
+      }
+      break;
     }
+    case Pattern::PatternScale: {
+      size_t constant = immediateOperand( rule );
+      std::string source = valueLocation( _allocation, _instruction.operands[1 - constant] );
+
+      compileMultiply( _code, target, source, _selection.definitions[_instruction.operands[constant]]->word >> 1 );
+      break;
+    }
+    case Pattern::PatternReducedDivide:
+      target = compileDivide( _code, left, _selection.definitions[_instruction.operands[1]]->word );
+      break;
+    case Pattern::PatternDivide:
+      target = compileDivide( _code, left, right );
+      break;
+    case Pattern::PatternArithmetic:
+    case Pattern::PatternXor:
+    case Pattern::PatternMultiply:
+      /* the result's register may hold the right operand, which must not be overwritten before it is read */
+      if ( target == right && target != left && commutative( _instruction.operation ) ) {
+        std::swap( left, right );
+      } else if ( target == right && ( target != left || _instruction.operation == OperatorId::OperatorMultiply ) ) {
+        /* a multiplication untags its left operand where it is, which must then not be read as the right one */
+        target = scratch;
+      }
+
+      move( _code, target, left );
+
+      /* both operands are tagged, one is untagged first so the product is tagged once and wraps as integers do */
+      if ( _instruction.operation == OperatorId::OperatorMultiply ) {
+        _code.push_back( insn( "sar", target, "1" ) );
+      }
+
+      _code.push_back( insn( binaryOperatorAsm( _instruction.operation ), target, right ) );
+
+      if ( _instruction.operation == OperatorId::OperatorXor ) {
+        /* true and false only differ in the top bit, which is all that is left set when the operands differ */
+        _code.push_back( insn( "not", target ) );
+        _code.push_back( insn( "btc", target, "63" ) );
+      }
+      break;
+    case Pattern::PatternUntaggedMultiply:
+      /* the right operand is untagged already, and being the only one that is, cannot be swapped to the left */
+      if ( target == right ) {
+        target = scratch;
+      }
 
-    _representation << callInsn( _node->getName() );
-    /* TODO -- only move RBP if using stack */
+      move( _code, target, left );
+      _code.push_back( insn( "imul", target, right ) );
+      break;
+    case Pattern::PatternUntag:
+      move( _code, target, valueLocation( _allocation, _instruction.operands[0] ) );
+      _code.push_back( insn( "sar", target, "1" ) );
+      break;
+    default:
+      break;
+  }
+
+  if ( !destination.empty() ) {
+    move( _code, destination, target );
+  }
 }
 
-std::string compile( Node* _node ) {
-  std::stringstream representation;
+/* sets every phi of _successor to the value it takes from _block, as if all at once */
+void compilePhiCopies(
+  AsmCode& _code,
+  const IrFunction& _function,
+  const Selection& _selection,
+  const Allocation& _allocation,
+  const BlockId _block,
+  const BlockId _successor
+) {
+  const BasicBlock& successor = _function.getBlock( _successor );
+  std::vector<std::pair<std::string, std::string>> copies;
+  size_t predecessor = 0;
 
-  if ( !_node ) {
-    return "";
-  } else if ( nodeTypeMatch( _node, NodeType::NodeConstant ) ) {
-    compile( representation, (ConstantNode*) _node );
-  } else if ( nodeTypeMatch( _node, NodeType::NodeBoolean ) ) {
-    compile( representation, (BooleanNode*) _node );
-  } else if ( nodeTypeMatch( _node, NodeType::NodeVariable ) ) {
-    compile( representation, (VariableNode*) _node );
-  } else if ( nodeTypeMatch( _node, NodeType::NodeBinding ) ) {
-    compile( representation, (BindingNode*) _node );
-  } else if ( nodeTypeMatch( _node, NodeType::NodeUnaryOperator ) ) {
-    /* TODO -- implement once more operators have been decided */
-  } else if ( nodeTypeMatch( _node, NodeType::NodeBinaryOperator ) ) {
-    compile( representation, (BinaryOperatorNode*) _node );
-  } else if ( nodeTypeMatch( _node, NodeType::NodeMultiStatement ) ) {
-    compile( representation, (MultiStatementNode*) _node );
-  } else if ( nodeTypeMatch( _node, NodeType::NodeConditional ) ) {
-    compile( representation, (ConditionalNode*) _node );
-  } else if ( nodeTypeMatch( _node, NodeType::NodeFunctionCall ) ) {
-    compile( representation, (FunctionCallNode*) _node );
+  while ( successor.predecessors[predecessor] != _block ) {
+    predecessor++;
+  }
+
+  for ( const Instruction& instruction : successor.instructions ) {
+    if ( instruction.opcode != Opcode::OpPhi ) break;
+
+    copies.push_back( {
+      valueLocation( _allocation, instruction.result ),
+      operand( _selection, _allocation, instruction.operands[predecessor] ),
+    } );
+  }
+
+  compileCopies( _code, copies );
+}
+
+/* restores the registers and frame of the caller, as a return or a tail call leaves */
+void compileEpilogue( AsmCode& _code, const Allocation& _allocation ) {
+  if ( _allocation.savedRegisters.empty() ) {
+    _code.push_back( insn( "mov", Register::RSP, Register::RBP ) );
   } else {
-    return "";
+    int saved = static_cast<int>( _allocation.savedRegisters.size() );
+    _code.push_back( insn( "lea", Register::RSP, regOffset( Register::RBP, saved ) ) );
+  }
+
+  for ( size_t index = _allocation.savedRegisters.size(); index > 0; index-- ) {
+    _code.push_back( popInsn( _allocation.savedRegisters[index - 1] ) );
+  }
+
+  _code.push_back( popInsn( Register::RBP ) );
+}
+
+/* a jump to the block laid out next falls through */
+void compileTerminator(
+  AsmCode& _code,
+  const IrFunction& _function,
+  const Selection& _selection,
+  const Allocation& _allocation,
+  const BlockId _block,
+  const BlockId _next
+) {
+  const Instruction& terminator = _function.getBlock( _block ).instructions.back();
+
+  switch ( terminator.opcode ) {
+    case Opcode::OpJump:
+      compilePhiCopies( _code, _function, _selection, _allocation, _block, terminator.targets[0] );
+
+      if ( terminator.targets[0] != _next ) {
+        _code.push_back( jumpInsn( "jmp", ".block", terminator.targets[0] ) );
+      }
+      break;
+    case Opcode::OpBranch: {
+      Value comparison = terminator.operands[0];
+      /* condition code under which the branch goes to its first target */
+      std::string taken;
+
+      if ( _selection.forms[comparison] == Form::FormFlags ) {
+        taken = compileFlags( _code, _selection, _allocation, comparison );
+      } else {
+        std::string condition = valueLocation( _allocation, terminator.operands[0] );
+
+        /* true is the only boolean with the top bit set */
+        if ( inMemory( condition ) ) {
+          _code.push_back( insn( "cmp", "qword " + condition, "0" ) );
+        } else {
+          _code.push_back( insn( "test", condition, condition ) );
+        }
+
+        taken = "s";
+      }
+
+      if ( terminator.targets[0] == _next ) {
+        _code.push_back( jumpInsn( "j" + invertedCondition( taken ), ".block", terminator.targets[1] ) );
+      } else if ( terminator.targets[1] == _next ) {
+        _code.push_back( jumpInsn( "j" + taken, ".block", terminator.targets[0] ) );
+      } else {
+        _code.push_back( jumpInsn( "j" + invertedCondition( taken ), ".block", terminator.targets[1] ) );
+        _code.push_back( jumpInsn( "jmp", ".block", terminator.targets[0] ) );
+      }
+      break;
+    }
+    case Opcode::OpReturn:
+      if ( !terminator.operands.empty() ) {
+        move( _code, reg( Register::RAX ), operand( _selection, _allocation, terminator.operands[0] ) );
+      }
+
+      compileEpilogue( _code, _allocation );
+      _code.push_back( insn( "ret" ) );
+      break;
+    case Opcode::OpTailCall: {
+      /* the callee returns straight to our caller, its arguments all fit in registers ( see compiler/lower.hpp ) */
+      std::vector<std::pair<std::string, std::string>> arguments;
+
+      for ( size_t index = 0; index < terminator.operands.size(); index++ ) {
+        arguments.push_back( {
+          reg( ARGUMENT_REGISTERS[index] ),
+          operand( _selection, _allocation, terminator.operands[index] ),
+        } );
+      }
+
+      compileCopies( _code, arguments );
+      compileEpilogue( _code, _allocation );
+      _code.push_back( insn( "jmp", std::string( interner.getName( terminator.callee ) ) ) );
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+/*
+ * copies the parameters of a function from where the caller passed them to where they are kept, all at once before
+ * the body; those past the argument registers sit above the return address
+ */
+void compileParameters(
+  AsmCode& _code,
+  const IrFunction& _function,
+  const Selection& _selection,
+  const Allocation& _allocation
+) {
+  std::vector<std::pair<std::string, std::string>> parameters;
+
+  for ( const Instruction& instruction : _function.getBlock( 0 ).instructions ) {
+    if ( instruction.opcode != Opcode::OpParameter ) continue;
+
+    size_t index = static_cast<size_t>( instruction.word );
+
+    if ( _selection.uses[instruction.result] == 0 ) continue;
+
+    parameters.push_back( {
+      valueLocation( _allocation, instruction.result ),
+      index < ARGUMENT_REGISTERS.size() ? reg( ARGUMENT_REGISTERS[index] )
+                                        : regOffset( Register::RBP, -static_cast<int>( index - 4 ) ),
+    } );
   }
 
-  return representation.str();
+  compileCopies( _code, parameters );
+}
+
+/*
+ * code of a lowered function, adding every function it calls to _callees; a module's init function runs its
+ * statements the first time it is called and returns straight away after that
+ */
+AsmCode compileFunction( const IrFunction& _function, std::set<std::string>& _callees ) {
+  AsmCode code;
+  std::vector<BlockId> layout = _function.reversePostorder();
+  Selection selection = selectInstructions( _function, layout );
+  Allocation allocation = allocateRegisters( _function, layout, selection );
+  bool init = _function.getName().rfind( "kubic_init_", 0 ) == 0;
+  /* saved registers and spill slots take whole 16 bytes between them, which keeps the stack aligned at every call */
+  size_t frameSlots = allocation.spillSlots + ( allocation.savedRegisters.size() + allocation.spillSlots ) % 2;
+
+  code.push_back( label( _function.getName() ) );
+
+  if ( init ) {
+    code.push_back( insn( "cmp", "qword [rel module_initialized]", "0" ) );
+    code.push_back( insn( "jne", ".initialized" ) );
+    code.push_back( insn( "mov", "qword [rel module_initialized]", "1" ) );
+  }
+
+  code.push_back( pushInsn( Register::RBP ) );
+  code.push_back( insn( "mov", Register::RBP, Register::RSP ) );
+
+  for ( Register saved : allocation.savedRegisters ) {
+    code.push_back( pushInsn( saved ) );
+  }
+
+  if ( frameSlots > 0 ) {
+    code.push_back( insn( "sub", Register::RSP, std::to_string( 8 * frameSlots ) ) );
+  }
+
+  compileParameters( code, _function, selection, allocation );
+
+  for ( size_t index = 0; index < layout.size(); index++ ) {
+    BlockId block = layout[index];
+    BlockId next = index + 1 < layout.size() ? layout[index + 1] : NO_BLOCK;
+
+    if ( index > 0 ) {
+      code.push_back( label( ".block", block ) );
+    }
+
+    for ( const Instruction& instruction : _function.getBlock( block ).instructions ) {
+      if ( instruction.opcode == Opcode::OpCall || instruction.opcode == Opcode::OpTailCall ) {
+        _callees.insert( std::string( interner.getName( instruction.callee ) ) );
+      }
+
+      /*
+       * a value folded into the instruction reading it is computed there, a parameter before the body and a phi by
+       * the copies ending each predecessor
+       */
+      bool kept = instruction.result == NO_VALUE || selection.kept[instruction.result];
+      bool copied = instruction.opcode == Opcode::OpParameter || instruction.opcode == Opcode::OpPhi;
+
+      if ( !isTerminator( instruction.opcode ) && !copied && kept ) {
+        compile( code, selection, allocation, instruction );
+      }
+    }
+
+    compileTerminator( code, _function, selection, allocation, block, next );
+  }
+
+  if ( init ) {
+    code.push_back( label( ".initialized" ) );
+    code.push_back( insn( "ret" ) );
+  }
+
+  return peephole( code );
+}
+
+/*
+ * assembly of a whole module under _symbol, with its IR dumped into _ir once calls are inlined, when asked for, and
+ * how many call sites were inlined into _inlined; the entry module is kubic_main, any other module is an init
+ * function, and the functions the module defines follow it, local to it
+ */
+std::string compileModule(
+  Node* _node,
+  const std::string _symbol,
+  std::string* _ir = nullptr,
+  uint32_t* _inlined = nullptr
+) {
+  std::vector<IrFunction> functions = lowerModule( _node, _symbol );
+  uint32_t inlined = inlineFunctions( functions );
+
+  for ( IrFunction& function : functions ) {
+    hoistLoopInvariants( function );
+  }
+
+  std::set<std::string> callees( EXTERNAL_FUNCTIONS );
+  std::stringstream header;
+  AsmCode code;
+
+  for ( const IrFunction& function : functions ) {
+    AsmCode body = compileFunction( function, callees );
+
+    code.insert( code.end(), body.begin(), body.end() );
+
+    if ( _ir ) *_ir += dumpIr( function );
+  }
+
+  for ( const IrFunction& function : functions ) {
+    callees.erase( function.getName() );
+  }
+
+  if ( _inlined ) *_inlined = inlined;
+
+  header << "section .data" << std::endl;
+
+  for ( std::string function : callees ) {
+    header << "  extern " << function << std::endl;
+  }
+
+  if ( _symbol != "kubic_main" ) {
+    header << "  module_initialized: dq 0" << std::endl;
+  }
+
+  header << std::endl
+         << "section .text" << std::endl
+         << "  global " << _symbol << std::endl
+         << std::endl;
+
+  std::string assembly = header.str();
+
+  for ( const AsmInstruction& instruction : code ) {
+    formatInstruction( assembly, instruction );
+  }
+
+  return assembly;
 }
 
 void compile( Node* _node, const std::string _filename ) {
@@ -135,26 +827,12 @@ void compile( Node* _node, const std::string _filename ) {
 
   std::ofstream asmFile( asmFilename );
 
-  std::string generatedCode = compile( _node );
+  std::string assembly = compileModule( _node, "kubic_main" );
 
   if ( !emptyErrorsLog() ) {
     printErrors();
   } else {
-    asmFile << "section .data" << std::endl;
-
-    for ( std::string function : EXTERNAL_FUNCTIONS ) {
-      asmFile << "  extern " << function << std::endl;
-    }
-
-    asmFile << std::endl
-            << "section .text" << std::endl
-            << "  global kubic_main" << std::endl
-            << std::endl
-            << "kubic_main:" << std::endl
-            << generatedCode
-            << insn( "mov", Register::RSP, Register::RBP )
-            << insn( "sub", Register::RSP, std::to_string( 8 * 5 ) )
-            << "  ret" << std::endl;
+    asmFile << assembly;
   }
   asmFile.close();
 }
@@ -0,0 +1,317 @@
+#ifndef _INLINE_HPP
+#define _INLINE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "compiler/ir.hpp"
+#include "shared/types.hpp"
+
+/*
+ * inlining of calls to the functions a module defines, over the IR of the whole module before instructions are
+ * selected; a call is replaced by a copy of the callee's blocks, its parameters by the arguments and each of its
+ * returns by a jump to the rest of the caller, where a phi takes the value returned, so a small function costs none
+ * of a call's prologue, epilogue and argument moves, and its body is given registers together with the caller's
+ *
+ * a callee is inlined when it costs no more than inlineThreshold instructions, or whatever it costs when its
+ * definition is annotated inline, and never when it is annotated noinline; a function is never inlined into itself,
+ * and a function no call is left to once its callers are done is not compiled at all
+ */
+
+/* instructions a callee may cost to be inlined, --inline-threshold= sets it */
+static uint32_t inlineThreshold = 16;
+
+/* instructions a function costs wherever it is inlined, parameters, phis and jumps are at most copies */
+uint32_t inlineCost( const IrFunction& _function ) {
+  uint32_t cost = 0;
+
+  for ( size_t block = 0; block < _function.blockCount(); block++ ) {
+    for ( const Instruction& instruction : _function.getBlock( static_cast<BlockId>( block ) ).instructions ) {
+      switch ( instruction.opcode ) {
+        case Opcode::OpParameter:
+        case Opcode::OpPhi:
+        case Opcode::OpJump:
+          break;
+        default:
+          cost++;
+      }
+    }
+  }
+
+  return cost;
+}
+
+bool inlinable( const IrFunction& _callee ) {
+  switch ( _callee.getInlining() ) {
+    case Inlining::InlineAlways:
+      return true;
+    case Inlining::InlineNever:
+      return false;
+    default:
+      return inlineCost( _callee ) <= inlineThreshold;
+  }
+}
+
+/*
+ * the checks resolving the call made ( see parser/resolver.hpp ), made again on the arguments that take the place of
+ * the parameters: one argument of the type of each parameter, and a value returned of the type of the call
+ */
+bool signatureMatches( const IrFunction& _caller, const Instruction& _call, const IrFunction& _callee ) {
+  size_t parameters = 0;
+
+  for ( size_t block = 0; block < _callee.blockCount(); block++ ) {
+    for ( const Instruction& instruction : _callee.getBlock( static_cast<BlockId>( block ) ).instructions ) {
+      size_t index = static_cast<size_t>( instruction.word );
+
+      if ( instruction.opcode == Opcode::OpParameter ) {
+        parameters++;
+
+        if ( index >= _call.operands.size() || _caller.getValueType( _call.operands[index] ) != instruction.type ) {
+          return false;
+        }
+      } else if ( instruction.opcode == Opcode::OpReturn ) {
+        ValueType returned = instruction.operands.empty()
+          ? ValueType::ValueVoid : _callee.getValueType( instruction.operands[0] );
+
+        if ( returned != _call.type ) return false;
+      }
+    }
+  }
+
+  return parameters == _call.operands.size();
+}
+
+/*
+ * replaces the call at _index of _block with a copy of _callee; a tail call is replaced by the copy as it is, its
+ * returns returning from the caller, any other call is split off from the rest of its block, which the returns jump
+ * to, and whatever a tail call of the callee returns is returned there too, the tail call becoming a call
+ */
+void inlineCall( IrFunction& _caller, const BlockId _block, const size_t _index, const IrFunction& _callee ) {
+  Instruction call = _caller.getBlock( _block ).instructions[_index];
+  bool tail = call.opcode == Opcode::OpTailCall;
+  BlockId rest = tail ? NO_BLOCK : _caller.addBlock();
+  std::vector<BlockId> blocks;
+  std::vector<Value> values( _callee.valueCount(), NO_VALUE );
+  std::vector<Value> returned;
+
+  for ( size_t block = 0; block < _callee.blockCount(); block++ ) {
+    blocks.push_back( _caller.addBlock() );
+  }
+
+  /* no block is added from here on, so blocks stay where they are */
+  std::vector<Instruction>& head = _caller.getBlock( _block ).instructions;
+
+  if ( !tail ) {
+    BasicBlock& restBlock = _caller.getBlock( rest );
+
+    restBlock.instructions.assign( head.begin() + static_cast<std::ptrdiff_t>( _index ) + 1, head.end() );
+
+    /* the successors of the block now follow the rest of it */
+    for ( BlockId target : restBlock.instructions.back().targets ) {
+      if ( target == NO_BLOCK ) continue;
+
+      std::vector<BlockId>& predecessors = _caller.getBlock( target ).predecessors;
+      std::replace( predecessors.begin(), predecessors.end(), _block, rest );
+    }
+  }
+
+  head.erase( head.begin() + static_cast<std::ptrdiff_t>( _index ), head.end() );
+
+  /* copies are appended with the callee's operands, which are only all mapped once every copy has its result */
+  for ( size_t block = 0; block < _callee.blockCount(); block++ ) {
+    for ( Instruction instruction : _callee.getBlock( static_cast<BlockId>( block ) ).instructions ) {
+      if ( instruction.opcode == Opcode::OpParameter ) {
+        values[instruction.result] = call.operands[static_cast<size_t>( instruction.word )];
+        continue;
+      }
+
+      Value result = instruction.result;
+
+      for ( BlockId& target : instruction.targets ) {
+        if ( target != NO_BLOCK ) target = blocks[target];
+      }
+
+      Value copy = _caller.append( blocks[block], instruction );
+
+      if ( result != NO_VALUE ) values[result] = copy;
+    }
+  }
+
+  for ( size_t block = 0; block < _callee.blockCount(); block++ ) {
+    BasicBlock& copy = _caller.getBlock( blocks[block] );
+
+    copy.predecessors.clear();
+
+    for ( BlockId predecessor : _callee.getBlock( static_cast<BlockId>( block ) ).predecessors ) {
+      copy.predecessors.push_back( blocks[predecessor] );
+    }
+
+    for ( Instruction& instruction : copy.instructions ) {
+      for ( Value& operand : instruction.operands ) {
+        operand = values[operand];
+      }
+    }
+  }
+
+  for ( size_t block = 0; block < _callee.blockCount() && !tail; block++ ) {
+    std::vector<Instruction>& instructions = _caller.getBlock( blocks[block] ).instructions;
+
+    if ( instructions.empty() || !leavesFunction( instructions.back().opcode ) ) continue;
+
+    Instruction terminator = instructions.back();
+    Instruction jump = makeInstruction( Opcode::OpJump );
+
+    instructions.pop_back();
+
+    if ( terminator.opcode == Opcode::OpTailCall ) {
+      terminator.opcode = Opcode::OpCall;
+      terminator.type = call.type;
+      returned.push_back( _caller.append( blocks[block], terminator ) );
+    } else {
+      returned.push_back( terminator.operands.empty() ? NO_VALUE : terminator.operands[0] );
+    }
+
+    jump.targets[0] = rest;
+    _caller.append( blocks[block], jump );
+  }
+
+  Instruction entry = makeInstruction( Opcode::OpJump );
+  entry.targets[0] = blocks[0];
+  _caller.append( _block, entry );
+
+  /* the value the call returned is still the result, now of a phi of whatever each return returned */
+  if ( !tail && call.result != NO_VALUE && !returned.empty() ) {
+    Instruction phi = makeInstruction( Opcode::OpPhi, call.type );
+    std::vector<Instruction>& instructions = _caller.getBlock( rest ).instructions;
+
+    phi.result = call.result;
+    phi.operands = returned;
+    instructions.insert( instructions.begin(), phi );
+  }
+}
+
+/* every call and tail call of _function to a function of the module, by block and index */
+std::vector<std::pair<BlockId, size_t>> callSites(
+  const IrFunction& _function,
+  const std::unordered_map<std::string, size_t>& _indices
+) {
+  std::vector<std::pair<BlockId, size_t>> sites;
+
+  for ( size_t block = 0; block < _function.blockCount(); block++ ) {
+    const std::vector<Instruction>& instructions = _function.getBlock( static_cast<BlockId>( block ) ).instructions;
+
+    for ( size_t index = 0; index < instructions.size(); index++ ) {
+      const Instruction& instruction = instructions[index];
+
+      if (
+        ( instruction.opcode == Opcode::OpCall || instruction.opcode == Opcode::OpTailCall ) &&
+        _indices.count( std::string( interner.getName( instruction.callee ) ) )
+      ) {
+        sites.push_back( { static_cast<BlockId>( block ), index } );
+      }
+    }
+  }
+
+  return sites;
+}
+
+const Instruction& siteInstruction( const IrFunction& _function, const std::pair<BlockId, size_t>& _site ) {
+  return _function.getBlock( _site.first ).instructions[_site.second];
+}
+
+size_t calleeIndex(
+  const IrFunction& _function,
+  const std::pair<BlockId, size_t>& _site,
+  const std::unordered_map<std::string, size_t>& _indices
+) {
+  return _indices.at( std::string( interner.getName( siteInstruction( _function, _site ).callee ) ) );
+}
+
+/* every function _function calls before it, depth first, so whatever a callee inlines is inlined along with it */
+void orderCallees(
+  const size_t _function,
+  const std::vector<IrFunction>& _functions,
+  const std::unordered_map<std::string, size_t>& _indices,
+  std::vector<bool>& _visited,
+  std::vector<size_t>& _order
+) {
+  _visited[_function] = true;
+
+  for ( const std::pair<BlockId, size_t>& site : callSites( _functions[_function], _indices ) ) {
+    size_t callee = calleeIndex( _functions[_function], site, _indices );
+
+    if ( !_visited[callee] ) orderCallees( callee, _functions, _indices, _visited, _order );
+  }
+
+  _order.push_back( _function );
+}
+
+/*
+ * inlines the calls between the functions of a module, the module's own function first among them; returns how many
+ * call sites were inlined
+ */
+uint32_t inlineFunctions( std::vector<IrFunction>& _functions ) {
+  std::unordered_map<std::string, size_t> indices;
+  std::vector<bool> visited( _functions.size(), false );
+  std::vector<size_t> order;
+  std::vector<bool> called( _functions.size(), false );
+  std::vector<size_t> reached = { 0 };
+  uint32_t inlined = 0;
+
+  for ( size_t function = 0; function < _functions.size(); function++ ) {
+    indices[_functions[function].getName()] = function;
+  }
+
+  for ( size_t function = 0; function < _functions.size(); function++ ) {
+    if ( !visited[function] ) orderCallees( function, _functions, indices, visited, order );
+  }
+
+  for ( size_t function : order ) {
+    IrFunction& caller = _functions[function];
+    std::vector<std::pair<BlockId, size_t>> sites = callSites( caller, indices );
+
+    /* last first, splitting a block leaves the calls before the split where they are */
+    for ( size_t site = sites.size(); site > 0; site-- ) {
+      size_t callee = calleeIndex( caller, sites[site - 1], indices );
+      const Instruction& call = siteInstruction( caller, sites[site - 1] );
+
+      if (
+        callee == function || !inlinable( _functions[callee] ) ||
+        !signatureMatches( caller, call, _functions[callee] )
+      ) {
+        continue;
+      }
+
+      inlineCall( caller, sites[site - 1].first, sites[site - 1].second, _functions[callee] );
+      inlined++;
+    }
+  }
+
+  /* only functions still called from the module's own function, however indirectly, are kept */
+  called[0] = true;
+
+  while ( !reached.empty() ) {
+    size_t function = reached.back();
+    reached.pop_back();
+
+    for ( const std::pair<BlockId, size_t>& site : callSites( _functions[function], indices ) ) {
+      size_t callee = calleeIndex( _functions[function], site, indices );
+
+      if ( !called[callee] ) {
+        called[callee] = true;
+        reached.push_back( callee );
+      }
+    }
+  }
+
+  for ( size_t function = _functions.size(); function > 1; function-- ) {
+    if ( !called[function - 1] ) _functions.erase( _functions.begin() + static_cast<std::ptrdiff_t>( function - 1 ) );
+  }
+
+  return inlined;
+}
+
+#endif
@@ -0,0 +1,310 @@
+#ifndef _IR_HPP
+#define _IR_HPP
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "parser/classifier.hpp"
+#include "shared/symbols.hpp"
+#include "shared/types.hpp"
+
+/*
+ * linear SSA form a module is lowered to ( see compiler/lower.hpp ) and instructions are selected from; a function
+ * is a list of basic blocks, each a run of instructions ending in a single jump, branch or return, and every value is
+ * a virtual register defined by exactly one instruction; where control flow joins, phis at the head of the block pick
+ * the value that flowed in from each predecessor
+ */
+
+/* a virtual register */
+typedef uint32_t Value;
+
+const Value NO_VALUE = UINT32_MAX;
+
+typedef uint32_t BlockId;
+
+const BlockId NO_BLOCK = UINT32_MAX;
+
+enum Opcode {
+  /* loads word */
+  OpConstant,
+  /* operands[0] operation operands[1] */
+  OpBinary,
+  /* one operand per predecessor of its block, in the order the predecessors are listed */
+  OpPhi,
+  /* calls callee with the operands as arguments */
+  OpCall,
+  /* the argument the function was called with at index word, at the head of its first block */
+  OpParameter,
+  /* the integer operands[0] holds, shifted out of its tag, which only a multiplication reads as its right operand */
+  OpUntag,
+
+  /* terminators, the last instruction of every block and only there */
+  OpJump,
+  OpBranch,
+  OpReturn,
+  /* returns whatever callee returns when called with the operands, jumping to it in place of the function */
+  OpTailCall,
+};
+
+struct Instruction {
+  Opcode opcode;
+  /* value type of the result, void for an instruction without one */
+  ValueType type;
+  Value result;
+  OperatorId operation;
+  /* the word a constant loads, tagged as the generated code holds it */
+  int64_t word;
+  Symbol callee;
+  std::vector<Value> operands;
+  /* where a jump goes, or where a branch goes when its operand is true and when it is not */
+  BlockId targets[2];
+};
+
+struct BasicBlock {
+  /* phis first, the terminator last */
+  std::vector<Instruction> instructions;
+  std::vector<BlockId> predecessors;
+};
+
+/* a terminator without successors */
+bool leavesFunction( const Opcode _opcode ) {
+  return _opcode == Opcode::OpReturn || _opcode == Opcode::OpTailCall;
+}
+
+bool isTerminator( const Opcode _opcode ) {
+  return _opcode == Opcode::OpJump || _opcode == Opcode::OpBranch || leavesFunction( _opcode );
+}
+
+class IrFunction {
+  private:
+    std::string name;
+    std::vector<BasicBlock> blocks;
+    /* value type of every value, by value */
+    std::vector<ValueType> valueTypes;
+    Inlining inlining;
+
+  public:
+    IrFunction( const std::string _name ) : name( _name ), inlining( Inlining::InlineByCost ) {}
+
+    const std::string& getName() const {
+      return name;
+    }
+
+    Inlining getInlining() const {
+      return inlining;
+    }
+
+    void setInlining( const Inlining _inlining ) {
+      inlining = _inlining;
+    }
+
+    BlockId addBlock() {
+      blocks.emplace_back();
+      return static_cast<BlockId>( blocks.size() - 1 );
+    }
+
+    BasicBlock& getBlock( const BlockId _block ) {
+      return blocks[_block];
+    }
+
+    const BasicBlock& getBlock( const BlockId _block ) const {
+      return blocks[_block];
+    }
+
+    size_t blockCount() const {
+      return blocks.size();
+    }
+
+    size_t valueCount() const {
+      return valueTypes.size();
+    }
+
+    ValueType getValueType( const Value _value ) const {
+      return valueTypes[_value];
+    }
+
+    /* appends _instruction to _block, giving it a fresh result unless it is void; phis go after the other phis */
+    Value append( const BlockId _block, Instruction _instruction ) {
+      std::vector<Instruction>& instructions = blocks[_block].instructions;
+
+      if ( _instruction.type != ValueType::ValueVoid ) {
+        _instruction.result = static_cast<Value>( valueTypes.size() );
+        valueTypes.push_back( _instruction.type );
+      }
+
+      if ( _instruction.opcode == Opcode::OpJump || _instruction.opcode == Opcode::OpBranch ) {
+        for ( BlockId target : _instruction.targets ) {
+          if ( target != NO_BLOCK ) blocks[target].predecessors.push_back( _block );
+        }
+      }
+
+      if ( _instruction.opcode == Opcode::OpPhi ) {
+        auto position = instructions.begin();
+
+        while ( position != instructions.end() && position->opcode == Opcode::OpPhi ) {
+          position++;
+        }
+
+        instructions.insert( position, _instruction );
+      } else {
+        instructions.push_back( _instruction );
+      }
+
+      return _instruction.result;
+    }
+
+    /* blocks reachable from the first, each placed after every block that dominates it */
+    std::vector<BlockId> reversePostorder() const {
+      std::vector<BlockId> postorder;
+      std::vector<bool> visited( blocks.size(), false );
+      /* each block with how many of its successors are still to be visited, taken successors last */
+      std::vector<std::pair<BlockId, size_t>> stack;
+
+      if ( blocks.empty() ) {
+        return postorder;
+      }
+
+      stack.push_back( { 0, 2 } );
+      visited[0] = true;
+
+      while ( !stack.empty() ) {
+        std::pair<BlockId, size_t>& top = stack.back();
+        const Instruction& terminator = blocks[top.first].instructions.back();
+
+        if ( top.second == 0 || leavesFunction( terminator.opcode ) ) {
+          postorder.push_back( top.first );
+          stack.pop_back();
+          continue;
+        }
+
+        BlockId successor = terminator.targets[--top.second];
+
+        if ( successor != NO_BLOCK && !visited[successor] ) {
+          visited[successor] = true;
+          stack.push_back( { successor, 2 } );
+        }
+      }
+
+      return std::vector<BlockId>( postorder.rbegin(), postorder.rend() );
+    }
+};
+
+Instruction makeInstruction( const Opcode _opcode, const ValueType _type = ValueType::ValueVoid ) {
+  return { _opcode, _type, NO_VALUE, OperatorId::OperatorNone, 0, NO_SYMBOL, {}, { NO_BLOCK, NO_BLOCK } };
+}
+
+/* the instruction defining each value, by value, for as long as _function is left as it is */
+std::vector<const Instruction*> definitions( const IrFunction& _function ) {
+  std::vector<const Instruction*> defined( _function.valueCount(), nullptr );
+
+  for ( size_t block = 0; block < _function.blockCount(); block++ ) {
+    for ( const Instruction& instruction : _function.getBlock( static_cast<BlockId>( block ) ).instructions ) {
+      if ( instruction.result != NO_VALUE ) defined[instruction.result] = &instruction;
+    }
+  }
+
+  return defined;
+}
+
+std::string formatIrValue( const Value _value ) {
+  return "%" + std::to_string( _value );
+}
+
+std::string formatIrBlock( const BlockId _block ) {
+  return "block" + std::to_string( _block );
+}
+
+/* a constant as written in the source, rather than as the tagged word */
+std::string formatIrWord( const ValueType _type, const int64_t _word ) {
+  if ( _type == ValueType::ValueBoolean ) {
+    return _word == -1 ? "true" : "false";
+  }
+
+  return std::to_string( _word >> 1 );
+}
+
+/* textual form of a function, as kubicc --emit-ir prints it */
+std::string dumpIr( const IrFunction& _function ) {
+  std::stringstream dump;
+
+  dump << "function " << _function.getName() << std::endl;
+
+  for ( BlockId block : _function.reversePostorder() ) {
+    const BasicBlock& basicBlock = _function.getBlock( block );
+
+    dump << formatIrBlock( block ) << ":";
+
+    for ( size_t index = 0; index < basicBlock.predecessors.size(); index++ ) {
+      dump << ( index == 0 ? "  ; from " : ", " ) << formatIrBlock( basicBlock.predecessors[index] );
+    }
+
+    dump << std::endl;
+
+    for ( const Instruction& instruction : basicBlock.instructions ) {
+      dump << "  ";
+
+      if ( instruction.result != NO_VALUE ) {
+        dump << formatIrValue( instruction.result ) << " = " << translateFromValueType( instruction.type ) << " ";
+      }
+
+      switch ( instruction.opcode ) {
+        case Opcode::OpConstant:
+          dump << formatIrWord( instruction.type, instruction.word );
+          break;
+        case Opcode::OpBinary:
+          dump << formatIrValue( instruction.operands[0] ) << " " << operatorText( instruction.operation ) << " "
+               << formatIrValue( instruction.operands[1] );
+          break;
+        case Opcode::OpPhi:
+          dump << "phi";
+
+          for ( size_t index = 0; index < instruction.operands.size(); index++ ) {
+            dump << ( index == 0 ? " " : ", " ) << "[ " << formatIrValue( instruction.operands[index] ) << ", "
+                 << formatIrBlock( basicBlock.predecessors[index] ) << " ]";
+          }
+          break;
+        case Opcode::OpParameter:
+          dump << "parameter " << instruction.word;
+          break;
+        case Opcode::OpUntag:
+          dump << "untag " << formatIrValue( instruction.operands[0] );
+          break;
+        case Opcode::OpTailCall:
+          dump << "tail ";
+          /* fall through */
+        case Opcode::OpCall:
+          dump << "call " << interner.getName( instruction.callee ) << "(";
+
+          for ( size_t index = 0; index < instruction.operands.size(); index++ ) {
+            dump << ( index == 0 ? " " : ", " ) << formatIrValue( instruction.operands[index] );
+          }
+
+          dump << ( instruction.operands.empty() ? ")" : " )" );
+          break;
+        case Opcode::OpJump:
+          dump << "jump " << formatIrBlock( instruction.targets[0] );
+          break;
+        case Opcode::OpBranch:
+          dump << "branch " << formatIrValue( instruction.operands[0] ) << ", "
+               << formatIrBlock( instruction.targets[0] ) << ", " << formatIrBlock( instruction.targets[1] );
+          break;
+        case Opcode::OpReturn:
+          dump << "return";
+
+          if ( !instruction.operands.empty() ) {
+            dump << " " << formatIrValue( instruction.operands[0] );
+          }
+          break;
+      }
+
+      dump << std::endl;
+    }
+  }
+
+  return dump.str();
+}
+
+#endif
@@ -0,0 +1,237 @@
+#ifndef _LOOPS_HPP
+#define _LOOPS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "compiler/ir.hpp"
+#include "shared/types.hpp"
+
+/*
+ * loop-invariant code motion over the IR of a function before instructions are selected; a loop is found by the jump
+ * back to its head, and what its body computes from values defined outside of it alone is computed once instead, in
+ * the block that enters the loop, so nested loops leave each invariant in the outermost loop it is invariant in; a
+ * constant is only copied there for what is hoisted to read, as every other reader takes it as an immediate
+ *
+ * a multiplication untags one of its operands ( see compiler/select.hpp ), which for an invariant operand is done
+ * once ahead of the loop too, leaving a single imul in the body
+ */
+
+/* whether _instruction may be computed ahead of the loop it is in, before anything decides it is computed at all */
+bool hoistable( const Instruction& _instruction ) {
+  if ( _instruction.opcode == Opcode::OpUntag ) {
+    return true;
+  }
+
+  /* a division may fault, and a comparison is left where the branch reading it sets the flags */
+  return _instruction.opcode == Opcode::OpBinary && _instruction.operation != OperatorId::OperatorDivide &&
+         !isComparison( _instruction.operation );
+}
+
+/* the blocks of the loop of _head that jump back to it from _latch, the head included */
+std::vector<bool> loopBlocks( const IrFunction& _function, const BlockId _head, const BlockId _latch ) {
+  std::vector<bool> blocks( _function.blockCount(), false );
+  std::vector<BlockId> pending = { _latch };
+
+  blocks[_head] = true;
+
+  while ( !pending.empty() ) {
+    BlockId block = pending.back();
+    pending.pop_back();
+
+    if ( blocks[block] ) continue;
+
+    blocks[block] = true;
+    pending.insert(
+      pending.end(), _function.getBlock( block ).predecessors.begin(), _function.getBlock( block ).predecessors.end()
+    );
+  }
+
+  return blocks;
+}
+
+/* moves _instruction to the end of _preheader, ahead of its jump into the loop */
+void moveAhead( IrFunction& _function, const BlockId _preheader, const Instruction& _instruction ) {
+  std::vector<Instruction>& instructions = _function.getBlock( _preheader ).instructions;
+
+  instructions.insert( instructions.end() - 1, _instruction );
+}
+
+/* appends a new _instruction to _preheader, ahead of its jump into the loop, returning its result */
+Value appendAhead( IrFunction& _function, const BlockId _preheader, const Instruction& _instruction ) {
+  Instruction jump = _function.getBlock( _preheader ).instructions.back();
+  Value result;
+
+  _function.getBlock( _preheader ).instructions.pop_back();
+  result = _function.append( _preheader, _instruction );
+  _function.getBlock( _preheader ).instructions.push_back( jump );
+
+  return result;
+}
+
+/* _value untagged in _preheader, once for each loop */
+Value untagAhead(
+  IrFunction& _function,
+  const BlockId _preheader,
+  const Value _value,
+  std::unordered_map<Value, Value>& _untagged
+) {
+  if ( !_untagged.count( _value ) ) {
+    Instruction untag = makeInstruction( Opcode::OpUntag, ValueType::ValueConstant );
+
+    untag.operands.push_back( _value );
+    _untagged[_value] = appendAhead( _function, _preheader, untag );
+  }
+
+  return _untagged[_value];
+}
+
+/* hoists out of the loop of _head what it computes the same on every iteration, false if it has no preheader */
+bool hoistLoop( IrFunction& _function, const BlockId _head, const std::vector<bool>& _loop ) {
+  std::vector<BlockId> outside;
+  std::vector<bool> variant( _function.valueCount(), false );
+  std::vector<bool> untag( _function.valueCount(), false );
+  /* constants by value, and the copy of each in the preheader */
+  std::unordered_map<Value, Instruction> constants;
+  std::unordered_map<Value, Value> copies;
+  std::unordered_map<Value, Value> untagged;
+
+  for ( BlockId predecessor : _function.getBlock( _head ).predecessors ) {
+    if ( !_loop[predecessor] ) outside.push_back( predecessor );
+  }
+
+  /* a single block entering the loop, which only jumps to its head */
+  if ( outside.size() != 1 || _function.getBlock( outside[0] ).instructions.back().opcode != Opcode::OpJump ) {
+    return false;
+  }
+
+  BlockId preheader = outside[0];
+
+  for ( size_t block = 0; block < _function.blockCount(); block++ ) {
+    if ( !_loop[block] ) continue;
+
+    for ( const Instruction& instruction : _function.getBlock( static_cast<BlockId>( block ) ).instructions ) {
+      if ( instruction.result != NO_VALUE ) variant[instruction.result] = true;
+    }
+  }
+
+  for ( size_t block = 0; block < _function.blockCount(); block++ ) {
+    for ( const Instruction& instruction : _function.getBlock( static_cast<BlockId>( block ) ).instructions ) {
+      if ( instruction.opcode == Opcode::OpConstant ) constants.insert( { instruction.result, instruction } );
+      if ( instruction.opcode == Opcode::OpUntag ) untag[instruction.result] = true;
+    }
+  }
+
+  /* in the order the blocks run, so an operand is hoisted before what reads it */
+  for ( BlockId block : _function.reversePostorder() ) {
+    if ( !_loop[block] ) continue;
+
+    std::vector<Instruction>& instructions = _function.getBlock( block ).instructions;
+
+    for ( size_t index = 0; index < instructions.size(); ) {
+      Instruction& instruction = instructions[index];
+      bool invariant = hoistable( instruction ) && std::none_of(
+        instruction.operands.begin(), instruction.operands.end(), [ &variant, &constants ]( const Value _operand ) {
+          return variant[_operand] && !constants.count( _operand );
+        }
+      );
+
+      if ( invariant ) {
+        for ( Value& operand : instruction.operands ) {
+          if ( !variant[operand] ) continue;
+
+          if ( !copies.count( operand ) ) copies[operand] = appendAhead( _function, preheader, constants[operand] );
+
+          operand = copies[operand];
+        }
+
+        variant.resize( _function.valueCount(), false );
+        untag.resize( _function.valueCount(), false );
+
+        variant[instruction.result] = false;
+        moveAhead( _function, preheader, instruction );
+        instructions.erase( instructions.begin() + static_cast<std::ptrdiff_t>( index ) );
+        continue;
+      }
+
+      if (
+        instruction.opcode == Opcode::OpBinary && instruction.operation == OperatorId::OperatorMultiply &&
+        !untag[instruction.operands[1]]
+      ) {
+        size_t fixed = variant[instruction.operands[0]] ? 1 : 0;
+        Value operand = instruction.operands[fixed];
+
+        /* a constant factor is strength reduced or multiplied by as an immediate instead */
+        if ( !variant[operand] && !constants.count( operand ) ) {
+          instruction.operands[0] = instruction.operands[1 - fixed];
+          instruction.operands[1] = untagAhead( _function, preheader, operand, untagged );
+          variant.resize( _function.valueCount(), false );
+          untag.resize( _function.valueCount(), true );
+        }
+      }
+
+      index++;
+    }
+  }
+
+  return true;
+}
+
+/*
+ * hoists the invariants of every loop of _function, inner loops first, which leaves what an inner loop hoisted in a
+ * block of the loop around it, to be hoisted further from there
+ */
+void hoistLoopInvariants( IrFunction& _function ) {
+  std::vector<BlockId> order = _function.reversePostorder();
+  std::vector<uint32_t> position( _function.blockCount(), UINT32_MAX );
+  /* heads of loops, each with the blocks jumping back to it */
+  std::vector<std::pair<BlockId, std::vector<BlockId>>> loops;
+
+  for ( size_t index = 0; index < order.size(); index++ ) {
+    position[order[index]] = static_cast<uint32_t>( index );
+  }
+
+  for ( BlockId block : order ) {
+    const Instruction& terminator = _function.getBlock( block ).instructions.back();
+
+    if ( leavesFunction( terminator.opcode ) ) continue;
+
+    for ( BlockId target : terminator.targets ) {
+      if ( target == NO_BLOCK || position[target] > position[block] ) continue;
+
+      auto loop = std::find_if( loops.begin(), loops.end(), [ target ]( const auto& _loop ) {
+        return _loop.first == target;
+      } );
+
+      if ( loop == loops.end() ) {
+        loops.push_back( { target, { block } } );
+      } else {
+        loop->second.push_back( block );
+      }
+    }
+  }
+
+  /* a loop nested in another has its head after the outer one's */
+  std::sort( loops.begin(), loops.end(), [ &position ]( const auto& _left, const auto& _right ) {
+    return position[_left.first] > position[_right.first];
+  } );
+
+  for ( const std::pair<BlockId, std::vector<BlockId>>& loop : loops ) {
+    std::vector<bool> blocks( _function.blockCount(), false );
+
+    for ( BlockId latch : loop.second ) {
+      std::vector<bool> reached = loopBlocks( _function, loop.first, latch );
+
+      for ( size_t block = 0; block < blocks.size(); block++ ) {
+        blocks[block] = blocks[block] || reached[block];
+      }
+    }
+
+    hoistLoop( _function, loop.first, blocks );
+  }
+}
+
+#endif
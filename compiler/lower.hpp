@@ -0,0 +1,619 @@
+#ifndef _LOWER_HPP
+#define _LOWER_HPP
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "compiler/assembly.hpp"
+#include "compiler/ir.hpp"
+#include "compiler/optimizer.hpp"
+#include "parser/node.hpp"
+#include "shared/environment.hpp"
+#include "shared/symbols.hpp"
+
+/*
+ * lowers a resolved and optimized tree to SSA form ( see compiler/ir.hpp ); folded expressions become constants and
+ * dead branches and bindings are never lowered, a variable is no instruction at all but the value its binding's slot
+ * holds at that point, and where a conditional rebinds a slot of an enclosing scope the join gets a phi for it
+ *
+ * every function a module defines is lowered to a function of its own; a return of a call to one of them jumps to
+ * it rather than calling it, and one to the function it returns from jumps back to the head of its body, whose phis
+ * take the arguments in place of the parameters
+ */
+struct Lowering {
+  IrFunction& function;
+  /* NO_BLOCK once a return has ended the block, nothing after it runs */
+  BlockId block;
+  /* value each resolver slot holds at the current point */
+  std::unordered_map<int, Value> slotValues;
+  /* every slot bound so far with the value it held before, undone as each branch ends */
+  std::vector<std::pair<int, Value>> writes;
+  /* slots from here on belong to the innermost scope */
+  int frameTop;
+  /* the functions the module defines, by name */
+  const std::unordered_map<Symbol, const FunctionNode*>& definitions;
+  /* the function lowered, null for a module, and the head of its body, NO_BLOCK unless a tail call jumps back to it */
+  const FunctionNode* definition;
+  BlockId loop;
+  /* arguments of each tail call jumping back to the head, in the order they were lowered */
+  std::vector<std::vector<Value>> loopArguments;
+};
+
+Value lower( Lowering& _lowering, Node* _node );
+
+Value append( Lowering& _lowering, const Instruction _instruction ) {
+  return _lowering.function.append( _lowering.block, _instruction );
+}
+
+Value constant( Lowering& _lowering, const ValueType _type, const int64_t _word ) {
+  Instruction instruction = makeInstruction( Opcode::OpConstant, _type );
+  instruction.word = _word;
+
+  return append( _lowering, instruction );
+}
+
+void jump( Lowering& _lowering, const BlockId _target ) {
+  Instruction instruction = makeInstruction( Opcode::OpJump );
+  instruction.targets[0] = _target;
+
+  append( _lowering, instruction );
+}
+
+void bindSlot( Lowering& _lowering, const int _slot, const Value _value ) {
+  auto bound = _lowering.slotValues.find( _slot );
+
+  _lowering.writes.push_back( { _slot, bound != _lowering.slotValues.end() ? bound->second : NO_VALUE } );
+  _lowering.slotValues[_slot] = _value;
+  _lowering.frameTop = std::max( _lowering.frameTop, _slot + 1 );
+}
+
+Value lower( Lowering& _lowering, VariableNode* _node ) {
+  return _lowering.slotValues.at( _node->getSlot() );
+}
+
+/* a binding nothing loads is not lowered, and its expression only for the calls it makes */
+Value lower( Lowering& _lowering, BindingNode* _node ) {
+  if ( isLive( _node ) ) {
+    bindSlot( _lowering, _node->getSlot(), lower( _lowering, _node->getBindingExpression() ) );
+  } else if ( hasCalls( _node->getBindingExpression() ) ) {
+    lower( _lowering, _node->getBindingExpression() );
+  }
+
+  return NO_VALUE;
+}
+
+/*
+ * up a chain of operators from its innermost, see leftSpine(); an operator that was folded is a constant, and
+ * nothing under it is lowered
+ */
+Value lower( Lowering& _lowering, BinaryOperatorNode* _node ) {
+  std::vector<BinaryOperatorNode*> spine = leftSpine( _node );
+  size_t length = 1;
+  int64_t word;
+
+  while ( length < spine.size() && !foldedWord( spine[length], word ) ) {
+    length++;
+  }
+
+  Value value = lower( _lowering, spine[length - 1]->getLeftOperand() );
+
+  for ( size_t index = length; index > 0; index-- ) {
+    Instruction instruction = makeInstruction( Opcode::OpBinary, spine[index - 1]->getValueType() );
+
+    instruction.operation = spine[index - 1]->getOperator();
+    instruction.operands = { value, lower( _lowering, spine[index - 1]->getRightOperand() ) };
+    value = append( _lowering, instruction );
+  }
+
+  return value;
+}
+
+/*
+ * lowers one branch of a conditional or the body of a loop as a scope of its own, returning the value each slot of
+ * an enclosing scope it rebinds ends up with; the slots are left holding what they held before the branch
+ */
+std::unordered_map<int, Value> lowerBranch(
+  Lowering& _lowering,
+  Node* _body,
+  const int _slot = NO_SLOT,
+  const Value _value = NO_VALUE
+) {
+  std::unordered_map<int, Value> rebound;
+  size_t firstWrite = _lowering.writes.size();
+  int frameBase = _lowering.frameTop;
+
+  /* the loop variable of a counted loop is bound in the scope of the body */
+  if ( _slot != NO_SLOT ) bindSlot( _lowering, _slot, _value );
+
+  lower( _lowering, _body );
+
+  /* newest writes first, so the first one seen for a slot is the value it ends up with */
+  while ( _lowering.writes.size() > firstWrite ) {
+    std::pair<int, Value> write = _lowering.writes.back();
+
+    if ( write.first < frameBase ) rebound.insert( { write.first, _lowering.slotValues[write.first] } );
+
+    if ( write.second == NO_VALUE ) {
+      _lowering.slotValues.erase( write.first );
+    } else {
+      _lowering.slotValues[write.first] = write.second;
+    }
+
+    _lowering.writes.pop_back();
+  }
+
+  _lowering.frameTop = frameBase;
+
+  return rebound;
+}
+
+/* a known condition leaves only the branch that runs, either branch of any other gets a block of its own */
+Value lower( Lowering& _lowering, ConditionalNode* _node ) {
+  Node* branch;
+
+  if ( liveBranch( _node, branch ) ) {
+    for ( std::pair<const int, Value>& slot : lowerBranch( _lowering, branch ) ) {
+      bindSlot( _lowering, slot.first, slot.second );
+    }
+
+    return NO_VALUE;
+  }
+
+  IrFunction& function = _lowering.function;
+  Instruction instruction = makeInstruction( Opcode::OpBranch );
+  BlockId upperBlock = function.addBlock();
+  BlockId lowerBlock = function.addBlock();
+  BlockId joinBlock = function.addBlock();
+
+  instruction.operands = { lower( _lowering, _node->getConditional() ) };
+  instruction.targets[0] = upperBlock;
+  instruction.targets[1] = lowerBlock;
+  append( _lowering, instruction );
+
+  /* both branches end in a jump to the join, so no edge into it leaves a block with another successor */
+  _lowering.block = upperBlock;
+  std::unordered_map<int, Value> upperValues = lowerBranch( _lowering, _node->getUpperBody() );
+  BlockId upperEnd = _lowering.block;
+
+  if ( upperEnd != NO_BLOCK ) jump( _lowering, joinBlock );
+
+  _lowering.block = lowerBlock;
+  std::unordered_map<int, Value> lowerValues = lowerBranch( _lowering, _node->getLowerBody() );
+  BlockId lowerEnd = _lowering.block;
+
+  if ( lowerEnd != NO_BLOCK ) jump( _lowering, joinBlock );
+
+  /* a branch ending in a return never reaches the join, the slots hold what the other one left in them */
+  if ( upperEnd == NO_BLOCK && lowerEnd == NO_BLOCK ) {
+    _lowering.block = NO_BLOCK;
+    return NO_VALUE;
+  } else if ( upperEnd == NO_BLOCK || lowerEnd == NO_BLOCK ) {
+    _lowering.block = joinBlock;
+
+    for ( std::pair<const int, Value>& slot : upperEnd == NO_BLOCK ? lowerValues : upperValues ) {
+      bindSlot( _lowering, slot.first, slot.second );
+    }
+
+    return NO_VALUE;
+  }
+
+  _lowering.block = joinBlock;
+
+  std::vector<int> rebound;
+
+  for ( std::pair<const int, Value>& slot : upperValues ) {
+    rebound.push_back( slot.first );
+  }
+
+  for ( std::pair<const int, Value>& slot : lowerValues ) {
+    if ( !upperValues.count( slot.first ) ) rebound.push_back( slot.first );
+  }
+
+  /* slots are visited in order, so phis come out the same on every compile */
+  std::sort( rebound.begin(), rebound.end() );
+
+  for ( int slot : rebound ) {
+    auto upperFound = upperValues.find( slot );
+    auto lowerFound = lowerValues.find( slot );
+    Value before = _lowering.slotValues[slot];
+    Value upperValue = upperFound != upperValues.end() ? upperFound->second : before;
+    Value lowerValue = lowerFound != lowerValues.end() ? lowerFound->second : before;
+
+    if ( upperValue == lowerValue ) {
+      bindSlot( _lowering, slot, upperValue );
+      continue;
+    }
+
+    Instruction phi = makeInstruction( Opcode::OpPhi, function.getValueType( upperValue ) );
+
+    for ( BlockId predecessor : function.getBlock( joinBlock ).predecessors ) {
+      phi.operands.push_back( predecessor == upperEnd ? upperValue : lowerValue );
+    }
+
+    bindSlot( _lowering, slot, append( _lowering, phi ) );
+  }
+
+  return NO_VALUE;
+}
+
+/* an assignment rebinds the slot of its variable, which a conditional or loop joins as it joins any rebound slot */
+Value lower( Lowering& _lowering, AssignmentNode* _node ) {
+  bindSlot( _lowering, _node->getSlot(), lower( _lowering, _node->getExpression() ) );
+
+  return NO_VALUE;
+}
+
+/* the phis at the head of a loop, each with the slot it joins */
+typedef std::vector<std::pair<int, Value>> LoopPhis;
+
+/*
+ * ends the current block with a jump to _head and gives _head a phi for every slot of an enclosing scope _body
+ * assigns to, taking the value the slot holds before the loop; the slots hold the phis from there on, the way the
+ * head and every run of the body see them
+ */
+LoopPhis enterLoop( Lowering& _lowering, const BlockId _head, const Node* _body ) {
+  std::unordered_set<int> assigned;
+  std::vector<int> slots;
+  LoopPhis phis;
+
+  assignedSlots( _body, assigned );
+
+  /* a slot bound inside the body holds nothing yet, and slots are visited in order for phis to come out the same */
+  for ( int slot : assigned ) {
+    if ( _lowering.slotValues.count( slot ) ) slots.push_back( slot );
+  }
+
+  std::sort( slots.begin(), slots.end() );
+
+  jump( _lowering, _head );
+  _lowering.block = _head;
+
+  for ( int slot : slots ) {
+    Value before = _lowering.slotValues[slot];
+    Instruction phi = makeInstruction( Opcode::OpPhi, _lowering.function.getValueType( before ) );
+
+    phi.operands = { before };
+    phis.push_back( { slot, append( _lowering, phi ) } );
+    bindSlot( _lowering, slot, phis.back().second );
+  }
+
+  return phis;
+}
+
+/* a body that reaches its end jumps back to the head, each phi taking the value its slot was left holding */
+void closeLoop(
+  Lowering& _lowering,
+  const BlockId _head,
+  const LoopPhis& _phis,
+  const std::unordered_map<int, Value>& _rebound
+) {
+  if ( _lowering.block == NO_BLOCK ) return;
+
+  jump( _lowering, _head );
+
+  for ( Instruction& instruction : _lowering.function.getBlock( _head ).instructions ) {
+    for ( const std::pair<int, Value>& phi : _phis ) {
+      if ( instruction.result != phi.second ) continue;
+
+      auto rebound = _rebound.find( phi.first );
+      instruction.operands.push_back( rebound != _rebound.end() ? rebound->second : phi.second );
+    }
+  }
+}
+
+/* a condition known to be false leaves nothing to lower, one known to be true a loop that never exits */
+Value lower( Lowering& _lowering, WhileNode* _node ) {
+  int64_t word;
+  bool known = foldedWord( _node->getConditional(), word );
+
+  if ( known && word != WORD_TRUE ) {
+    return NO_VALUE;
+  }
+
+  IrFunction& function = _lowering.function;
+  BlockId head = function.addBlock();
+  BlockId body = function.addBlock();
+  BlockId exit = known ? NO_BLOCK : function.addBlock();
+  LoopPhis phis = enterLoop( _lowering, head, _node->getBody() );
+
+  if ( known ) {
+    jump( _lowering, body );
+  } else {
+    Instruction instruction = makeInstruction( Opcode::OpBranch );
+
+    instruction.operands = { lower( _lowering, _node->getConditional() ) };
+    instruction.targets[0] = body;
+    instruction.targets[1] = exit;
+    append( _lowering, instruction );
+  }
+
+  _lowering.block = body;
+  std::unordered_map<int, Value> rebound = lowerBranch( _lowering, _node->getBody() );
+  closeLoop( _lowering, head, phis, rebound );
+
+  _lowering.block = exit;
+
+  return NO_VALUE;
+}
+
+/*
+ * the loop variable is a phi at the head, compared with the last bound there and stepped by one at the end of the
+ * body; it stays tagged throughout, a step of one being an add of 2 and the comparison needing no shift at all
+ */
+Value lower( Lowering& _lowering, ForNode* _node ) {
+  IrFunction& function = _lowering.function;
+  Value first = lower( _lowering, _node->getFirst() );
+  Value last = lower( _lowering, _node->getLast() );
+  BlockId head = function.addBlock();
+  BlockId body = function.addBlock();
+  BlockId exit = function.addBlock();
+  LoopPhis phis = enterLoop( _lowering, head, _node->getBody() );
+  Instruction variable = makeInstruction( Opcode::OpPhi, ValueType::ValueConstant );
+  Instruction comparison = makeInstruction( Opcode::OpBinary, ValueType::ValueBoolean );
+  Instruction branch = makeInstruction( Opcode::OpBranch );
+  Instruction step = makeInstruction( Opcode::OpBinary, ValueType::ValueConstant );
+
+  /* the loop variable is joined as no slot, its own slot is only bound inside the body */
+  variable.operands = { first };
+  phis.push_back( { NO_SLOT, append( _lowering, variable ) } );
+
+  comparison.operation = OperatorId::OperatorLess;
+  comparison.operands = { phis.back().second, last };
+  branch.operands = { append( _lowering, comparison ) };
+  branch.targets[0] = body;
+  branch.targets[1] = exit;
+  append( _lowering, branch );
+
+  _lowering.block = body;
+  std::unordered_map<int, Value> rebound = lowerBranch(
+    _lowering, _node->getBody(), _node->getSlot(), phis.back().second
+  );
+
+  if ( _lowering.block != NO_BLOCK ) {
+    step.operation = OperatorId::OperatorAdd;
+    step.operands = { phis.back().second, constant( _lowering, ValueType::ValueConstant, tagInteger( 1 ) ) };
+    rebound[NO_SLOT] = append( _lowering, step );
+  }
+
+  closeLoop( _lowering, head, phis, rebound );
+
+  _lowering.block = exit;
+
+  return NO_VALUE;
+}
+
+/* the function of the module _node calls, null for an external one or anything other than a call */
+const FunctionNode* calledDefinition( const Lowering& _lowering, const Node* _node ) {
+  if ( !_node || _node->getNodeType() != NodeType::NodeFunctionCall ) {
+    return nullptr;
+  }
+
+  auto definition = _lowering.definitions.find( _node->getSymbol() );
+
+  return definition != _lowering.definitions.end() ? definition->second : nullptr;
+}
+
+std::vector<Value> lowerArguments( Lowering& _lowering, const FunctionCallNode* _node ) {
+  std::vector<Value> arguments;
+
+  for ( Node* argument : _node->getArguments() ) {
+    arguments.push_back( lower( _lowering, argument ) );
+  }
+
+  return arguments;
+}
+
+/* a call to a function of the module goes to its symbol, which is local to the module */
+Value lower( Lowering& _lowering, FunctionCallNode* _node ) {
+  Instruction instruction = makeInstruction( Opcode::OpCall, _node->getValueType() );
+  const FunctionNode* definition = calledDefinition( _lowering, _node );
+
+  instruction.callee = definition ? interner.intern( functionSymbol( std::string( _node->getName() ) ) )
+                                  : _node->getSymbol();
+  instruction.operands = lowerArguments( _lowering, _node );
+
+  return append( _lowering, instruction );
+}
+
+/*
+ * a return of a call to a function of the module is a tail call, unless it takes arguments on the stack, which the
+ * caller's frame has no room for; one to the function returned from jumps back to its head
+ */
+Value lower( Lowering& _lowering, ReturnNode* _node ) {
+  Node* expression = _node->getExpression();
+  const FunctionNode* callee = calledDefinition( _lowering, expression );
+  Instruction instruction = makeInstruction( Opcode::OpReturn );
+
+  if ( callee && callee == _lowering.definition ) {
+    _lowering.loopArguments.push_back( lowerArguments( _lowering, (FunctionCallNode*) expression ) );
+    jump( _lowering, _lowering.loop );
+  } else if ( callee && callee->getParameters().size() <= ARGUMENT_REGISTERS.size() ) {
+    instruction = makeInstruction( Opcode::OpTailCall );
+    instruction.callee = interner.intern( functionSymbol( std::string( callee->getName() ) ) );
+    instruction.operands = lowerArguments( _lowering, (FunctionCallNode*) expression );
+    append( _lowering, instruction );
+  } else {
+    Value value = lower( _lowering, expression );
+
+    if ( value != NO_VALUE ) instruction.operands.push_back( value );
+
+    append( _lowering, instruction );
+  }
+
+  _lowering.block = NO_BLOCK;
+
+  return NO_VALUE;
+}
+
+/* the module's init function runs its statements the first time it is called */
+Value lower( Lowering& _lowering, ImportNode* _node ) {
+  Instruction instruction = makeInstruction( Opcode::OpCall );
+  instruction.callee = interner.intern( moduleSymbol( std::string( _node->getPath() ) ) );
+
+  return append( _lowering, instruction );
+}
+
+/* the value _node evaluates to, NO_VALUE for a statement */
+Value lower( Lowering& _lowering, Node* _node ) {
+  int64_t word;
+
+  if ( !_node ) {
+    return NO_VALUE;
+  } else if ( foldedWord( _node, word ) ) {
+    /* known at compile time, see compiler/optimizer.hpp */
+    return constant( _lowering, _node->getValueType(), word );
+  } else if ( _node->getNodeType() == NodeType::NodeVariable ) {
+    return lower( _lowering, (VariableNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeBinding ) {
+    return lower( _lowering, (BindingNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeBinaryOperator ) {
+    return lower( _lowering, (BinaryOperatorNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeMultiStatement ) {
+    for ( Node* statement : ( (MultiStatementNode*) _node )->getStatements() ) {
+      if ( _lowering.block == NO_BLOCK ) break;
+
+      if ( !deadStatement( statement ) ) lower( _lowering, statement );
+    }
+  } else if ( _node->getNodeType() == NodeType::NodeConditional ) {
+    return lower( _lowering, (ConditionalNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeFunctionCall ) {
+    return lower( _lowering, (FunctionCallNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeImport ) {
+    return lower( _lowering, (ImportNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeReturn ) {
+    return lower( _lowering, (ReturnNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeAssignment ) {
+    return lower( _lowering, (AssignmentNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeWhile ) {
+    return lower( _lowering, (WhileNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeFor ) {
+    return lower( _lowering, (ForNode*) _node );
+  }
+
+  /* a function is lowered on its own, see lowerModule(), and the parser makes no unary operators */
+  return NO_VALUE;
+}
+
+/* whether _node returns a call of _function to itself anywhere */
+bool returnsSelfCall( const Node* _node, const FunctionNode* _function ) {
+  if ( !_node ) {
+    return false;
+  } else if ( _node->getNodeType() == NodeType::NodeReturn ) {
+    const Node* expression = ( (ReturnNode*) _node )->getExpression();
+
+    return expression && expression->getNodeType() == NodeType::NodeFunctionCall &&
+           expression->getSymbol() == _function->getSymbol();
+  } else if ( _node->getNodeType() == NodeType::NodeMultiStatement ) {
+    for ( Node* statement : ( (MultiStatementNode*) _node )->getStatements() ) {
+      if ( returnsSelfCall( statement, _function ) ) return true;
+    }
+  } else if ( _node->getNodeType() == NodeType::NodeConditional ) {
+    return returnsSelfCall( ( (ConditionalNode*) _node )->getUpperBody(), _function ) ||
+           returnsSelfCall( ( (ConditionalNode*) _node )->getLowerBody(), _function );
+  } else if ( _node->getNodeType() == NodeType::NodeWhile ) {
+    return returnsSelfCall( ( (WhileNode*) _node )->getBody(), _function );
+  } else if ( _node->getNodeType() == NodeType::NodeFor ) {
+    return returnsSelfCall( ( (ForNode*) _node )->getBody(), _function );
+  }
+
+  return false;
+}
+
+/* a function of the module under its own symbol, its parameters first and a return of nothing last */
+IrFunction lowerFunction(
+  const FunctionNode* _node,
+  const std::unordered_map<Symbol, const FunctionNode*>& _definitions
+) {
+  IrFunction function( functionSymbol( std::string( _node->getName() ) ) );
+  Lowering lowering = { function, function.addBlock(), {}, {}, FRAME_BASE_SLOT, _definitions, _node, NO_BLOCK, {} };
+  std::vector<Value> arguments;
+  std::vector<Value> parameters;
+
+  function.setInlining( _node->getInlining() );
+
+  for ( Node* parameter : _node->getParameters() ) {
+    Instruction instruction = makeInstruction( Opcode::OpParameter, parameter->getValueType() );
+    instruction.word = static_cast<int64_t>( arguments.size() );
+
+    arguments.push_back( append( lowering, instruction ) );
+  }
+
+  parameters = arguments;
+
+  /* the operands of the phis are only known once every tail call jumping back has been lowered */
+  if ( returnsSelfCall( _node->getBody(), _node ) ) {
+    lowering.loop = function.addBlock();
+    jump( lowering, lowering.loop );
+    lowering.block = lowering.loop;
+
+    for ( Value& parameter : parameters ) {
+      parameter = append( lowering, makeInstruction( Opcode::OpPhi, function.getValueType( parameter ) ) );
+    }
+  }
+
+  for ( size_t index = 0; index < parameters.size(); index++ ) {
+    bindSlot( lowering, ( (BindingNode*) _node->getParameters().at( index ) )->getSlot(), parameters[index] );
+  }
+
+  lower( lowering, _node->getBody() );
+
+  if ( lowering.block != NO_BLOCK ) {
+    append( lowering, makeInstruction( Opcode::OpReturn ) );
+  }
+
+  if ( lowering.loop != NO_BLOCK ) {
+    std::vector<Instruction>& phis = function.getBlock( lowering.loop ).instructions;
+
+    for ( size_t index = 0; index < parameters.size(); index++ ) {
+      phis[index].operands = { arguments[index] };
+
+      for ( const std::vector<Value>& loopArguments : lowering.loopArguments ) {
+        phis[index].operands.push_back( loopArguments[index] );
+      }
+    }
+  }
+
+  return function;
+}
+
+/* a whole module as one function under _symbol, optimized first, followed by every function it defines */
+std::vector<IrFunction> lowerModule( Node* _root, const std::string _symbol ) {
+  std::vector<IrFunction> lowered;
+  std::unordered_map<Symbol, const FunctionNode*> definitions;
+  std::vector<const FunctionNode*> order;
+
+  if ( _root && _root->getNodeType() == NodeType::NodeMultiStatement ) {
+    for ( Node* statement : ( (MultiStatementNode*) _root )->getStatements() ) {
+      if ( statement->getNodeType() != NodeType::NodeFunction ) continue;
+
+      definitions[statement->getSymbol()] = (FunctionNode*) statement;
+      order.push_back( (FunctionNode*) statement );
+    }
+  }
+
+  lowered.emplace_back( _symbol );
+
+  Lowering lowering = {
+    lowered.back(), lowered.back().addBlock(), {}, {}, FRAME_BASE_SLOT, definitions, nullptr, NO_BLOCK, {}
+  };
+
+  optimize( _root );
+  lower( lowering, _root );
+
+  /* a loop that never exits leaves no block to return from */
+  if ( lowering.block != NO_BLOCK ) {
+    append( lowering, makeInstruction( Opcode::OpReturn ) );
+  }
+
+  for ( const FunctionNode* definition : order ) {
+    lowered.push_back( lowerFunction( definition, definitions ) );
+  }
+
+  return lowered;
+}
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef _MODULES_HPP
+#define _MODULES_HPP
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "compiler/compiler.hpp"
+#include "parser/parser.hpp"
+#include "shared/errors.hpp"
+#include "shared/threadpool.hpp"
+
+/* lists the assembly file of every module, so the driver knows what to assemble and link */
+const std::string MODULE_LIST_FILENAME = "main.modules";
+
+struct Module {
+  std::string path;
+  /* kubic_main for the entry module, the module's init function otherwise */
+  std::string symbol;
+  std::vector<std::pair<Module*, SourceLocation>> imports;
+  std::string assembly;
+  /* textual IR, only kept when it is to be printed */
+  std::string ir;
+  /* call sites inlined into the module's code */
+  uint32_t inlined = 0;
+  std::vector<LogEntry> errors;
+};
+
+/*
+ * the entry module and everything it imports, each module is lexed, parsed and compiled as one task on the pool;
+ * modules only refer to each other by symbol, so a module is compiled as soon as it is found rather than once its
+ * imports are, and the import graph is only needed to find the modules and check that it has no cycles
+ */
+class ModuleGraph {
+  private:
+    std::map<std::string, std::unique_ptr<Module>> modules;
+    std::mutex registering;
+    ThreadPool pool;
+    bool emitIr;
+
+    /* the module at _path, and whether it was seen for the first time */
+    std::pair<Module*, bool> require( const std::string _path ) {
+      std::lock_guard<std::mutex> lock( registering );
+      std::unique_ptr<Module>& module = modules[_path];
+
+      if ( module ) {
+        return { module.get(), false };
+      }
+
+      module = std::make_unique<Module>();
+      module->path = _path;
+      module->symbol = moduleSymbol( _path );
+
+      return { module.get(), true };
+    }
+
+    void buildModule( Module* _module ) {
+      /* a worker's environment still holds whatever module it compiled last */
+      resetEnvironment();
+
+      TokenStream tokens( sourceManager.load( _module->path ) );
+      Node* root = nodeifyStatements( tokens );
+      std::vector<ImportNode*> imports;
+
+      tokens.dropErrorsPastStop();
+
+      resolve( root );
+
+      collectImports( root, imports );
+
+      for ( ImportNode* import : imports ) {
+        std::string path( import->getPath() );
+
+        if ( !std::filesystem::is_regular_file( path ) ) {
+          log( Severity::Error, import->getLocation(), ERR_MODULE_NOT_FOUND, path );
+          continue;
+        }
+
+        std::pair<Module*, bool> required = require( path );
+        _module->imports.push_back( { required.first, import->getLocation() } );
+
+        if ( required.second ) {
+          pool.submit( [ this, required ] { buildModule( required.first ); } );
+        }
+      }
+
+      if ( emptyErrorsLog() ) {
+        _module->assembly = compileModule( root, _module->symbol, emitIr ? &_module->ir : nullptr, &_module->inlined );
+      }
+
+      _module->errors = takeErrors();
+      nodeArena.clear();
+    }
+
+    /* depth first, an import of a module still on the path back to the entry closes a cycle */
+    void checkCycles( Module* _module, std::map<Module*, bool>& _visiting ) {
+      _visiting[_module] = true;
+
+      for ( std::pair<Module*, SourceLocation>& import : _module->imports ) {
+        auto visited = _visiting.find( import.first );
+
+        if ( visited == _visiting.end() ) {
+          checkCycles( import.first, _visiting );
+        } else if ( visited->second ) {
+          boost::format message( ERR_IMPORT_CYCLE );
+          _module->errors.push_back( LogEntry( ( message % import.first->path ).str(), import.second ) );
+        }
+      }
+
+      _visiting[_module] = false;
+    }
+
+  public:
+    ModuleGraph( const bool _emitIr = false ) : pool( std::thread::hardware_concurrency() ), emitIr( _emitIr ) {}
+
+    /*
+     * compiles _filename and every module it imports, false if any of them has errors, which are left logged; the IR
+     * of every module is printed as well when asked for, entry first, then by path
+     */
+    bool build( const std::string _filename ) {
+      std::string entryPath = std::filesystem::path( _filename ).lexically_normal().string();
+      Module* entry = require( entryPath ).first;
+      entry->symbol = "kubic_main";
+
+      pool.submit( [ this, entry ] { buildModule( entry ); } );
+      pool.wait();
+
+      std::map<Module*, bool> visiting;
+      checkCycles( entry, visiting );
+
+      /* errors are reported entry first, then by path, however the modules were scheduled */
+      restoreErrors( entry->errors );
+
+      for ( auto& module : modules ) {
+        if ( module.second.get() != entry ) restoreErrors( module.second->errors );
+      }
+
+      if ( !emptyErrorsLog() ) {
+        return false;
+      }
+
+      std::ofstream moduleList( MODULE_LIST_FILENAME );
+      std::ofstream( "main.ka" ) << entry->assembly;
+      moduleList << "main.ka" << std::endl;
+      std::cout << entry->ir;
+
+      for ( auto& module : modules ) {
+        if ( module.second.get() == entry ) continue;
+
+        std::cout << module.second->ir;
+
+        std::ofstream( module.second->symbol + ".ka" ) << module.second->assembly;
+        module.second->assembly.clear();
+        moduleList << module.second->symbol << ".ka" << std::endl;
+      }
+
+      return true;
+    }
+
+    /* call sites inlined into every module built, entry first, then by path */
+    std::string inlineReport() {
+      std::stringstream report;
+
+      report << "inlined call sites --" << std::endl;
+
+      for ( bool entry : { true, false } ) {
+        for ( auto& module : modules ) {
+          if ( ( module.second->symbol == "kubic_main" ) != entry ) continue;
+
+          report << "  " << module.first << " :: " << module.second->inlined << std::endl;
+        }
+      }
+
+      return report.str();
+    }
+};
+
+#endif
@@ -0,0 +1,385 @@
+#ifndef _OPTIMIZER_HPP
+#define _OPTIMIZER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "compiler/assembly.hpp"
+#include "parser/node.hpp"
+#include "shared/types.hpp"
+
+/*
+ * constant folding and propagation, then dead code elimination, over a resolved tree right before codegen
+ *
+ * every expression whose value is known at compile time is recorded with the 64-bit word the generated code would
+ * have left in rax for it, tagged integers included, and lowering loads that word instead of computing it; a branch
+ * whose condition is known never runs or always does, and a binding is only lowered if a load is left that reads it
+ *
+ * the tree itself is left as it is, watch mode compiles the same document again after every edit
+ */
+static thread_local std::unordered_map<NodeRef, int64_t> foldedWords;
+
+/* word held by each stack slot whose binding is known, slots are reused once a scope ends and are rebound then */
+static thread_local std::unordered_map<int, int64_t> slotWords;
+
+/* binding each stack slot holds at the current point of the walk */
+static thread_local std::unordered_map<int, NodeRef> slotBindings;
+
+static thread_local std::unordered_set<NodeRef> liveBindings;
+
+int64_t tagInteger( const int64_t _value ) {
+  return static_cast<int64_t>( static_cast<uint64_t>( _value ) << 1 );
+}
+
+int64_t booleanWord( const bool _value ) {
+  return _value ? WORD_TRUE : WORD_FALSE;
+}
+
+/* the word _node always evaluates to, false when it is only known at run time */
+bool foldedWord( const Node* _node, int64_t& _word ) {
+  if ( _node->getNodeType() == NodeType::NodeConstant ) {
+    _word = tagInteger( ( (ConstantNode*) _node )->getValue() );
+    return true;
+  } else if ( _node->getNodeType() == NodeType::NodeBoolean ) {
+    _word = booleanWord( ( (BooleanNode*) _node )->getValue() );
+    return true;
+  }
+
+  auto folded = foldedWords.find( _node->getRef() );
+
+  if ( folded == foldedWords.end() ) {
+    return false;
+  }
+
+  _word = folded->second;
+  return true;
+}
+
+/* the word _operator leaves in rax for two operand words, false when it has to be left to run time */
+bool foldBinary( const OperatorId _operator, const int64_t _left, const int64_t _right, int64_t& _word ) {
+  uint64_t left = static_cast<uint64_t>( _left );
+  uint64_t right = static_cast<uint64_t>( _right );
+
+  switch ( _operator ) {
+    case OperatorId::OperatorAdd:
+      _word = static_cast<int64_t>( left + right );
+      return true;
+    case OperatorId::OperatorSubtract:
+      _word = static_cast<int64_t>( left - right );
+      return true;
+    case OperatorId::OperatorMultiply:
+      /* both words are tagged, one is untagged first */
+      _word = static_cast<int64_t>( left * static_cast<uint64_t>( _right >> 1 ) );
+      return true;
+    case OperatorId::OperatorDivide:
+      /* a division by zero is left to fault at run time */
+      if ( ( _right >> 1 ) == 0 ) {
+        return false;
+      }
+
+      _word = tagInteger( ( _left >> 1 ) / ( _right >> 1 ) );
+      return true;
+    case OperatorId::OperatorLess:
+      _word = booleanWord( _left < _right );
+      return true;
+    case OperatorId::OperatorGreater:
+      _word = booleanWord( _left > _right );
+      return true;
+    case OperatorId::OperatorLessEqual:
+      _word = booleanWord( _left <= _right );
+      return true;
+    case OperatorId::OperatorGreaterEqual:
+      _word = booleanWord( _left >= _right );
+      return true;
+    case OperatorId::OperatorEqual:
+      _word = booleanWord( _left == _right );
+      return true;
+    case OperatorId::OperatorNotEqual:
+      _word = booleanWord( _left != _right );
+      return true;
+    case OperatorId::OperatorAnd:
+      _word = booleanWord( _left == WORD_TRUE && _right == WORD_TRUE );
+      return true;
+    case OperatorId::OperatorOr:
+      _word = booleanWord( _left == WORD_TRUE || _right == WORD_TRUE );
+      return true;
+    case OperatorId::OperatorXor:
+      _word = booleanWord( ( _left == WORD_TRUE ) != ( _right == WORD_TRUE ) );
+      return true;
+    default:
+      return false;
+  }
+}
+
+/* whether evaluating _node can do anything besides leave a value in rax */
+bool hasCalls( const Node* _node ) {
+  if ( !_node ) {
+    return false;
+  } else if ( _node->getNodeType() == NodeType::NodeFunctionCall ) {
+    return true;
+  } else if ( _node->getNodeType() == NodeType::NodeUnaryOperator ) {
+    return hasCalls( ( (UnaryOperatorNode*) _node )->getOperand() );
+  } else if ( _node->getNodeType() == NodeType::NodeBinaryOperator ) {
+    std::vector<BinaryOperatorNode*> spine = leftSpine( (BinaryOperatorNode*) _node );
+
+    return hasCalls( spine.back()->getLeftOperand() ) || std::any_of(
+      spine.begin(), spine.end(), []( const BinaryOperatorNode* _operator ) {
+        return hasCalls( _operator->getRightOperand() );
+      }
+    );
+  }
+
+  return false;
+}
+
+/* an expression on its own as a statement, whose value nothing reads */
+bool deadStatement( const Node* _node ) {
+  switch ( _node->getNodeType() ) {
+    case NodeType::NodeBoolean:
+    case NodeType::NodeConstant:
+    case NodeType::NodeVariable:
+    case NodeType::NodeUnaryOperator:
+    case NodeType::NodeBinaryOperator:
+      return !hasCalls( _node );
+    default:
+      return false;
+  }
+}
+
+/* the branch that always runs when the condition is known, which may be null */
+bool liveBranch( const ConditionalNode* _node, Node*& _branch ) {
+  int64_t word;
+
+  if ( !_node->getConditional() || !foldedWord( _node->getConditional(), word ) ) {
+    return false;
+  }
+
+  _branch = word == WORD_TRUE ? _node->getUpperBody() : _node->getLowerBody();
+  return true;
+}
+
+bool isLive( const BindingNode* _node ) {
+  return liveBindings.count( _node->getRef() ) > 0;
+}
+
+void fold( Node* _node );
+
+/* a variable left to load keeps its binding alive */
+void fold( VariableNode* _node ) {
+  auto bound = slotWords.find( _node->getSlot() );
+
+  if ( bound != slotWords.end() ) {
+    foldedWords[_node->getRef()] = bound->second;
+    return;
+  }
+
+  auto binding = slotBindings.find( _node->getSlot() );
+
+  if ( binding != slotBindings.end() ) {
+    liveBindings.insert( binding->second );
+  }
+}
+
+void fold( BindingNode* _node ) {
+  int64_t word;
+
+  fold( _node->getBindingExpression() );
+
+  if ( foldedWord( _node->getBindingExpression(), word ) ) {
+    slotWords[_node->getSlot()] = word;
+  } else {
+    slotWords.erase( _node->getSlot() );
+  }
+
+  slotBindings[_node->getSlot()] = _node->getRef();
+}
+
+/* up a chain of operators from its innermost, see leftSpine() */
+void fold( BinaryOperatorNode* _node ) {
+  std::vector<BinaryOperatorNode*> spine = leftSpine( _node );
+
+  fold( spine.back()->getLeftOperand() );
+
+  for ( size_t index = spine.size(); index > 0; index-- ) {
+    BinaryOperatorNode* node = spine[index - 1];
+    int64_t left;
+    int64_t right;
+    int64_t word;
+
+    fold( node->getRightOperand() );
+
+    if (
+      foldedWord( node->getLeftOperand(), left ) && foldedWord( node->getRightOperand(), right ) &&
+      foldBinary( node->getOperator(), left, right, word )
+    ) {
+      foldedWords[node->getRef()] = word;
+    }
+  }
+}
+
+/*
+ * only the live branch is walked, nothing in the other one is compiled; either branch of any other starts from the
+ * words known before it, and only the words both leave the same are known after it
+ */
+void fold( ConditionalNode* _node ) {
+  Node* branch;
+
+  fold( _node->getConditional() );
+
+  if ( liveBranch( _node, branch ) ) {
+    fold( branch );
+    return;
+  }
+
+  std::unordered_map<int, int64_t> before = slotWords;
+
+  fold( _node->getUpperBody() );
+
+  std::unordered_map<int, int64_t> upperWords = slotWords;
+
+  slotWords = before;
+  fold( _node->getLowerBody() );
+
+  for ( auto word = slotWords.begin(); word != slotWords.end(); ) {
+    auto upper = upperWords.find( word->first );
+
+    word = upper != upperWords.end() && upper->second == word->second ? std::next( word ) : slotWords.erase( word );
+  }
+}
+
+/* every slot of an enclosing scope _node assigns to */
+void assignedSlots( const Node* _node, std::unordered_set<int>& _slots ) {
+  if ( !_node ) {
+    return;
+  } else if ( _node->getNodeType() == NodeType::NodeAssignment ) {
+    _slots.insert( ( (AssignmentNode*) _node )->getSlot() );
+    assignedSlots( ( (AssignmentNode*) _node )->getExpression(), _slots );
+  } else if ( _node->getNodeType() == NodeType::NodeBinding ) {
+    assignedSlots( ( (BindingNode*) _node )->getBindingExpression(), _slots );
+  } else if ( _node->getNodeType() == NodeType::NodeMultiStatement ) {
+    for ( Node* statement : ( (MultiStatementNode*) _node )->getStatements() ) {
+      assignedSlots( statement, _slots );
+    }
+  } else if ( _node->getNodeType() == NodeType::NodeConditional ) {
+    assignedSlots( ( (ConditionalNode*) _node )->getUpperBody(), _slots );
+    assignedSlots( ( (ConditionalNode*) _node )->getLowerBody(), _slots );
+  } else if ( _node->getNodeType() == NodeType::NodeWhile ) {
+    assignedSlots( ( (WhileNode*) _node )->getBody(), _slots );
+  } else if ( _node->getNodeType() == NodeType::NodeFor ) {
+    assignedSlots( ( (ForNode*) _node )->getBody(), _slots );
+  }
+}
+
+/* the word an assignment leaves in its slot is known after it, as a binding's is */
+void fold( AssignmentNode* _node ) {
+  int64_t word;
+  auto binding = slotBindings.find( _node->getSlot() );
+
+  fold( _node->getExpression() );
+
+  if ( foldedWord( _node->getExpression(), word ) ) {
+    slotWords[_node->getSlot()] = word;
+  } else {
+    slotWords.erase( _node->getSlot() );
+  }
+
+  /* the binding is lowered wherever it is assigned to, so that every path through a branch or loop has its slot */
+  if ( binding != slotBindings.end() ) {
+    liveBindings.insert( binding->second );
+  }
+}
+
+/*
+ * a loop is walked once, with no word known for a slot it assigns to, as a later run sees what an earlier one left;
+ * nor is one known after it
+ */
+void forgetAssigned( const Node* _body ) {
+  std::unordered_set<int> assigned;
+
+  assignedSlots( _body, assigned );
+
+  for ( int slot : assigned ) {
+    slotWords.erase( slot );
+  }
+}
+
+void fold( WhileNode* _node ) {
+  forgetAssigned( _node->getBody() );
+  fold( _node->getConditional() );
+  fold( _node->getBody() );
+  forgetAssigned( _node->getBody() );
+}
+
+/* the loop variable is never known, the loop itself is its binding */
+void fold( ForNode* _node ) {
+  fold( _node->getFirst() );
+  fold( _node->getLast() );
+  forgetAssigned( _node->getBody() );
+  slotWords.erase( _node->getSlot() );
+  slotBindings[_node->getSlot()] = _node->getRef();
+  fold( _node->getBody() );
+  forgetAssigned( _node->getBody() );
+}
+
+/* a function's frame has slots of its own, which the module's slots are kept apart from */
+void fold( FunctionNode* _node ) {
+  std::unordered_map<int, int64_t> moduleWords;
+  std::unordered_map<int, NodeRef> moduleBindings;
+
+  moduleWords.swap( slotWords );
+  moduleBindings.swap( slotBindings );
+
+  fold( _node->getBody() );
+
+  slotWords.swap( moduleWords );
+  slotBindings.swap( moduleBindings );
+}
+
+/* walks the tree in source order, the order bindings are made in */
+void fold( Node* _node ) {
+  if ( !_node ) {
+    return;
+  } else if ( _node->getNodeType() == NodeType::NodeVariable ) {
+    fold( (VariableNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeBinding ) {
+    fold( (BindingNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeUnaryOperator ) {
+    fold( ( (UnaryOperatorNode*) _node )->getOperand() );
+  } else if ( _node->getNodeType() == NodeType::NodeBinaryOperator ) {
+    fold( (BinaryOperatorNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeMultiStatement ) {
+    for ( Node* statement : ( (MultiStatementNode*) _node )->getStatements() ) {
+      if ( !deadStatement( statement ) ) fold( statement );
+    }
+  } else if ( _node->getNodeType() == NodeType::NodeConditional ) {
+    fold( (ConditionalNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeFunctionCall ) {
+    for ( Node* argument : ( (FunctionCallNode*) _node )->getArguments() ) {
+      fold( argument );
+    }
+  } else if ( _node->getNodeType() == NodeType::NodeFunction ) {
+    fold( (FunctionNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeReturn ) {
+    fold( ( (ReturnNode*) _node )->getExpression() );
+  } else if ( _node->getNodeType() == NodeType::NodeAssignment ) {
+    fold( (AssignmentNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeWhile ) {
+    fold( (WhileNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeFor ) {
+    fold( (ForNode*) _node );
+  }
+}
+
+void optimize( Node* _root ) {
+  foldedWords.clear();
+  slotWords.clear();
+  slotBindings.clear();
+  liveBindings.clear();
+
+  fold( _root );
+}
+
+#endif
@@ -0,0 +1,323 @@
+#ifndef _PEEPHOLE_HPP
+#define _PEEPHOLE_HPP
+
+#include <atomic>
+#include <cctype>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include "compiler/assembly.hpp"
+
+/*
+ * peephole pass over a function's code before it is written out as text; every instruction is matched against the
+ * rule table as it is appended, together with the instructions appended right before it, and a rule may rewrite or
+ * drop both, after which every rule is tried again so one rewrite can expose the next
+ *
+ * rax is scratch ( see compiler/regalloc.hpp ), the code selected for one IR instruction never leaves anything in it
+ * for the next other than a call's result or a returned value, so an immediate moved into rax only to be stored to
+ * a stack slot is not read again
+ */
+enum PeepholeResult {
+  RuleUnmatched,
+  /* _next may have changed and is still to be appended */
+  RuleRewritten,
+  RuleDropped,
+};
+
+struct PeepholeRule {
+  const char* name;
+  /* matches _next against the end of _code, rewriting either or both */
+  PeepholeResult ( *apply )( AsmCode& _code, AsmInstruction& _next );
+  bool enabled;
+  /* over every module compiled, modules are compiled on several threads */
+  std::atomic<uint64_t> hits;
+};
+
+bool isMemoryOperand( const std::string& _operand ) {
+  return _operand.find( '[' ) != std::string::npos;
+}
+
+bool isRegisterOperand( const std::string& _operand ) {
+  for ( const std::string& name : REGISTER_NAMES ) {
+    if ( _operand == name ) return true;
+  }
+
+  return false;
+}
+
+/* an operand without its size prefix */
+std::string withoutSize( const std::string& _operand ) {
+  return _operand.rfind( "qword ", 0 ) == 0 ? _operand.substr( 6 ) : _operand;
+}
+
+/* whether _operand names _register anywhere, as itself or within an address */
+bool readsRegister( const std::string& _operand, const std::string& _register ) {
+  size_t position = _operand.find( _register );
+
+  while ( position != std::string::npos ) {
+    size_t end = position + _register.length();
+    bool startsWord = position == 0 || !std::isalnum( static_cast<unsigned char>( _operand[position - 1] ) );
+    bool endsWord = end == _operand.length() || !std::isalnum( static_cast<unsigned char>( _operand[end] ) );
+
+    if ( startsWord && endsWord ) return true;
+
+    position = _operand.find( _register, end );
+  }
+
+  return false;
+}
+
+/* the value of an immediate operand that sign-extends from 32 bits, as a memory store can take it */
+bool immediate32( const std::string& _operand, int64_t& _value ) {
+  if ( _operand.empty() || !( std::isdigit( static_cast<unsigned char>( _operand[0] ) ) || _operand[0] == '-' ) ) {
+    return false;
+  }
+
+  try {
+    _value = _operand.rfind( "0x", 0 ) == 0
+      ? static_cast<int64_t>( std::stoull( _operand, nullptr, 16 ) )
+      : std::stoll( _operand );
+  } catch ( const std::exception& ) {
+    return false;
+  }
+
+  return _value >= std::numeric_limits<int32_t>::min() && _value <= std::numeric_limits<int32_t>::max();
+}
+
+/* the conditional jump taken exactly when _jump's is not, empty for anything else */
+std::string invertedJump( const std::string& _jump ) {
+  std::string inverted = _jump.length() > 1 && _jump[0] == 'j' ? invertedCondition( _jump.substr( 1 ) ) : "";
+
+  return inverted.empty() ? "" : "j" + inverted;
+}
+
+/* mov a, a */
+PeepholeResult selfMove( AsmCode&, AsmInstruction& _next ) {
+  return _next.mnemonic == "mov" && _next.destination == _next.source ? RuleDropped : RuleUnmatched;
+}
+
+/* push a; pop b -> mov b, a */
+PeepholeResult pushPop( AsmCode& _code, AsmInstruction& _next ) {
+  if ( _code.empty() || _next.mnemonic != "pop" || _code.back().mnemonic != "push" ) {
+    return RuleUnmatched;
+  }
+
+  std::string destination = _next.destination;
+  std::string source = _code.back().destination;
+
+  /* there is no move from memory to memory */
+  if ( isMemoryOperand( destination ) && isMemoryOperand( source ) ) {
+    return RuleUnmatched;
+  }
+
+  /* either side being a register sets the size */
+  if ( isRegisterOperand( withoutSize( destination ) ) || isRegisterOperand( withoutSize( source ) ) ) {
+    destination = withoutSize( destination );
+    source = withoutSize( source );
+  }
+
+  _code.pop_back();
+  _next = insn( "mov", destination, source );
+
+  return RuleRewritten;
+}
+
+/* mov [a], r; mov s, [a] -> mov [a], r; mov s, r */
+PeepholeResult storeReload( AsmCode& _code, AsmInstruction& _next ) {
+  if ( _code.empty() || _next.mnemonic != "mov" || _code.back().mnemonic != "mov" ) {
+    return RuleUnmatched;
+  }
+
+  const AsmInstruction& store = _code.back();
+
+  if (
+    !isMemoryOperand( store.destination ) || !isRegisterOperand( store.source ) ||
+    !isRegisterOperand( _next.destination ) || withoutSize( _next.source ) != withoutSize( store.destination )
+  ) {
+    return RuleUnmatched;
+  }
+
+  _next.source = store.source;
+
+  return RuleRewritten;
+}
+
+/* mov r, a; mov r, b -> mov r, b, unless b reads r */
+PeepholeResult deadMove( AsmCode& _code, AsmInstruction& _next ) {
+  if ( _code.empty() || _next.mnemonic != "mov" || _code.back().mnemonic != "mov" ) {
+    return RuleUnmatched;
+  }
+
+  const AsmInstruction& previous = _code.back();
+
+  if (
+    !isRegisterOperand( previous.destination ) || previous.destination != _next.destination ||
+    readsRegister( _next.source, previous.destination )
+  ) {
+    return RuleUnmatched;
+  }
+
+  _code.pop_back();
+
+  return RuleRewritten;
+}
+
+/* mov rax, i; mov [a], rax -> mov qword [a], i, for an immediate a store can take */
+PeepholeResult storeImmediate( AsmCode& _code, AsmInstruction& _next ) {
+  std::string scratch = reg( Register::RAX );
+  int64_t value;
+
+  if (
+    _code.empty() || _next.mnemonic != "mov" || _next.source != scratch || !isMemoryOperand( _next.destination ) ||
+    _code.back().mnemonic != "mov" || _code.back().destination != scratch ||
+    !immediate32( _code.back().source, value )
+  ) {
+    return RuleUnmatched;
+  }
+
+  _code.back() = insn( "mov", "qword " + withoutSize( _next.destination ), std::to_string( value ) );
+
+  return RuleDropped;
+}
+
+/* jmp l; l: -> l:, any other labels in between stay */
+PeepholeResult jumpToNext( AsmCode& _code, AsmInstruction& _next ) {
+  size_t position = _code.size();
+
+  if ( !isLabel( _next ) ) {
+    return RuleUnmatched;
+  }
+
+  while ( position > 0 && isLabel( _code[position - 1] ) ) {
+    position--;
+  }
+
+  if ( position == 0 ) {
+    return RuleUnmatched;
+  }
+
+  const AsmInstruction& jump = _code[position - 1];
+
+  if ( jump.mnemonic != "jmp" || jump.destination != _next.destination ) {
+    return RuleUnmatched;
+  }
+
+  _code.erase( _code.begin() + static_cast<std::ptrdiff_t>( position - 1 ) );
+
+  return RuleRewritten;
+}
+
+/* jcc l; jmp m; l: -> jncc m; l: */
+PeepholeResult invertBranch( AsmCode& _code, AsmInstruction& _next ) {
+  if ( !isLabel( _next ) || _code.size() < 2 ) {
+    return RuleUnmatched;
+  }
+
+  AsmInstruction& conditional = _code[_code.size() - 2];
+  std::string inverted = invertedJump( conditional.mnemonic );
+
+  if ( _code.back().mnemonic != "jmp" || inverted.empty() || conditional.destination != _next.destination ) {
+    return RuleUnmatched;
+  }
+
+  conditional = insn( inverted, _code.back().destination );
+  _code.pop_back();
+
+  return RuleRewritten;
+}
+
+static PeepholeRule peepholeRules[] = {
+  { "self-move", selfMove, true, { 0 } },
+  { "push-pop", pushPop, true, { 0 } },
+  { "store-reload", storeReload, true, { 0 } },
+  { "dead-move", deadMove, true, { 0 } },
+  { "store-immediate", storeImmediate, true, { 0 } },
+  { "jump-to-next", jumpToNext, true, { 0 } },
+  { "invert-branch", invertBranch, true, { 0 } },
+};
+
+/* instructions, labels apart, before and after the pass */
+static std::atomic<uint64_t> peepholeInstructionsIn( 0 );
+
+static std::atomic<uint64_t> peepholeInstructionsOut( 0 );
+
+/* turns off the rule named _name, or every rule for an empty name; false if there is no such rule */
+bool disablePeepholeRule( const std::string _name ) {
+  bool found = false;
+
+  for ( PeepholeRule& rule : peepholeRules ) {
+    if ( _name.empty() || _name == rule.name ) {
+      rule.enabled = false;
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+uint64_t countInstructions( const AsmCode& _code ) {
+  uint64_t count = 0;
+
+  for ( const AsmInstruction& instruction : _code ) {
+    if ( !isLabel( instruction ) ) count++;
+  }
+
+  return count;
+}
+
+AsmCode peephole( const AsmCode& _code ) {
+  AsmCode optimized;
+
+  optimized.reserve( _code.size() );
+
+  for ( AsmInstruction next : _code ) {
+    PeepholeResult result = RuleUnmatched;
+    size_t rule = 0;
+
+    while ( rule < std::size( peepholeRules ) && result != RuleDropped ) {
+      result = peepholeRules[rule].enabled ? peepholeRules[rule].apply( optimized, next ) : RuleUnmatched;
+
+      if ( result == RuleUnmatched ) {
+        rule++;
+      } else {
+        peepholeRules[rule].hits++;
+        rule = 0;
+      }
+    }
+
+    if ( result != RuleDropped ) optimized.push_back( next );
+  }
+
+  peepholeInstructionsIn += countInstructions( _code );
+  peepholeInstructionsOut += countInstructions( optimized );
+
+  return optimized;
+}
+
+/* hits of every rule and how far the pass shrank the code, over every module compiled so far */
+std::string peepholeReport() {
+  std::stringstream report;
+  uint64_t before = peepholeInstructionsIn;
+  uint64_t after = peepholeInstructionsOut;
+
+  report << "peephole rules --" << std::endl;
+
+  for ( const PeepholeRule& rule : peepholeRules ) {
+    report << "  " << rule.name << " :: " << rule.hits << ( rule.enabled ? "" : " ( disabled )" ) << std::endl;
+  }
+
+  report << "  instructions :: " << before << " -> " << after;
+
+  if ( before > 0 ) {
+    report << " ( -" << ( 100.0 * static_cast<double>( before - after ) / static_cast<double>( before ) ) << "% )";
+  }
+
+  report << std::endl;
+
+  return report.str();
+}
+
+#endif
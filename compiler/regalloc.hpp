@@ -0,0 +1,503 @@
+#ifndef _REGALLOC_HPP
+#define _REGALLOC_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "compiler/assembly.hpp"
+#include "compiler/ir.hpp"
+#include "compiler/select.hpp"
+
+/*
+ * linear scan register allocation over the IR ( see compiler/ir.hpp ); every value is live over a single range of
+ * the function's linear order and keeps one location for all of it, a register while there is one to spare and a
+ * stack slot once there is not, spilling whichever live value is needed furthest ahead
+ *
+ * rax is never allocated, instruction selection keeps it as scratch and for what calls return, and neither is a
+ * value it folds into the instruction reading it ( see compiler/select.hpp ), whose operands are read there instead
+ */
+
+/* caller-saved first, a value that need not survive a call leaves the callee-saved ones, which cost a push, alone */
+const std::array<Register, 13> ALLOCATABLE_REGISTERS = {
+  Register::RCX, Register::RDX, Register::RSI, Register::RDI,
+  Register::R8, Register::R9, Register::R10, Register::R11,
+
+  Register::RBX, Register::R12, Register::R13, Register::R14, Register::R15,
+};
+
+bool calleeSaved( const Register _register ) {
+  return _register == Register::RBX || _register == Register::RBP || _register >= Register::R12;
+}
+
+struct Location {
+  bool inRegister;
+  Register reg;
+  /* stack slot of a spilled value, counted from the first below the saved registers */
+  uint32_t slot;
+};
+
+struct Allocation {
+  /* by value */
+  std::vector<Location> locations;
+  /* callee-saved registers the function uses, which it saves on entry */
+  std::vector<Register> savedRegisters;
+  uint32_t spillSlots;
+};
+
+/*
+ * instructions are numbered in layout order, the instruction at index i reads its operands at 2i and writes its
+ * result at 2i + 1, so a result may take the register of an operand that dies with it
+ */
+uint32_t usePosition( const uint32_t _index ) {
+  return 2 * _index;
+}
+
+uint32_t definePosition( const uint32_t _index ) {
+  return 2 * _index + 1;
+}
+
+struct LiveInterval {
+  Value value;
+  uint32_t start;
+  uint32_t end;
+  /* whether a call clobbers the caller-saved registers while the value is live */
+  bool acrossCall;
+  /* whether an instruction clobbers rdx while the value is live, operands of that instruction included */
+  bool atRdxClobber;
+};
+
+/* a set of values, a flag for each value of the function and a list of those set, emptied as fast as it was filled */
+class ValueSet {
+  private:
+    std::vector<bool> contained;
+    /* in the order inserted, values erased since included */
+    std::vector<Value> values;
+
+  public:
+    ValueSet( const size_t _valueCount ) : contained( _valueCount, false ) {}
+
+    void insert( const Value _value ) {
+      if ( !contained[_value] ) {
+        contained[_value] = true;
+        values.push_back( _value );
+      }
+    }
+
+    template <typename Iterator>
+    void insert( Iterator _first, const Iterator _last ) {
+      for ( ; _first != _last; _first++ ) {
+        insert( *_first );
+      }
+    }
+
+    void erase( const Value _value ) {
+      contained[_value] = false;
+    }
+
+    /* the values in the set, sorted, leaving it empty */
+    std::vector<Value> take() {
+      std::vector<Value> taken;
+
+      for ( Value value : values ) {
+        if ( contained[value] ) {
+          contained[value] = false;
+          taken.push_back( value );
+        }
+      }
+
+      values.clear();
+      std::sort( taken.begin(), taken.end() );
+
+      return taken;
+    }
+};
+
+/*
+ * values live into _successor from _block, phi operands apart, and the phi operands it takes from _block; only values
+ * kept in a location of their own are live, a constant read as an immediate or a value folded into its reader is not
+ */
+void addLiveOut(
+  const IrFunction& _function,
+  const Selection& _selection,
+  const BlockId _block,
+  const BlockId _successor,
+  const std::vector<std::vector<Value>>& _liveIn,
+  ValueSet& _live,
+  ValueSet& _phiOperands
+) {
+  const BasicBlock& successor = _function.getBlock( _successor );
+  size_t predecessor = 0;
+
+  _live.insert( _liveIn[_successor].begin(), _liveIn[_successor].end() );
+
+  while ( successor.predecessors[predecessor] != _block ) {
+    predecessor++;
+  }
+
+  for ( const Instruction& instruction : successor.instructions ) {
+    if ( instruction.opcode != Opcode::OpPhi ) break;
+
+    if ( _selection.kept[instruction.operands[predecessor]] ) _phiOperands.insert( instruction.operands[predecessor] );
+  }
+}
+
+void addLiveOut(
+  const IrFunction& _function,
+  const Selection& _selection,
+  const BlockId _block,
+  const std::vector<std::vector<Value>>& _liveIn,
+  ValueSet& _live,
+  ValueSet& _phiOperands
+) {
+  const Instruction& terminator = _function.getBlock( _block ).instructions.back();
+
+  if ( leavesFunction( terminator.opcode ) ) {
+    return;
+  }
+
+  for ( BlockId successor : terminator.targets ) {
+    if ( successor != NO_BLOCK ) {
+      addLiveOut( _function, _selection, _block, successor, _liveIn, _live, _phiOperands );
+    }
+  }
+}
+
+/* live interval of every value, found from which values are live into each block */
+std::vector<LiveInterval> buildIntervals(
+  const IrFunction& _function,
+  const Selection& _selection,
+  const std::vector<BlockId>& _layout
+) {
+  std::vector<LiveInterval> intervals;
+  std::vector<uint32_t> firstIndex( _function.blockCount() );
+  std::vector<uint32_t> lastIndex( _function.blockCount() );
+  std::vector<uint32_t> calls;
+  std::vector<uint32_t> rdxClobbers;
+  std::vector<std::vector<Value>> liveIn( _function.blockCount() );
+  ValueSet live( _function.valueCount() );
+  ValueSet phiOperands( _function.valueCount() );
+  uint32_t index = 0;
+  bool changed = true;
+
+  for ( BlockId block : _layout ) {
+    firstIndex[block] = index;
+
+    for ( const Instruction& instruction : _function.getBlock( block ).instructions ) {
+      if ( instruction.opcode == Opcode::OpCall ) calls.push_back( index );
+      if ( clobbersRdx( _selection, instruction ) ) rdxClobbers.push_back( usePosition( index ) );
+      index++;
+    }
+
+    lastIndex[block] = index - 1;
+  }
+
+  /* backwards from the last block until nothing changes, which is a single pass while there are no loops */
+  while ( changed ) {
+    changed = false;
+
+    for ( size_t position = _layout.size(); position > 0; position-- ) {
+      BlockId block = _layout[position - 1];
+      const std::vector<Instruction>& instructions = _function.getBlock( block ).instructions;
+
+      addLiveOut( _function, _selection, block, liveIn, live, phiOperands );
+
+      std::vector<Value> copied = phiOperands.take();
+      live.insert( copied.begin(), copied.end() );
+
+      for ( size_t offset = instructions.size(); offset > 0; offset-- ) {
+        const Instruction& instruction = instructions[offset - 1];
+
+        if ( instruction.result != NO_VALUE ) live.erase( instruction.result );
+
+        if ( instruction.opcode == Opcode::OpPhi ) continue;
+
+        for ( Value operand : instruction.operands ) {
+          if ( _selection.kept[operand] ) live.insert( operand );
+        }
+      }
+
+      std::vector<Value> sorted = live.take();
+
+      if ( sorted != liveIn[block] ) {
+        liveIn[block] = std::move( sorted );
+        changed = true;
+      }
+    }
+  }
+
+  for ( Value value = 0; value < _function.valueCount(); value++ ) {
+    intervals.push_back( { value, UINT32_MAX, 0, false, false } );
+  }
+
+  auto cover = [ &intervals ]( const Value _value, const uint32_t _position ) {
+    intervals[_value].start = std::min( intervals[_value].start, _position );
+    intervals[_value].end = std::max( intervals[_value].end, _position );
+  };
+
+  for ( BlockId block : _layout ) {
+    const BasicBlock& basicBlock = _function.getBlock( block );
+
+    addLiveOut( _function, _selection, block, liveIn, live, phiOperands );
+
+    for ( Value value : liveIn[block] ) {
+      cover( value, usePosition( firstIndex[block] ) );
+    }
+
+    for ( Value value : live.take() ) {
+      cover( value, definePosition( lastIndex[block] ) );
+    }
+
+    /* phi copies are made as the block ends */
+    for ( Value value : phiOperands.take() ) {
+      cover( value, usePosition( lastIndex[block] ) );
+    }
+
+    for ( uint32_t offset = 0; offset < basicBlock.instructions.size(); offset++ ) {
+      const Instruction& instruction = basicBlock.instructions[offset];
+
+      if ( instruction.opcode == Opcode::OpPhi ) {
+        /* written at the end of every predecessor */
+        for ( BlockId predecessor : basicBlock.predecessors ) {
+          cover( instruction.result, definePosition( lastIndex[predecessor] ) );
+        }
+
+        cover( instruction.result, definePosition( firstIndex[block] + offset ) );
+        continue;
+      }
+
+      for ( Value operand : instruction.operands ) {
+        cover( operand, usePosition( readAt( _selection, instruction, firstIndex[block] + offset ) ) );
+      }
+
+      if ( instruction.result != NO_VALUE ) {
+        cover( instruction.result, definePosition( firstIndex[block] + offset ) );
+      }
+    }
+  }
+
+  for ( LiveInterval& interval : intervals ) {
+    /* the first call the value is live at, a call's own operands and result are not live across it */
+    auto call = std::lower_bound( calls.begin(), calls.end(), ( interval.start + 1 ) / 2 );
+
+    interval.acrossCall = call != calls.end() && interval.end > definePosition( *call );
+
+    auto clobber = std::lower_bound( rdxClobbers.begin(), rdxClobbers.end(), interval.start );
+
+    interval.atRdxClobber = clobber != rdxClobbers.end() && *clobber <= interval.end;
+  }
+
+  return intervals;
+}
+
+/*
+ * by value, the phi of a loop's head a value jumping back to it shares its location with, NO_VALUE for none; the
+ * value is the phi's next, its copy into the phi is then left out, and the phi is live over all of the loop anyway,
+ * so sharing is sound once nothing in the block jumping back reads the phi after the value is computed
+ */
+std::vector<Value> loopCarried(
+  const IrFunction& _function,
+  const Selection& _selection,
+  const std::vector<BlockId>& _layout
+) {
+  std::vector<Value> carried( _function.valueCount(), NO_VALUE );
+  std::vector<uint32_t> position( _function.blockCount(), UINT32_MAX );
+  uint32_t index = 0;
+
+  for ( size_t block = 0; block < _layout.size(); block++ ) {
+    position[_layout[block]] = static_cast<uint32_t>( block );
+  }
+
+  for ( BlockId latch : _layout ) {
+    const std::vector<Instruction>& instructions = _function.getBlock( latch ).instructions;
+    const Instruction& terminator = instructions.back();
+    uint32_t first = index;
+
+    index += static_cast<uint32_t>( instructions.size() );
+
+    if ( terminator.opcode != Opcode::OpJump || position[terminator.targets[0]] > position[latch] ) continue;
+
+    const BasicBlock& head = _function.getBlock( terminator.targets[0] );
+    size_t predecessor = static_cast<size_t>(
+      std::find( head.predecessors.begin(), head.predecessors.end(), latch ) - head.predecessors.begin()
+    );
+
+    for ( const Instruction& phi : head.instructions ) {
+      if ( phi.opcode != Opcode::OpPhi ) break;
+
+      Value next = phi.operands[predecessor];
+      const Instruction* definition = _selection.definitions[next];
+
+      if (
+        !_selection.kept[next] || _selection.uses[next] != 1 || _selection.blocks[next] != latch ||
+        definition->opcode == Opcode::OpPhi || definition->opcode == Opcode::OpParameter
+      ) {
+        continue;
+      }
+
+      /* read at the end of the block by the copies into the other phis */
+      bool read = std::any_of( head.instructions.begin(), head.instructions.end(), [ & ]( const Instruction& _other ) {
+        return _other.opcode == Opcode::OpPhi && _other.operands[predecessor] == phi.result;
+      } );
+      uint32_t defined = first + static_cast<uint32_t>( definition - instructions.data() );
+
+      /* an instruction folded into another reads its operands where that one is emitted */
+      for ( uint32_t offset = 0; offset < instructions.size() && !read; offset++ ) {
+        const Instruction& instruction = instructions[offset];
+
+        read = readAt( _selection, instruction, first + offset ) > defined && std::find(
+          instruction.operands.begin(), instruction.operands.end(), phi.result
+        ) != instruction.operands.end();
+      }
+
+      if ( !read ) carried[next] = phi.result;
+    }
+  }
+
+  return carried;
+}
+
+/* whether _interval may be kept in _register */
+bool allowedRegister( const LiveInterval& _interval, const Register _register ) {
+  return ( !_interval.acrossCall || calleeSaved( _register ) ) && ( !_interval.atRdxClobber || _register != RDX );
+}
+
+Allocation allocateRegisters(
+  const IrFunction& _function,
+  const std::vector<BlockId>& _layout,
+  const Selection& _selection
+) {
+  std::vector<LiveInterval> intervals = buildIntervals( _function, _selection, _layout );
+  std::vector<const LiveInterval*> order;
+  std::vector<const LiveInterval*> active;
+  std::array<bool, REGISTER_NAMES.size()> freeRegisters = {};
+  std::array<bool, REGISTER_NAMES.size()> usedRegisters = {};
+  /* by value, the operand whose register it would rather take, see coalescedOperand() */
+  std::vector<Value> coalesced( _function.valueCount(), NO_VALUE );
+  std::vector<Value> carried = loopCarried( _function, _selection, _layout );
+  /* by value, the argument register of the one call reading it or a parameter arrives in, rax for none */
+  std::vector<Register> arguments( _function.valueCount(), Register::RAX );
+  Allocation allocation = {
+    std::vector<Location>( _function.valueCount(), { false, Register::RAX, 0 } ),
+    {},
+    0,
+  };
+
+  for ( BlockId block : _layout ) {
+    for ( const Instruction& instruction : _function.getBlock( block ).instructions ) {
+      if ( instruction.result != NO_VALUE ) coalesced[instruction.result] = coalescedOperand( _selection, instruction );
+
+      /* a phi would rather share the register of its first operand, whose copy into it is then left out */
+      if ( instruction.opcode == Opcode::OpPhi ) coalesced[instruction.result] = instruction.operands[0];
+
+      if (
+        instruction.opcode == Opcode::OpParameter &&
+        static_cast<size_t>( instruction.word ) < ARGUMENT_REGISTERS.size()
+      ) {
+        arguments[instruction.result] = ARGUMENT_REGISTERS[static_cast<size_t>( instruction.word )];
+      }
+
+      if ( instruction.opcode != Opcode::OpCall && instruction.opcode != Opcode::OpTailCall ) continue;
+
+      for ( size_t index = 0; index < instruction.operands.size() && index < ARGUMENT_REGISTERS.size(); index++ ) {
+        if ( _selection.uses[instruction.operands[index]] == 1 ) {
+          arguments[instruction.operands[index]] = ARGUMENT_REGISTERS[index];
+        }
+      }
+    }
+  }
+
+  for ( const LiveInterval& interval : intervals ) {
+    /* values of unreachable blocks are never defined */
+    if (
+      interval.start != UINT32_MAX && _selection.kept[interval.value] && carried[interval.value] == NO_VALUE
+    ) {
+      order.push_back( &interval );
+    }
+  }
+
+  std::sort( order.begin(), order.end(), []( const LiveInterval* _left, const LiveInterval* _right ) {
+    return _left->start != _right->start ? _left->start < _right->start : _left->value < _right->value;
+  } );
+
+  for ( Register available : ALLOCATABLE_REGISTERS ) {
+    freeRegisters[available] = true;
+  }
+
+  auto assign = [ &allocation, &usedRegisters ]( const LiveInterval* _interval, const Register _register ) {
+    allocation.locations[_interval->value] = { true, _register, 0 };
+    usedRegisters[_register] = true;
+  };
+
+  auto spill = [ &allocation ]( const LiveInterval* _interval ) {
+    allocation.locations[_interval->value] = { false, Register::RAX, allocation.spillSlots++ };
+  };
+
+  for ( const LiveInterval* current : order ) {
+    auto expired = std::remove_if( active.begin(), active.end(), [ & ]( const LiveInterval* _interval ) {
+      if ( _interval->end >= current->start ) return false;
+
+      freeRegisters[allocation.locations[_interval->value].reg] = true;
+      return true;
+    } );
+
+    active.erase( expired, active.end() );
+
+    auto available = [ & ]( const Register _register ) {
+      return freeRegisters[_register] && allowedRegister( *current, _register );
+    };
+    const Register* chosen = std::find_if( ALLOCATABLE_REGISTERS.begin(), ALLOCATABLE_REGISTERS.end(), available );
+    Value operand = coalesced[current->value];
+    /* the argument register a call reads the value from saves moving it there */
+    Register preferred = arguments[current->value];
+
+    /* and the register of an operand that dies here saves moving it into the result */
+    if ( operand != NO_VALUE && allocation.locations[operand].inRegister ) {
+      preferred = allocation.locations[operand].reg;
+    }
+
+    if ( preferred != Register::RAX && available( preferred ) ) {
+      chosen = std::find( ALLOCATABLE_REGISTERS.begin(), ALLOCATABLE_REGISTERS.end(), preferred );
+    }
+
+    if ( chosen != ALLOCATABLE_REGISTERS.end() ) {
+      freeRegisters[*chosen] = false;
+      assign( current, *chosen );
+      active.push_back( current );
+      continue;
+    }
+
+    /* out of registers, whichever value is needed furthest ahead goes to the stack */
+    const LiveInterval** victim = nullptr;
+
+    for ( const LiveInterval*& interval : active ) {
+      if (
+        allowedRegister( *current, allocation.locations[interval->value].reg ) &&
+        ( !victim || interval->end > ( *victim )->end )
+      ) {
+        victim = &interval;
+      }
+    }
+
+    if ( victim && ( *victim )->end > current->end ) {
+      assign( current, allocation.locations[( *victim )->value].reg );
+      spill( *victim );
+      *victim = current;
+    } else {
+      spill( current );
+    }
+  }
+
+  for ( Value value = 0; value < _function.valueCount(); value++ ) {
+    if ( carried[value] != NO_VALUE ) allocation.locations[value] = allocation.locations[carried[value]];
+  }
+
+  for ( Register available : ALLOCATABLE_REGISTERS ) {
+    if ( usedRegisters[available] && calleeSaved( available ) ) allocation.savedRegisters.push_back( available );
+  }
+
+  return allocation;
+}
+
+#endif
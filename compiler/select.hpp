@@ -0,0 +1,586 @@
+#ifndef _SELECT_HPP
+#define _SELECT_HPP
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+#include "compiler/assembly.hpp"
+#include "compiler/ir.hpp"
+#include "compiler/strength.hpp"
+
+/*
+ * tree-pattern instruction selection over the IR, in the manner of BURS; every instruction is labelled, operands
+ * first, with the cheapest rule of SELECTION_RULES producing its value in each form and what that costs in
+ * instructions, and each value is then produced in the form the instruction reading it found cheapest
+ *
+ * the trees are those within a block, a value read by a single instruction of its own block may be computed as
+ * part of it, and a constant may be written into any instruction reading it; everything else is computed into a
+ * register or stack slot of its own ( see compiler/regalloc.hpp ) before anything reads it
+ */
+enum Form {
+  /* in the value's own register or stack slot */
+  FormRegister,
+  /* a constant written into the instruction */
+  FormImmediate,
+  /* a register times 1, 2, 4 or 8, as an address scales its index */
+  FormIndex,
+  /* base + index * scale + displacement, as lea computes it */
+  FormAddress,
+  /* a comparison left in the flags for a conditional jump */
+  FormFlags,
+};
+
+const size_t FORM_COUNT = 5;
+
+enum Pattern {
+  PatternLoad,
+  PatternImmediate,
+  PatternCall,
+  PatternPhi,
+  PatternParameter,
+  PatternIndex,
+  PatternAddress,
+  PatternLea,
+  PatternArithmetic,
+  PatternXor,
+  PatternMultiply,
+  PatternUntaggedMultiply,
+  PatternUntag,
+  PatternScale,
+  PatternDivide,
+  PatternReducedDivide,
+  PatternCompare,
+  PatternSwappedCompare,
+  PatternMaterialize,
+};
+
+struct Selection;
+
+struct SelectionRule {
+  Pattern pattern;
+  /* form the rule produces a value in */
+  Form form;
+  /* a chain rule produces its form from the value in another, its left form, rather than from the instruction */
+  bool chain;
+  Opcode opcode;
+  /* forms the operands of a binary operation are read in */
+  Form left;
+  Form right;
+  /* instructions the rule emits itself */
+  uint32_t cost;
+  /* what the rule needs of the instruction besides its shape, nullptr for nothing */
+  bool ( *condition )( const Selection& _selection, const SelectionRule& _rule, const Instruction& _instruction );
+};
+
+struct Label {
+  /* UINT32_MAX while no rule produces the form */
+  uint32_t cost;
+  size_t rule;
+};
+
+struct Selection {
+  std::vector<const Instruction*> definitions;
+  /* by value, how many instructions read it and the block it is defined in */
+  std::vector<uint32_t> uses;
+  std::vector<BlockId> blocks;
+  /* by value, the cheapest rule producing it in each form */
+  std::vector<std::array<Label, FORM_COUNT>> labels;
+  /* by value, the form it is produced in; a constant is produced as an immediate wherever that is cheaper */
+  std::vector<Form> forms;
+  /* by value, whether it is kept in a register or stack slot of its own */
+  std::vector<bool> kept;
+  /* by value, the index in layout order of the instruction it is emitted with, its own unless it was folded */
+  std::vector<uint32_t> emittedAt;
+};
+
+struct AddressTerms {
+  Value base;
+  Value index;
+  int64_t scale;
+  int64_t displacement;
+};
+
+bool fitsImmediate( const int64_t _word ) {
+  return _word >= std::numeric_limits<int32_t>::min() && _word <= std::numeric_limits<int32_t>::max();
+}
+
+/* the word _value always holds, when a constant defines it */
+bool constantWord( const Selection& _selection, const Value _value, int64_t& _word ) {
+  const Instruction* definition = _selection.definitions[_value];
+
+  if ( !definition || definition->opcode != Opcode::OpConstant ) {
+    return false;
+  }
+
+  _word = definition->word;
+  return true;
+}
+
+/* the one operand of a binary operation that is a constant, by how the rule reads it */
+size_t immediateOperand( const SelectionRule& _rule ) {
+  return _rule.left == Form::FormImmediate ? 0 : 1;
+}
+
+bool arithmetic( const Selection&, const SelectionRule&, const Instruction& _instruction ) {
+  return _instruction.operation == OperatorId::OperatorAdd || _instruction.operation == OperatorId::OperatorSubtract ||
+         _instruction.operation == OperatorId::OperatorAnd || _instruction.operation == OperatorId::OperatorOr;
+}
+
+/* the word of the operand the rule takes as an immediate, false unless a constant defines it */
+bool immediateWord(
+  const Selection& _selection,
+  const SelectionRule& _rule,
+  const Instruction& _instruction,
+  int64_t& _word
+) {
+  return constantWord( _selection, _instruction.operands[immediateOperand( _rule )], _word );
+}
+
+/* the immediate fits into an instruction, which sign-extends 32 bits */
+bool immediateFits( const Selection& _selection, const SelectionRule& _rule, const Instruction& _instruction ) {
+  int64_t word;
+
+  return immediateWord( _selection, _rule, _instruction, word ) && fitsImmediate( word );
+}
+
+bool arithmeticImmediate( const Selection& _selection, const SelectionRule& _rule, const Instruction& _instruction ) {
+  return arithmetic( _selection, _rule, _instruction ) && immediateFits( _selection, _rule, _instruction );
+}
+
+bool exclusiveOr( const Selection&, const SelectionRule&, const Instruction& _instruction ) {
+  return _instruction.operation == OperatorId::OperatorXor;
+}
+
+bool exclusiveOrImmediate( const Selection& _selection, const SelectionRule& _rule, const Instruction& _instruction ) {
+  return exclusiveOr( _selection, _rule, _instruction ) && immediateFits( _selection, _rule, _instruction );
+}
+
+bool multiply( const Selection&, const SelectionRule&, const Instruction& _instruction ) {
+  return _instruction.operation == OperatorId::OperatorMultiply;
+}
+
+/* a multiplication by an integer untagged ahead of it ( see compiler/loops.hpp ), the left operand stays tagged */
+bool untaggedMultiply( const Selection& _selection, const SelectionRule& _rule, const Instruction& _instruction ) {
+  return multiply( _selection, _rule, _instruction ) &&
+         _selection.definitions[_instruction.operands[1]]->opcode == Opcode::OpUntag;
+}
+
+bool taggedMultiply( const Selection& _selection, const SelectionRule& _rule, const Instruction& _instruction ) {
+  return multiply( _selection, _rule, _instruction ) && !untaggedMultiply( _selection, _rule, _instruction );
+}
+
+/* a multiplication by a constant strength reduction handles ( see compiler/strength.hpp ) */
+bool reducibleMultiply( const Selection& _selection, const SelectionRule& _rule, const Instruction& _instruction ) {
+  int64_t word;
+  int64_t factor;
+  int shift;
+
+  if ( !multiply( _selection, _rule, _instruction ) ) {
+    return false;
+  }
+
+  return immediateWord( _selection, _rule, _instruction, word ) &&
+         ( shiftedMultiplier( magnitude( word >> 1 ), factor, shift ) || fitsImmediate( word >> 1 ) );
+}
+
+/* a multiplication by 1, 2, 4 or 8, which an address scales its index by */
+bool scaledIndex( const Selection& _selection, const SelectionRule& _rule, const Instruction& _instruction ) {
+  int64_t word;
+
+  if ( !multiply( _selection, _rule, _instruction ) ) {
+    return false;
+  }
+
+  return immediateWord( _selection, _rule, _instruction, word ) &&
+         ( ( word >> 1 ) == 1 || ( word >> 1 ) == 2 || ( word >> 1 ) == 4 || ( word >> 1 ) == 8 );
+}
+
+bool divide( const Selection&, const SelectionRule&, const Instruction& _instruction ) {
+  return _instruction.operation == OperatorId::OperatorDivide;
+}
+
+/* a division by zero is left to idiv, to fault at run time */
+bool reducibleDivide( const Selection& _selection, const SelectionRule& _rule, const Instruction& _instruction ) {
+  int64_t word;
+
+  return divide( _selection, _rule, _instruction ) &&
+         immediateWord( _selection, _rule, _instruction, word ) && word != 0;
+}
+
+bool comparison( const Selection&, const SelectionRule&, const Instruction& _instruction ) {
+  return isComparison( _instruction.operation );
+}
+
+bool comparisonImmediate( const Selection& _selection, const SelectionRule& _rule, const Instruction& _instruction ) {
+  return comparison( _selection, _rule, _instruction ) && immediateFits( _selection, _rule, _instruction );
+}
+
+bool validAddress( const Selection& _selection, const SelectionRule& _rule, const Instruction& _instruction );
+
+const SelectionRule SELECTION_RULES[] = {
+  { PatternLoad, FormRegister, false, OpConstant, FormRegister, FormRegister, 1, nullptr },
+  { PatternImmediate, FormImmediate, false, OpConstant, FormRegister, FormRegister, 0, nullptr },
+  { PatternCall, FormRegister, false, OpCall, FormRegister, FormRegister, 1, nullptr },
+  { PatternPhi, FormRegister, false, OpPhi, FormRegister, FormRegister, 0, nullptr },
+  { PatternParameter, FormRegister, false, OpParameter, FormRegister, FormRegister, 0, nullptr },
+
+  /* addresses, for lea to compute sums in one instruction */
+  { PatternIndex, FormIndex, false, OpBinary, FormRegister, FormImmediate, 0, scaledIndex },
+  { PatternIndex, FormIndex, false, OpBinary, FormImmediate, FormRegister, 0, scaledIndex },
+  { PatternAddress, FormAddress, false, OpBinary, FormRegister, FormRegister, 0, validAddress },
+  { PatternAddress, FormAddress, false, OpBinary, FormRegister, FormImmediate, 0, validAddress },
+  { PatternAddress, FormAddress, false, OpBinary, FormImmediate, FormRegister, 0, validAddress },
+  { PatternAddress, FormAddress, false, OpBinary, FormRegister, FormIndex, 0, validAddress },
+  { PatternAddress, FormAddress, false, OpBinary, FormIndex, FormRegister, 0, validAddress },
+  { PatternAddress, FormAddress, false, OpBinary, FormIndex, FormImmediate, 0, validAddress },
+  { PatternAddress, FormAddress, false, OpBinary, FormImmediate, FormIndex, 0, validAddress },
+  { PatternAddress, FormAddress, false, OpBinary, FormAddress, FormImmediate, 0, validAddress },
+  { PatternAddress, FormAddress, false, OpBinary, FormImmediate, FormAddress, 0, validAddress },
+  { PatternAddress, FormAddress, false, OpBinary, FormAddress, FormRegister, 0, validAddress },
+  { PatternAddress, FormAddress, false, OpBinary, FormRegister, FormAddress, 0, validAddress },
+  { PatternAddress, FormAddress, false, OpBinary, FormAddress, FormIndex, 0, validAddress },
+  { PatternAddress, FormAddress, false, OpBinary, FormIndex, FormAddress, 0, validAddress },
+  { PatternLea, FormRegister, true, OpBinary, FormAddress, FormAddress, 1, nullptr },
+
+  /* a mov into the result, then the operation */
+  { PatternArithmetic, FormRegister, false, OpBinary, FormRegister, FormRegister, 2, arithmetic },
+  { PatternArithmetic, FormRegister, false, OpBinary, FormRegister, FormImmediate, 2, arithmeticImmediate },
+  { PatternArithmetic, FormRegister, false, OpBinary, FormImmediate, FormRegister, 2, arithmeticImmediate },
+  { PatternXor, FormRegister, false, OpBinary, FormRegister, FormRegister, 4, exclusiveOr },
+  { PatternXor, FormRegister, false, OpBinary, FormRegister, FormImmediate, 4, exclusiveOrImmediate },
+  { PatternMultiply, FormRegister, false, OpBinary, FormRegister, FormRegister, 3, taggedMultiply },
+  { PatternUntaggedMultiply, FormRegister, false, OpBinary, FormRegister, FormRegister, 2, untaggedMultiply },
+  { PatternUntag, FormRegister, false, OpUntag, FormRegister, FormRegister, 2, nullptr },
+  { PatternScale, FormRegister, false, OpBinary, FormRegister, FormImmediate, 2, reducibleMultiply },
+  { PatternScale, FormRegister, false, OpBinary, FormImmediate, FormRegister, 2, reducibleMultiply },
+  { PatternDivide, FormRegister, false, OpBinary, FormRegister, FormRegister, 5, divide },
+  { PatternReducedDivide, FormRegister, false, OpBinary, FormRegister, FormImmediate, 4, reducibleDivide },
+
+  /* comparisons set the flags, and only leave a word when something other than a branch reads them */
+  { PatternCompare, FormFlags, false, OpBinary, FormRegister, FormRegister, 1, comparison },
+  { PatternCompare, FormFlags, false, OpBinary, FormRegister, FormImmediate, 1, comparisonImmediate },
+  { PatternSwappedCompare, FormFlags, false, OpBinary, FormImmediate, FormRegister, 1, comparisonImmediate },
+  { PatternMaterialize, FormRegister, true, OpBinary, FormFlags, FormFlags, 3, nullptr },
+};
+
+const SelectionRule& selectedRule( const Selection& _selection, const Value _value, const Form _form ) {
+  return SELECTION_RULES[_selection.labels[_value][_form].rule];
+}
+
+/* _right added to _left, or taken from it, as a single address; false if that takes more than lea can */
+bool combineAddress( const AddressTerms& _left, AddressTerms _right, const bool _subtract, AddressTerms& _terms ) {
+  if ( _subtract ) {
+    if ( _right.base != NO_VALUE || _right.index != NO_VALUE ) return false;
+
+    _right.displacement = -_right.displacement;
+  }
+
+  _terms = _left;
+  _terms.displacement += _right.displacement;
+
+  if ( _right.base != NO_VALUE ) {
+    if ( _terms.base == NO_VALUE ) {
+      _terms.base = _right.base;
+    } else if ( _terms.index == NO_VALUE ) {
+      _terms.index = _right.base;
+      _terms.scale = 1;
+    } else {
+      return false;
+    }
+  }
+
+  if ( _right.index != NO_VALUE ) {
+    if ( _terms.index == NO_VALUE ) {
+      _terms.index = _right.index;
+      _terms.scale = _right.scale;
+    } else if ( _terms.base == NO_VALUE && _right.scale == 1 ) {
+      _terms.base = _right.index;
+    } else {
+      return false;
+    }
+  }
+
+  return fitsImmediate( _terms.displacement );
+}
+
+/* _value read in _form as the terms of an address, false when it cannot be */
+bool addressTerms( const Selection& _selection, const Value _value, const Form _form, AddressTerms& _terms ) {
+  const Instruction& instruction = *_selection.definitions[_value];
+
+  _terms = { NO_VALUE, NO_VALUE, 1, 0 };
+
+  if ( _form == Form::FormRegister ) {
+    _terms.base = _value;
+    return true;
+  } else if ( _form == Form::FormImmediate ) {
+    _terms.displacement = instruction.word;
+    return fitsImmediate( _terms.displacement );
+  } else if ( _form == Form::FormIndex ) {
+    const SelectionRule& rule = selectedRule( _selection, _value, _form );
+    size_t constant = immediateOperand( rule );
+
+    _terms.index = instruction.operands[1 - constant];
+    _terms.scale = _selection.definitions[instruction.operands[constant]]->word >> 1;
+    return true;
+  } else if ( _form != Form::FormAddress || _selection.labels[_value][_form].cost == UINT32_MAX ) {
+    return false;
+  }
+
+  const SelectionRule& rule = selectedRule( _selection, _value, _form );
+  AddressTerms left;
+  AddressTerms right;
+
+  return addressTerms( _selection, instruction.operands[0], rule.left, left ) &&
+         addressTerms( _selection, instruction.operands[1], rule.right, right ) &&
+         combineAddress( left, right, instruction.operation == OperatorId::OperatorSubtract, _terms );
+}
+
+/* a sum, or a difference with a constant, of operands that make a single address together */
+bool validAddress( const Selection& _selection, const SelectionRule& _rule, const Instruction& _instruction ) {
+  AddressTerms left;
+  AddressTerms right;
+  AddressTerms terms;
+
+  if ( _instruction.operation != OperatorId::OperatorAdd && _instruction.operation != OperatorId::OperatorSubtract ) {
+    return false;
+  }
+
+  return addressTerms( _selection, _instruction.operands[0], _rule.left, left ) &&
+         addressTerms( _selection, _instruction.operands[1], _rule.right, right ) &&
+         combineAddress( left, right, _instruction.operation == OperatorId::OperatorSubtract, terms );
+}
+
+/*
+ * what reading _value in _form costs the instruction of _block reading it, UINT32_MAX if it cannot be read so; a
+ * value only that instruction reads is computed for it alone, so the cost of computing it is counted there
+ */
+uint32_t operandCost( const Selection& _selection, const Value _value, const Form _form, const BlockId _block ) {
+  const Instruction& definition = *_selection.definitions[_value];
+  uint32_t cost = _selection.labels[_value][_form].cost;
+  bool alone = _selection.uses[_value] == 1 && _selection.blocks[_value] == _block;
+
+  if ( definition.opcode == Opcode::OpConstant || cost == UINT32_MAX ) {
+    return cost;
+  } else if ( _form == Form::FormRegister ) {
+    return alone ? cost : 0;
+  }
+
+  return alone && definition.opcode != Opcode::OpPhi ? cost : UINT32_MAX;
+}
+
+void label( Selection& _selection, const Instruction& _instruction, const BlockId _block ) {
+  std::array<Label, FORM_COUNT>& labels = _selection.labels[_instruction.result];
+
+  for ( size_t rule = 0; rule < std::size( SELECTION_RULES ); rule++ ) {
+    const SelectionRule& candidate = SELECTION_RULES[rule];
+    uint64_t cost = candidate.cost;
+
+    if ( candidate.chain || candidate.opcode != _instruction.opcode ) continue;
+
+    if ( _instruction.opcode == Opcode::OpBinary ) {
+      cost += operandCost( _selection, _instruction.operands[0], candidate.left, _block );
+      cost += operandCost( _selection, _instruction.operands[1], candidate.right, _block );
+    }
+
+    if (
+      cost < labels[candidate.form].cost &&
+      ( !candidate.condition || candidate.condition( _selection, candidate, _instruction ) )
+    ) {
+      labels[candidate.form] = { static_cast<uint32_t>( cost ), rule };
+    }
+  }
+
+  /* chain rules read the forms the others produced, none of them produces a form another chain rule reads */
+  for ( size_t rule = 0; rule < std::size( SELECTION_RULES ); rule++ ) {
+    const SelectionRule& candidate = SELECTION_RULES[rule];
+
+    if ( !candidate.chain || labels[candidate.left].cost == UINT32_MAX ) continue;
+
+    if ( labels[candidate.left].cost + candidate.cost < labels[candidate.form].cost ) {
+      labels[candidate.form] = { labels[candidate.left].cost + candidate.cost, rule };
+    }
+  }
+}
+
+/* a constant read from a register rather than as an immediate is loaded into one */
+void requireRegister( Selection& _selection, const Value _value ) {
+  if ( _selection.definitions[_value]->opcode == Opcode::OpConstant ) {
+    _selection.kept[_value] = true;
+  }
+}
+
+void produce( Selection& _selection, const Value _value, const Form _form, const uint32_t _index );
+
+/* _value is computed as part of the instruction at _index, which reads it in _form */
+void fold( Selection& _selection, const Value _value, const Form _form, const uint32_t _index ) {
+  if ( _form == Form::FormRegister ) {
+    requireRegister( _selection, _value );
+    return;
+  } else if ( _form == Form::FormImmediate ) {
+    return;
+  }
+
+  _selection.forms[_value] = _form;
+  _selection.emittedAt[_value] = _index;
+  produce( _selection, _value, _form, _index );
+}
+
+/* settles the forms the operands of the rule producing _value in _form are read in */
+void produce( Selection& _selection, const Value _value, const Form _form, const uint32_t _index ) {
+  const SelectionRule& rule = selectedRule( _selection, _value, _form );
+  const Instruction& instruction = *_selection.definitions[_value];
+
+  if ( rule.chain ) {
+    produce( _selection, _value, rule.left, _index );
+  } else if ( instruction.opcode == Opcode::OpBinary ) {
+    fold( _selection, instruction.operands[0], rule.left, _index );
+    fold( _selection, instruction.operands[1], rule.right, _index );
+  } else if ( instruction.opcode == Opcode::OpUntag ) {
+    fold( _selection, instruction.operands[0], rule.left, _index );
+  }
+}
+
+/* how many instructions read each value */
+std::vector<uint32_t> countUses( const IrFunction& _function ) {
+  std::vector<uint32_t> uses( _function.valueCount(), 0 );
+
+  for ( size_t block = 0; block < _function.blockCount(); block++ ) {
+    for ( const Instruction& instruction : _function.getBlock( static_cast<BlockId>( block ) ).instructions ) {
+      for ( Value operand : instruction.operands ) {
+        uses[operand]++;
+      }
+    }
+  }
+
+  return uses;
+}
+
+Selection selectInstructions( const IrFunction& _function, const std::vector<BlockId>& _layout ) {
+  const Label unreachable = { UINT32_MAX, 0 };
+  Selection selection = {
+    definitions( _function ),
+    countUses( _function ),
+    std::vector<BlockId>( _function.valueCount(), NO_BLOCK ),
+    std::vector<std::array<Label, FORM_COUNT>>( _function.valueCount() ),
+    std::vector<Form>( _function.valueCount(), Form::FormRegister ),
+    std::vector<bool>( _function.valueCount(), false ),
+    std::vector<uint32_t>( _function.valueCount(), UINT32_MAX ),
+  };
+  uint32_t index = 0;
+
+  for ( std::array<Label, FORM_COUNT>& labels : selection.labels ) {
+    labels.fill( unreachable );
+  }
+
+  /* operands first, which layout order gives, phis apart, whose rule never reads them */
+  for ( BlockId block : _layout ) {
+    for ( const Instruction& instruction : _function.getBlock( block ).instructions ) {
+      if ( instruction.result == NO_VALUE ) continue;
+
+      selection.blocks[instruction.result] = block;
+      label( selection, instruction, block );
+    }
+  }
+
+  for ( BlockId block : _layout ) {
+    index += static_cast<uint32_t>( _function.getBlock( block ).instructions.size() );
+  }
+
+  /* readers first, each deciding for the values only it reads */
+  for ( size_t position = _layout.size(); position > 0; position-- ) {
+    BlockId block = _layout[position - 1];
+    const std::vector<Instruction>& instructions = _function.getBlock( block ).instructions;
+
+    for ( size_t offset = instructions.size(); offset > 0; offset-- ) {
+      const Instruction& instruction = instructions[offset - 1];
+      Value result = instruction.result;
+
+      index--;
+
+      if ( instruction.opcode == Opcode::OpBranch ) {
+        Value condition = instruction.operands[0];
+
+        if ( operandCost( selection, condition, Form::FormFlags, block ) != UINT32_MAX ) {
+          fold( selection, condition, Form::FormFlags, index );
+        } else {
+          requireRegister( selection, condition );
+        }
+      } else if ( result == NO_VALUE || selection.emittedAt[result] != UINT32_MAX ) {
+        /* calls, tail calls, returns and phi copies read constants as immediates */
+        continue;
+      } else if ( instruction.opcode != Opcode::OpConstant ) {
+        selection.kept[result] = true;
+        selection.emittedAt[result] = index;
+        produce( selection, result, Form::FormRegister, index );
+      }
+    }
+  }
+
+  /* a constant loaded into a register is loaded where it is defined */
+  for ( BlockId block : _layout ) {
+    for ( const Instruction& instruction : _function.getBlock( block ).instructions ) {
+      if ( instruction.opcode == Opcode::OpConstant && selection.kept[instruction.result] ) {
+        selection.emittedAt[instruction.result] = index;
+      }
+
+      index++;
+    }
+  }
+
+  return selection;
+}
+
+/* the index in layout order an instruction reads its operands at, that of the instruction it was folded into */
+uint32_t readAt( const Selection& _selection, const Instruction& _instruction, const uint32_t _index ) {
+  if ( _instruction.result == NO_VALUE || _selection.kept[_instruction.result] ) {
+    return _index;
+  }
+
+  return _selection.emittedAt[_instruction.result];
+}
+
+/* whether the code selected for _instruction leaves a high half or a remainder in rdx */
+bool clobbersRdx( const Selection& _selection, const Instruction& _instruction ) {
+  if ( _instruction.result == NO_VALUE || !_selection.kept[_instruction.result] ) {
+    return false;
+  }
+
+  Pattern pattern = selectedRule( _selection, _instruction.result, Form::FormRegister ).pattern;
+
+  /* a power of two divides by shifting */
+  return pattern == Pattern::PatternDivide || (
+    pattern == Pattern::PatternReducedDivide &&
+    powerOfTwo( magnitude( _selection.definitions[_instruction.operands[1]]->word ) ) < 0
+  );
+}
+
+/*
+ * the operand whose register the code selected for _instruction is best computed in, the one it moves into the
+ * result before operating on it, NO_VALUE for none
+ */
+Value coalescedOperand( const Selection& _selection, const Instruction& _instruction ) {
+  if ( _instruction.result == NO_VALUE || !_selection.kept[_instruction.result] ) {
+    return NO_VALUE;
+  }
+
+  const SelectionRule& rule = selectedRule( _selection, _instruction.result, Form::FormRegister );
+
+  switch ( rule.pattern ) {
+    case Pattern::PatternScale:
+      return _instruction.operands[1 - immediateOperand( rule )];
+    case Pattern::PatternArithmetic:
+    case Pattern::PatternXor:
+    case Pattern::PatternMultiply:
+    case Pattern::PatternUntaggedMultiply:
+      return rule.left == Form::FormRegister ? _instruction.operands[0] : NO_VALUE;
+    case Pattern::PatternUntag:
+      return _instruction.operands[0];
+    default:
+      return NO_VALUE;
+  }
+}
+
+#endif
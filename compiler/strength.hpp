@@ -0,0 +1,109 @@
+#ifndef _STRENGTH_HPP
+#define _STRENGTH_HPP
+
+#include <cstdint>
+
+/*
+ * strength reduction of multiplications and divisions by a constant, which instruction selection ( see
+ * compiler/select.hpp ) compiles to shifts, lea and multiplications by a magic number rather than imul and idiv
+ *
+ * integers are tagged, shifted left by one; a word times an untagged constant is the tagged product as it is, and a
+ * word divided by the constant's word is the untagged quotient, as the tags cancel out, so no operand is untagged
+ */
+
+/* a multiplier lea takes an index by, less one, as the base is added too */
+const int64_t LEA_MULTIPLIERS[] = { 3, 5, 9 };
+
+uint64_t magnitude( const int64_t _value ) {
+  return _value < 0 ? 0 - static_cast<uint64_t>( _value ) : static_cast<uint64_t>( _value );
+}
+
+/* log2 of _value when it is a power of two, -1 otherwise */
+int powerOfTwo( const uint64_t _value ) {
+  if ( _value == 0 || ( _value & ( _value - 1 ) ) != 0 ) {
+    return -1;
+  }
+
+  int exponent = 0;
+
+  while ( ( _value >> exponent ) != 1 ) {
+    exponent++;
+  }
+
+  return exponent;
+}
+
+/*
+ * _multiplier as a power of two times one of LEA_MULTIPLIERS, or times one; false when it is neither, and so needs an
+ * imul
+ */
+bool shiftedMultiplier( const uint64_t _multiplier, int64_t& _factor, int& _shift ) {
+  for ( int64_t factor : LEA_MULTIPLIERS ) {
+    uint64_t unsignedFactor = static_cast<uint64_t>( factor );
+
+    if ( _multiplier % unsignedFactor == 0 && powerOfTwo( _multiplier / unsignedFactor ) >= 0 ) {
+      _factor = factor;
+      _shift = powerOfTwo( _multiplier / unsignedFactor );
+      return true;
+    }
+  }
+
+  _factor = 1;
+  _shift = powerOfTwo( _multiplier );
+
+  return _shift >= 0;
+}
+
+struct DivisionMagic {
+  int64_t multiplier;
+  int shift;
+};
+
+/*
+ * the multiplier whose high half, shifted right, is the quotient by _divisor, as in Hacker's Delight 10-1; _divisor
+ * is neither a power of two nor the negative of one
+ */
+DivisionMagic divisionMagic( const int64_t _divisor ) {
+  const uint64_t twoTo63 = static_cast<uint64_t>( 1 ) << 63;
+  uint64_t divisor = magnitude( _divisor );
+  uint64_t bound = twoTo63 + ( static_cast<uint64_t>( _divisor ) >> 63 );
+  /* the largest dividend whose remainder is divisor - 1 */
+  uint64_t limit = bound - 1 - bound % divisor;
+  uint64_t quotientLimit = twoTo63 / limit;
+  uint64_t remainderLimit = twoTo63 - quotientLimit * limit;
+  uint64_t quotientDivisor = twoTo63 / divisor;
+  uint64_t remainderDivisor = twoTo63 - quotientDivisor * divisor;
+  int precision = 63;
+  uint64_t delta;
+
+  do {
+    precision++;
+
+    quotientLimit *= 2;
+    remainderLimit *= 2;
+
+    if ( remainderLimit >= limit ) {
+      quotientLimit++;
+      remainderLimit -= limit;
+    }
+
+    quotientDivisor *= 2;
+    remainderDivisor *= 2;
+
+    if ( remainderDivisor >= divisor ) {
+      quotientDivisor++;
+      remainderDivisor -= divisor;
+    }
+
+    delta = divisor - remainderDivisor;
+  } while ( quotientLimit < delta || ( quotientLimit == delta && remainderLimit == 0 ) );
+
+  uint64_t multiplier = quotientDivisor + 1;
+
+  return {
+    static_cast<int64_t>( _divisor < 0 ? 0 - multiplier : multiplier ),
+    precision - 64,
+  };
+}
+
+#endif
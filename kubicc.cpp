@@ -1,26 +1,151 @@
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <sys/stat.h>
+#include <thread>
 
 #include "compiler/compiler.hpp"
+#include "compiler/modules.hpp"
+#include "parser/incremental.hpp"
 #include "parser/parser.hpp"
 #include "shared/errors.hpp"
 
+const std::chrono::milliseconds WATCH_INTERVAL( 100 );
+
+bool modifiedSince( const std::string _filename, struct timespec& _modified ) {
+  struct stat status;
+
+  if ( stat( _filename.c_str(), &status ) != 0 ) {
+    return false;
+  }
+
+  bool modified = status.st_mtim.tv_sec != _modified.tv_sec || status.st_mtim.tv_nsec != _modified.tv_nsec;
+  _modified = status.st_mtim;
+
+  return modified;
+}
+
+/* recompiles on every save, each save is applied to the open document as a single edit */
+int watch( const std::string _filename ) {
+  struct timespec modified = {};
+  modifiedSince( _filename, modified );
+
+  Document document( _filename );
+
+  while ( true ) {
+    std::vector<LogEntry> diagnostics = document.getDiagnostics();
+
+    if ( diagnostics.empty() ) {
+      compile( document.getRoot(), "main" );
+    } else {
+      restoreErrors( diagnostics );
+      printErrors();
+    }
+
+    do {
+      std::this_thread::sleep_for( WATCH_INTERVAL );
+    } while ( !modifiedSince( _filename, modified ) );
+
+    std::ifstream file( _filename, std::ios::binary );
+    std::string text( ( std::istreambuf_iterator<char>( file ) ), std::istreambuf_iterator<char>() );
+    std::string_view content = document.getContent();
+
+    /* the edit is whatever lies between the common prefix and the common suffix */
+    size_t prefix = 0;
+    size_t suffix = 0;
+
+    while ( prefix < content.length() && prefix < text.length() && content[prefix] == text[prefix] ) {
+      prefix++;
+    }
+
+    while (
+      suffix < content.length() - prefix && suffix < text.length() - prefix &&
+      content[content.length() - suffix - 1] == text[text.length() - suffix - 1]
+    ) {
+      suffix++;
+    }
+
+    document.edit(
+      static_cast<uint32_t>( prefix ),
+      static_cast<uint32_t>( content.length() - prefix - suffix ),
+      std::string_view( text ).substr( prefix, text.length() - prefix - suffix )
+    );
+  }
+
+  return 0;
+}
+
 int main( int argc, char* argv[] ) {
+  bool emitIr = false;
+  bool peepholeStats = false;
+  bool inlineStats = false;
+  int argument = 1;
+
   if ( argc == 1 ) {
     /* print info and usage message */
     return 1;
-  } else {
-    Node* root = parse( argv[1] );
+  } else if ( std::string( argv[1] ) == "--watch" && argc > 2 ) {
+    return watch( argv[2] );
+  }
 
-    if ( !root ) {
-      printErrors();
+  /* options go before the file; --emit-ir prints the IR of every module to stdout as well */
+  for ( ; argument < argc - 1 && std::string( argv[argument] ).rfind( "--", 0 ) == 0; argument++ ) {
+    std::string option( argv[argument] );
+    std::string disabled = "--no-peephole=";
+    std::string threshold = "--inline-threshold=";
+
+    if ( option == "--emit-ir" ) {
+      emitIr = true;
+    } else if ( option == "--peephole-stats" ) {
+      peepholeStats = true;
+    } else if ( option == "--inline-stats" ) {
+      inlineStats = true;
+    } else if ( option.rfind( threshold, 0 ) == 0 ) {
+      /* the most instructions a function may cost to be inlined */
+      std::string cost = option.substr( threshold.length() );
 
-      return 10;
+      if ( cost.empty() || cost.length() > 9 || cost.find_first_not_of( "0123456789" ) != std::string::npos ) {
+        std::cerr << "invalid inline threshold '" << cost << "'" << std::endl;
+        return 1;
+      }
+
+      inlineThreshold = static_cast<uint32_t>( std::stoul( cost ) );
+    } else if ( option == "--no-peephole" ) {
+      disablePeepholeRule( "" );
+    } else if ( option.rfind( disabled, 0 ) == 0 ) {
+      /* a comma separated list of rule names */
+      std::stringstream names( option.substr( disabled.length() ) );
+      std::string name;
+
+      while ( std::getline( names, name, ',' ) ) {
+        if ( !disablePeepholeRule( name ) ) {
+          std::cerr << "unknown peephole rule '" << name << "'" << std::endl;
+          return 1;
+        }
+      }
+    } else {
+      std::cerr << "unknown option '" << option << "'" << std::endl;
+      return 1;
     }
+  }
+
+  ModuleGraph modules( emitIr );
+
+  if ( !modules.build( argv[argument] ) ) {
+    printErrors();
+
+    return 10;
+  }
+
+  if ( peepholeStats ) {
+    std::cout << peepholeReport();
+  }
 
-    compile( root, "main" );
+  if ( inlineStats ) {
+    std::cout << modules.inlineReport();
   }
 
   return 0;
-}
\ No newline at end of file
+}
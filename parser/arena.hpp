@@ -0,0 +1,120 @@
+#ifndef _ARENA_HPP
+#define _ARENA_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/* 32-bit reference into the node arena, the chunk in the upper bits and the unit within the chunk in the lower */
+typedef uint32_t ArenaRef;
+
+const ArenaRef NO_REF = UINT32_MAX;
+
+/* allocations are made in 8-byte units, a chunk holds 2^16 units */
+const uint32_t ARENA_UNIT = 8;
+
+const uint32_t ARENA_CHUNK_BITS = 16;
+
+const uint32_t ARENA_CHUNK_UNITS = 1u << ARENA_CHUNK_BITS;
+
+/*
+ * bump allocator holding every node of a tree along with their child lists and text; chunks never move, so pointers
+ * into the arena stay valid until it is cleared, which frees the whole tree at once without visiting a node
+ */
+class NodeArena {
+  private:
+    std::vector<std::unique_ptr<uint64_t[]>> chunks;
+    /* chunk being bumped, allocations too large for a chunk get one of their own */
+    uint32_t current;
+    uint32_t used;
+    size_t allocated;
+
+  public:
+    NodeArena() : current( NO_REF ), used( ARENA_CHUNK_UNITS ), allocated( 0 ) {}
+
+    ArenaRef allocate( const size_t _bytes ) {
+      uint32_t units = static_cast<uint32_t>( ( _bytes + ARENA_UNIT - 1 ) / ARENA_UNIT );
+      allocated += units * ARENA_UNIT;
+
+      if ( units > ARENA_CHUNK_UNITS / 4 ) {
+        chunks.push_back( std::unique_ptr<uint64_t[]>( new uint64_t[units] ) );
+        return static_cast<ArenaRef>( chunks.size() - 1 ) << ARENA_CHUNK_BITS;
+      }
+
+      if ( used + units > ARENA_CHUNK_UNITS ) {
+        chunks.push_back( std::unique_ptr<uint64_t[]>( new uint64_t[ARENA_CHUNK_UNITS] ) );
+        current = static_cast<uint32_t>( chunks.size() - 1 );
+        used = 0;
+      }
+
+      ArenaRef ref = current << ARENA_CHUNK_BITS | used;
+      used += units;
+
+      return ref;
+    }
+
+    void* at( const ArenaRef _ref ) const {
+      return chunks[_ref >> ARENA_CHUNK_BITS].get() + ( _ref & ( ARENA_CHUNK_UNITS - 1 ) );
+    }
+
+    template<typename T, typename... Arguments>
+    T* make( Arguments&&... _arguments ) {
+      static_assert( std::is_trivially_destructible<T>::value, "nodes are freed with the arena, never destroyed" );
+
+      ArenaRef ref = allocate( sizeof( T ) );
+      T* node = new ( at( ref ) ) T( std::forward<Arguments>( _arguments )... );
+      node->ref = ref;
+
+      return node;
+    }
+
+    template<typename T>
+    T* get( const ArenaRef _ref ) const {
+      return _ref == NO_REF ? nullptr : static_cast<T*>( at( _ref ) );
+    }
+
+    /* copies _count elements into the arena, returning a reference to the copy */
+    template<typename T>
+    ArenaRef copy( const T* _elements, const size_t _count ) {
+      static_assert( std::is_trivially_copyable<T>::value, "arrays are copied bytewise" );
+
+      if ( _count == 0 ) {
+        return NO_REF;
+      }
+
+      ArenaRef ref = allocate( sizeof( T ) * _count );
+      memcpy( at( ref ), _elements, sizeof( T ) * _count );
+
+      return ref;
+    }
+
+    ArenaRef copy( const std::string_view _text ) {
+      return copy( _text.data(), _text.length() );
+    }
+
+    std::string_view getText( const ArenaRef _ref, const uint32_t _length ) const {
+      return _ref == NO_REF ? std::string_view() : std::string_view( static_cast<const char*>( at( _ref ) ), _length );
+    }
+
+    /* bytes handed out since the arena was last cleared */
+    size_t size() const {
+      return allocated;
+    }
+
+    void clear() {
+      chunks.clear();
+      current = NO_REF;
+      used = ARENA_CHUNK_UNITS;
+      allocated = 0;
+    }
+};
+
+/* per thread, a module's tree never leaves the thread that parses it */
+static thread_local NodeArena nodeArena;
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef _CHARCLASS_HPP
+#define _CHARCLASS_HPP
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#if defined( __AVX2__ ) || defined( __SSE2__ )
+#include <immintrin.h>
+#endif
+
+enum CharClass : uint8_t {
+  CharNone = 0,
+  CharWhitespace = 1 << 0,
+  CharNewline = 1 << 1,
+  CharComma = 1 << 2,
+  CharOperator = 1 << 3,
+  CharArithmeticGrouper = 1 << 4,
+  CharStatementGrouper = 1 << 5,
+  CharAlpha = 1 << 6,
+  CharIdentifier = 1 << 7,
+};
+
+/* characters that end a word token */
+constexpr uint8_t CHAR_DELIMITER =
+  CharWhitespace | CharNewline | CharComma | CharOperator | CharArithmeticGrouper | CharStatementGrouper;
+
+constexpr std::string_view WHITESPACE_CHARACTERS = " \t";
+
+constexpr std::string_view OPERATOR_CHARACTERS = ":\\&|^!=><%+-*/.";
+
+constexpr std::string_view ARITHMETIC_GROUPER_CHARACTERS = "()";
+
+constexpr std::string_view STATEMENT_GROUPER_CHARACTERS = "{}";
+
+/* digit values up to base 16, only lowercase hexadecimal digits are accepted */
+constexpr uint8_t DIGIT_INVALID = 0xFF;
+
+constexpr std::array<uint8_t, 256> buildCharClasses() {
+  std::array<uint8_t, 256> classes = {};
+
+  for ( char c : WHITESPACE_CHARACTERS ) classes[static_cast<uint8_t>( c )] |= CharWhitespace;
+  for ( char c : OPERATOR_CHARACTERS ) classes[static_cast<uint8_t>( c )] |= CharOperator;
+  for ( char c : ARITHMETIC_GROUPER_CHARACTERS ) classes[static_cast<uint8_t>( c )] |= CharArithmeticGrouper;
+  for ( char c : STATEMENT_GROUPER_CHARACTERS ) classes[static_cast<uint8_t>( c )] |= CharStatementGrouper;
+
+  classes[static_cast<uint8_t>( '\n' )] |= CharNewline;
+  classes[static_cast<uint8_t>( ',' )] |= CharComma;
+  classes[static_cast<uint8_t>( '_' )] |= CharIdentifier;
+
+  for ( size_t c = 'a'; c <= 'z'; c++ ) classes[c] |= CharAlpha | CharIdentifier;
+  for ( size_t c = 'A'; c <= 'Z'; c++ ) classes[c] |= CharAlpha | CharIdentifier;
+  for ( size_t c = '0'; c <= '9'; c++ ) classes[c] |= CharIdentifier;
+
+  return classes;
+}
+
+constexpr std::array<uint8_t, 256> buildDigitValues() {
+  std::array<uint8_t, 256> values = {};
+
+  for ( uint8_t& value : values ) value = DIGIT_INVALID;
+  for ( size_t c = '0'; c <= '9'; c++ ) values[c] = static_cast<uint8_t>( c - '0' );
+  for ( size_t c = 'a'; c <= 'f'; c++ ) values[c] = static_cast<uint8_t>( c - 'a' + 10 );
+
+  return values;
+}
+
+constexpr std::array<uint8_t, 256> CHAR_CLASSES = buildCharClasses();
+
+constexpr std::array<uint8_t, 256> DIGIT_VALUES = buildDigitValues();
+
+constexpr bool hasCharClass( const char _char, const uint8_t _classes ) {
+  return CHAR_CLASSES[static_cast<uint8_t>( _char )] & _classes;
+}
+
+constexpr uint8_t digitValue( const char _char ) {
+  return DIGIT_VALUES[static_cast<uint8_t>( _char )];
+}
+
+/*
+ * vectorized scanners, each returns the first position in [_begin, _end) that does not belong to the run; full
+ * vectors are only loaded while they fit before _end, the remainder goes through the table
+ */
+
+#if defined( __AVX2__ )
+inline uint32_t identifierMask( const __m256i _chunk ) {
+  const __m256i lowered = _mm256_or_si256( _chunk, _mm256_set1_epi8( 0x20 ) );
+  const __m256i alpha = _mm256_and_si256(
+    _mm256_cmpgt_epi8( lowered, _mm256_set1_epi8( 'a' - 1 ) ),
+    _mm256_cmpgt_epi8( _mm256_set1_epi8( 'z' + 1 ), lowered )
+  );
+  const __m256i digit = _mm256_and_si256(
+    _mm256_cmpgt_epi8( _chunk, _mm256_set1_epi8( '0' - 1 ) ),
+    _mm256_cmpgt_epi8( _mm256_set1_epi8( '9' + 1 ), _chunk )
+  );
+  const __m256i underscore = _mm256_cmpeq_epi8( _chunk, _mm256_set1_epi8( '_' ) );
+  const __m256i identifier = _mm256_or_si256( alpha, _mm256_or_si256( digit, underscore ) );
+
+  return static_cast<uint32_t>( _mm256_movemask_epi8( identifier ) );
+}
+
+inline uint32_t whitespaceMask( const __m256i _chunk ) {
+  const __m256i space = _mm256_cmpeq_epi8( _chunk, _mm256_set1_epi8( ' ' ) );
+  const __m256i tab = _mm256_cmpeq_epi8( _chunk, _mm256_set1_epi8( '\t' ) );
+
+  return static_cast<uint32_t>( _mm256_movemask_epi8( _mm256_or_si256( space, tab ) ) );
+}
+
+constexpr size_t SCAN_WIDTH = 32;
+
+#define KUBIC_SCAN_LOAD( _pointer ) _mm256_loadu_si256( reinterpret_cast<const __m256i*>( _pointer ) )
+#define KUBIC_SCAN_FULL 0xFFFFFFFFu
+#elif defined( __SSE2__ )
+inline uint32_t identifierMask( const __m128i _chunk ) {
+  const __m128i lowered = _mm_or_si128( _chunk, _mm_set1_epi8( 0x20 ) );
+  const __m128i alpha = _mm_and_si128(
+    _mm_cmpgt_epi8( lowered, _mm_set1_epi8( 'a' - 1 ) ), _mm_cmplt_epi8( lowered, _mm_set1_epi8( 'z' + 1 ) )
+  );
+  const __m128i digit = _mm_and_si128(
+    _mm_cmpgt_epi8( _chunk, _mm_set1_epi8( '0' - 1 ) ), _mm_cmplt_epi8( _chunk, _mm_set1_epi8( '9' + 1 ) )
+  );
+  const __m128i underscore = _mm_cmpeq_epi8( _chunk, _mm_set1_epi8( '_' ) );
+  const __m128i identifier = _mm_or_si128( alpha, _mm_or_si128( digit, underscore ) );
+
+  return static_cast<uint32_t>( _mm_movemask_epi8( identifier ) );
+}
+
+inline uint32_t whitespaceMask( const __m128i _chunk ) {
+  const __m128i space = _mm_cmpeq_epi8( _chunk, _mm_set1_epi8( ' ' ) );
+  const __m128i tab = _mm_cmpeq_epi8( _chunk, _mm_set1_epi8( '\t' ) );
+
+  return static_cast<uint32_t>( _mm_movemask_epi8( _mm_or_si128( space, tab ) ) );
+}
+
+constexpr size_t SCAN_WIDTH = 16;
+
+#define KUBIC_SCAN_LOAD( _pointer ) _mm_loadu_si128( reinterpret_cast<const __m128i*>( _pointer ) )
+#define KUBIC_SCAN_FULL 0xFFFFu
+#endif
+
+inline const char* scanClass( const char* _begin, const char* _end, const uint8_t _classes ) {
+  while ( _begin < _end && hasCharClass( *_begin, _classes ) ) {
+    _begin++;
+  }
+
+  return _begin;
+}
+
+/* run of [A-Za-z0-9_], covers both identifier and digit runs */
+inline const char* scanIdentifier( const char* _begin, const char* _end ) {
+#ifdef KUBIC_SCAN_FULL
+  while ( _begin + SCAN_WIDTH <= _end ) {
+    uint32_t mask = identifierMask( KUBIC_SCAN_LOAD( _begin ) );
+
+    if ( mask != KUBIC_SCAN_FULL ) {
+      return _begin + __builtin_ctz( ~mask );
+    }
+
+    _begin += SCAN_WIDTH;
+  }
+#endif
+
+  return scanClass( _begin, _end, CharIdentifier );
+}
+
+inline const char* skipWhitespace( const char* _begin, const char* _end ) {
+#ifdef KUBIC_SCAN_FULL
+  while ( _begin + SCAN_WIDTH <= _end ) {
+    uint32_t mask = whitespaceMask( KUBIC_SCAN_LOAD( _begin ) );
+
+    if ( mask != KUBIC_SCAN_FULL ) {
+      return _begin + __builtin_ctz( ~mask );
+    }
+
+    _begin += SCAN_WIDTH;
+  }
+#endif
+
+  return scanClass( _begin, _end, CharWhitespace );
+}
+
+/* whether _begin is at a '.' of a word rather than the start of a range, so 1.5 is lexed as one invalid token */
+inline bool wordDot( const char* _begin, const char* _end ) {
+  return *_begin == '.' && ( _begin + 1 == _end || _begin[1] != '.' );
+}
+
+/* run of any characters up to the next delimiter, the identifier prefix is scanned vectorized */
+inline const char* scanWord( const char* _begin, const char* _end ) {
+  _begin = scanIdentifier( _begin, _end );
+
+  while ( _begin < _end && ( !hasCharClass( *_begin, CHAR_DELIMITER ) || wordDot( _begin, _end ) ) ) {
+    _begin++;
+  }
+
+  return _begin;
+}
+
+#endif
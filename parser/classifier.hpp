@@ -0,0 +1,249 @@
+#ifndef _CLASSIFIER_HPP
+#define _CLASSIFIER_HPP
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "parser/charclass.hpp"
+#include "shared/symbols.hpp"
+#include "shared/types.hpp"
+
+/*
+ * keywords and operators are looked up in perfect hash tables whose seed is searched for at compile time, so a word
+ * is classified with a single hash and a single comparison
+ */
+
+struct HashEntry {
+  std::string_view text;
+  uint8_t id;
+};
+
+constexpr std::array<HashEntry, 17> KEYWORD_ENTRIES = { {
+  /* value type keywords */
+  { "boolean", KeywordId::KeywordBoolean }, { "integer", KeywordId::KeywordInteger },
+
+  /* operator keywords */
+  { "define", KeywordId::KeywordDefine },
+
+  /* conditional */
+  { "if", KeywordId::KeywordIf }, { "elif", KeywordId::KeywordElif }, { "else", KeywordId::KeywordElse },
+
+  /* boolean literals */
+  { "true", KeywordId::KeywordTrue }, { "false", KeywordId::KeywordFalse },
+
+  /* modules */
+  { "import", KeywordId::KeywordImport }, { "from", KeywordId::KeywordFrom },
+
+  /* functions */
+  { "function", KeywordId::KeywordFunction }, { "return", KeywordId::KeywordReturn },
+  { "inline", KeywordId::KeywordInline }, { "noinline", KeywordId::KeywordNoInline },
+
+  /* loops */
+  { "for", KeywordId::KeywordFor }, { "in", KeywordId::KeywordIn }, { "while", KeywordId::KeywordWhile },
+} };
+
+constexpr std::array<HashEntry, 18> OPERATOR_ENTRIES = { {
+  { "::", OperatorId::OperatorTypeDefine }, { "=", OperatorId::OperatorAssign },
+
+  { "+", OperatorId::OperatorAdd }, { "-", OperatorId::OperatorSubtract },
+  { "*", OperatorId::OperatorMultiply }, { "/", OperatorId::OperatorDivide }, { "%", OperatorId::OperatorModulo },
+
+  { "<", OperatorId::OperatorLess }, { ">", OperatorId::OperatorGreater },
+  { "<=", OperatorId::OperatorLessEqual }, { ">=", OperatorId::OperatorGreaterEqual },
+  { "==", OperatorId::OperatorEqual }, { "!=", OperatorId::OperatorNotEqual },
+
+  { "&&", OperatorId::OperatorAnd }, { "||", OperatorId::OperatorOr }, { "^", OperatorId::OperatorXor },
+  { "!", OperatorId::OperatorNot },
+
+  /* the integers of a counted loop, from the first up to but not including the second */
+  { "..", OperatorId::OperatorRange },
+} };
+
+constexpr uint32_t hashText( const std::string_view _text, const uint32_t _seed ) {
+  uint32_t hash = _seed;
+
+  for ( char c : _text ) {
+    hash = ( hash ^ static_cast<uint8_t>( c ) ) * 16777619u;
+  }
+
+  return hash;
+}
+
+template<size_t SIZE>
+struct PerfectHashTable {
+  uint32_t seed;
+  std::array<std::string_view, SIZE> texts;
+  std::array<uint8_t, SIZE> ids;
+
+  uint8_t find( const std::string_view _text ) const {
+    size_t slot = hashText( _text, seed ) & ( SIZE - 1 );
+
+    return texts[slot] == _text ? ids[slot] : 0;
+  }
+};
+
+template<size_t SIZE, size_t COUNT>
+constexpr PerfectHashTable<SIZE> buildPerfectHash( const std::array<HashEntry, COUNT>& _entries ) {
+  static_assert( ( SIZE & ( SIZE - 1 ) ) == 0, "perfect hash table size must be a power of two" );
+
+  PerfectHashTable<SIZE> table = {};
+
+  for ( uint32_t seed = 1; seed < 1u << 16; seed++ ) {
+    std::array<bool, SIZE> used = {};
+    bool collision = false;
+
+    for ( const HashEntry& entry : _entries ) {
+      size_t slot = hashText( entry.text, seed ) & ( SIZE - 1 );
+      collision = collision || used[slot];
+      used[slot] = true;
+    }
+
+    if ( !collision ) {
+      table.seed = seed;
+
+      for ( const HashEntry& entry : _entries ) {
+        size_t slot = hashText( entry.text, seed ) & ( SIZE - 1 );
+        table.texts[slot] = entry.text;
+        table.ids[slot] = entry.id;
+      }
+
+      return table;
+    }
+  }
+
+  return table;
+}
+
+constexpr PerfectHashTable<64> KEYWORDS = buildPerfectHash<64>( KEYWORD_ENTRIES );
+
+constexpr PerfectHashTable<64> OPERATORS = buildPerfectHash<64>( OPERATOR_ENTRIES );
+
+static_assert( KEYWORDS.seed != 0, "no perfect hash seed found for the keywords" );
+
+static_assert( OPERATORS.seed != 0, "no perfect hash seed found for the operators" );
+
+/* keywords are interned up front and looked up by id, so keyword tokens need not carry a symbol of their own */
+std::array<Symbol, KEYWORD_ENTRIES.size() + 1> internKeywords() {
+  std::array<Symbol, KEYWORD_ENTRIES.size() + 1> symbols;
+  symbols.fill( NO_SYMBOL );
+
+  for ( const HashEntry& entry : KEYWORD_ENTRIES ) {
+    symbols[entry.id] = interner.intern( entry.text );
+  }
+
+  return symbols;
+}
+
+const std::array<Symbol, KEYWORD_ENTRIES.size() + 1> KEYWORD_SYMBOLS = internKeywords();
+
+/* text of an operator as written, for diagnostics */
+std::string_view operatorText( const OperatorId _operator ) {
+  for ( const HashEntry& entry : OPERATOR_ENTRIES ) {
+    if ( entry.id == _operator ) {
+      return entry.text;
+    }
+  }
+
+  return std::string_view();
+}
+
+/* largest literal whose tagged form, value << 1, still fits in 64 bits */
+constexpr int64_t NUMERIC_LIMIT = INT64_MAX >> 1;
+
+enum NumericStatus {
+  NumericValid,
+  NumericInvalid,
+  NumericOverflow,
+};
+
+int numericBase( const char _prefix ) {
+  switch ( _prefix ) {
+    case 'b':
+      return 2;
+    case 'o':
+      return 8;
+    case 'd':
+      return 10;
+    case 'x':
+      return 16;
+    default:
+      return 0;
+  }
+}
+
+/* validates and decodes a literal with an optional 0b/0o/0d/0x prefix in the same pass */
+NumericStatus decodeNumeric( std::string_view _text, int64_t& _value ) {
+  int base = 10;
+
+  if ( _text.length() > 2 && _text[0] == '0' && numericBase( _text[1] ) ) {
+    base = numericBase( _text[1] );
+    _text.remove_prefix( 2 );
+  }
+
+  NumericStatus status = NumericStatus::NumericValid;
+  _value = 0;
+
+  for ( char c : _text ) {
+    uint8_t digit = digitValue( c );
+
+    if ( digit >= base ) {
+      return NumericStatus::NumericInvalid;
+    }
+
+    if ( _value > ( NUMERIC_LIMIT - digit ) / base ) {
+      status = NumericStatus::NumericOverflow;
+    } else {
+      _value = _value * base + digit;
+    }
+  }
+
+  return status;
+}
+
+/* classification of a single token, _code holds its keyword or operator id, _value a decoded literal */
+struct Classification {
+  TokenType type;
+  uint8_t code;
+  int64_t value;
+  NumericStatus numeric;
+};
+
+Classification classifyWord( const std::string_view _text ) {
+  Classification classification = { TokenType::TokenUndefined, 0, 0, NumericStatus::NumericValid };
+  char head = _text[0];
+
+  if ( hasCharClass( head, CharClass::CharAlpha ) || head == '_' ) {
+    uint8_t keyword = KEYWORDS.find( _text );
+    const char* identifierEnd = scanIdentifier( _text.data(), _text.data() + _text.length() );
+
+    if ( keyword == KeywordId::KeywordTrue || keyword == KeywordId::KeywordFalse ) {
+      classification.type = TokenType::TokenBoolean;
+      classification.code = keyword;
+      classification.value = keyword == KeywordId::KeywordTrue;
+    } else if ( keyword ) {
+      classification.type = TokenType::TokenKeyword;
+      classification.code = keyword;
+    } else if ( identifierEnd == _text.data() + _text.length() && ( _text.length() > 1 || head != '_' ) ) {
+      classification.type = TokenType::TokenVariable;
+    }
+  } else if ( hasCharClass( head, CharClass::CharIdentifier ) ) {
+    classification.numeric = decodeNumeric( _text, classification.value );
+
+    if ( classification.numeric == NumericStatus::NumericValid ) {
+      classification.type = TokenType::TokenConstant;
+    }
+  }
+
+  return classification;
+}
+
+Classification classifyOperator( const std::string_view _text ) {
+  uint8_t operatorId = OPERATORS.find( _text );
+
+  return {
+    operatorId ? TokenType::TokenOperator : TokenType::TokenUndefined, operatorId, 0, NumericStatus::NumericValid
+  };
+}
+
+#endif
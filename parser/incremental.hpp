@@ -0,0 +1,497 @@
+#ifndef _INCREMENTAL_HPP
+#define _INCREMENTAL_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "parser/lexer.hpp"
+#include "parser/node.hpp"
+#include "parser/parser.hpp"
+#include "parser/resolver.hpp"
+#include "parser/tokenbuffer.hpp"
+#include "parser/tokenstream.hpp"
+#include "shared/environment.hpp"
+#include "shared/errors.hpp"
+#include "shared/source.hpp"
+
+typedef std::tuple<Symbol, ValueType> Declaration;
+
+/* a top-level statement, the unit the document re-parses after an edit */
+struct StatementSpan {
+  /* null when the statement did not parse */
+  Node* statement;
+  size_t firstToken;
+  /* base offset of the environment before the statement */
+  int environmentOffset;
+  /* bytes the statement has moved by since it was parsed, its locations are only moved once they are read */
+  int64_t shift;
+  /* arena bytes allocated while parsing the statement */
+  size_t size;
+  /* bindings the statement adds to the environment, in order */
+  std::vector<Declaration> declarations;
+  /* parse errors followed by resolve errors, the way a full parse reports them all before resolving */
+  std::vector<LogEntry> diagnostics;
+  size_t parseDiagnostics;
+};
+
+void collectDeclarations( const Node* _node, std::vector<Declaration>& _declarations ) {
+  if ( !_node ) {
+    return;
+  } else if ( _node->getNodeType() == NodeType::NodeBinding ) {
+    const Node* bindingExpression = ( (BindingNode*) _node )->getBindingExpression();
+
+    collectDeclarations( bindingExpression, _declarations );
+    _declarations.push_back( Declaration( _node->getSymbol(), bindingExpression->getValueType() ) );
+  } else if ( _node->getNodeType() == NodeType::NodeMultiStatement ) {
+    for ( Node* statement : ( (MultiStatementNode*) _node )->getStatements() ) {
+      collectDeclarations( statement, _declarations );
+    }
+  } else if ( _node->getNodeType() == NodeType::NodeConditional ) {
+    /* the bindings of a branch end with it */
+    collectDeclarations( ( (ConditionalNode*) _node )->getConditional(), _declarations );
+  } else if ( _node->getNodeType() == NodeType::NodeAssignment ) {
+    collectDeclarations( ( (AssignmentNode*) _node )->getExpression(), _declarations );
+  } else if ( _node->getNodeType() == NodeType::NodeWhile ) {
+    /* as do those of a loop's body, and the loop variable with them */
+    collectDeclarations( ( (WhileNode*) _node )->getConditional(), _declarations );
+  } else if ( _node->getNodeType() == NodeType::NodeFor ) {
+    collectDeclarations( ( (ForNode*) _node )->getFirst(), _declarations );
+    collectDeclarations( ( (ForNode*) _node )->getLast(), _declarations );
+  } else if ( _node->getNodeType() == NodeType::NodeFunction ) {
+    /* a function declares its name with its return type, followed by its parameters, calls are typed against all */
+    _declarations.push_back( Declaration( _node->getSymbol(), ( (FunctionNode*) _node )->getReturnType() ) );
+
+    for ( Node* parameter : ( (FunctionNode*) _node )->getParameters() ) {
+      _declarations.push_back( Declaration( parameter->getSymbol(), parameter->getValueType() ) );
+    }
+  }
+}
+
+SourceLocation relocate( const SourceLocation _location, const int64_t _shift ) {
+  if ( !_location.isValid() ) {
+    return _location;
+  }
+
+  return SourceLocation( _location.getFileId(), static_cast<uint32_t>( _location.getOffset() + _shift ) );
+}
+
+/* moves every location in a reused subtree along with the text it was parsed from */
+void relocateNode( Node* _node, const int64_t _shift ) {
+  if ( !_node ) {
+    return;
+  }
+
+  _node->setLocation( relocate( _node->getLocation(), _shift ) );
+
+  if ( _node->getNodeType() == NodeType::NodeBinding ) {
+    relocateNode( ( (BindingNode*) _node )->getBindingExpression(), _shift );
+  } else if ( _node->getNodeType() == NodeType::NodeUnaryOperator ) {
+    relocateNode( ( (UnaryOperatorNode*) _node )->getOperand(), _shift );
+  } else if ( _node->getNodeType() == NodeType::NodeBinaryOperator ) {
+    std::vector<BinaryOperatorNode*> spine = leftSpine( (BinaryOperatorNode*) _node );
+
+    for ( BinaryOperatorNode* node : spine ) {
+      if ( node != _node ) node->setLocation( relocate( node->getLocation(), _shift ) );
+
+      relocateNode( node->getRightOperand(), _shift );
+    }
+
+    relocateNode( spine.back()->getLeftOperand(), _shift );
+  } else if ( _node->getNodeType() == NodeType::NodeMultiStatement ) {
+    for ( Node* statement : ( (MultiStatementNode*) _node )->getStatements() ) {
+      relocateNode( statement, _shift );
+    }
+  } else if ( _node->getNodeType() == NodeType::NodeConditional ) {
+    relocateNode( ( (ConditionalNode*) _node )->getConditional(), _shift );
+    relocateNode( ( (ConditionalNode*) _node )->getUpperBody(), _shift );
+    relocateNode( ( (ConditionalNode*) _node )->getLowerBody(), _shift );
+  } else if ( _node->getNodeType() == NodeType::NodeFunctionCall ) {
+    for ( Node* argument : ( (FunctionCallNode*) _node )->getArguments() ) {
+      relocateNode( argument, _shift );
+    }
+  } else if ( _node->getNodeType() == NodeType::NodeFunction ) {
+    for ( Node* parameter : ( (FunctionNode*) _node )->getParameters() ) {
+      relocateNode( parameter, _shift );
+    }
+
+    relocateNode( ( (FunctionNode*) _node )->getBody(), _shift );
+  } else if ( _node->getNodeType() == NodeType::NodeReturn ) {
+    relocateNode( ( (ReturnNode*) _node )->getExpression(), _shift );
+  } else if ( _node->getNodeType() == NodeType::NodeAssignment ) {
+    relocateNode( ( (AssignmentNode*) _node )->getExpression(), _shift );
+  } else if ( _node->getNodeType() == NodeType::NodeWhile ) {
+    relocateNode( ( (WhileNode*) _node )->getConditional(), _shift );
+    relocateNode( ( (WhileNode*) _node )->getBody(), _shift );
+  } else if ( _node->getNodeType() == NodeType::NodeFor ) {
+    relocateNode( ( (ForNode*) _node )->getFirst(), _shift );
+    relocateNode( ( (ForNode*) _node )->getLast(), _shift );
+    relocateNode( ( (ForNode*) _node )->getBody(), _shift );
+  }
+}
+
+/*
+ * a source kept open across edits, as in watch mode; an edit re-lexes only the tokens around it and re-parses only
+ * the top-level statements ( an if statement with its blocks being one ) those tokens fall in, the subtrees of every
+ * other statement are reused as they are
+ */
+class Document {
+  private:
+    const SourceFile* source;
+    TokenBuffer tokens;
+    std::vector<StatementSpan> spans;
+    std::vector<std::pair<Symbol, FunctionInfo>> signatures;
+    /* built from the statements when first asked for after an edit */
+    Node* root;
+    /* arena bytes still referenced by a statement, the rest of the arena is left over from replaced statements */
+    size_t liveSize;
+
+    StatementSpan parseStatement( TokenStream& _tokens ) {
+      StatementSpan span = { nullptr, _tokens.getIndex(), getBaseOffset(), 0, nodeArena.size(), {}, {}, 0 };
+
+      span.statement = nodeify( _tokens );
+      /* errors met looking ahead to the next statement are reported with this one */
+      _tokens.empty();
+      _tokens.dropErrorsPastStop();
+      span.diagnostics = takeErrors();
+      span.parseDiagnostics = span.diagnostics.size();
+
+      resolve( span.statement );
+      collectDeclarations( span.statement, span.declarations );
+
+      for ( const LogEntry& diagnostic : takeErrors() ) {
+        span.diagnostics.push_back( diagnostic );
+      }
+
+      span.size = nodeArena.size() - span.size;
+
+      return span;
+    }
+
+    /* index of the span holding _token, statements past the last span are re-parsed with it */
+    size_t findSpan( const size_t _token ) const {
+      auto span = std::upper_bound(
+        spans.begin(),
+        spans.end(),
+        _token,
+        []( const size_t _index, const StatementSpan& _span ) { return _index < _span.firstToken; }
+      );
+
+      return span == spans.begin() ? 0 : static_cast<size_t>( span - spans.begin() ) - 1;
+    }
+
+    /* index of the first token that ends at or after _offset */
+    size_t findToken( const uint32_t _offset ) const {
+      size_t low = 0;
+      size_t high = tokens.size();
+
+      while ( low < high ) {
+        size_t middle = low + ( high - low ) / 2;
+        Token token = tokens.at( middle );
+
+        if ( token.getOffset() + token.getLength() < _offset ) {
+          low = middle + 1;
+        } else {
+          high = middle;
+        }
+      }
+
+      return low;
+    }
+
+    /* whether the functions the statements define have changed since the last edit, recording them as they are now */
+    bool redeclare() {
+      std::vector<std::pair<Symbol, FunctionInfo>> found;
+
+      for ( const StatementSpan& span : spans ) {
+        if ( !span.statement || span.statement->getNodeType() != NodeType::NodeFunction ) continue;
+
+        FunctionInfo info = functionInfo( (FunctionNode*) span.statement );
+        info.definition = NO_REF;
+        info.provisional = true;
+
+        found.push_back( { span.statement->getSymbol(), info } );
+      }
+
+      bool changed = found != signatures;
+      signatures = std::move( found );
+
+      return changed;
+    }
+
+    /*
+     * every function the statements defined after the last edit is declared before any statement is resolved, so a
+     * call may come before the function it calls as in a full parse; those before _firstSpan, which are not resolved
+     * again, are defined as resolving them would have
+     */
+    void declareFunctions( const size_t _firstSpan ) {
+      resetFunctions();
+
+      for ( const std::pair<Symbol, FunctionInfo>& signature : signatures ) {
+        if ( !getFunction( signature.first ) ) addFunction( signature.first, signature.second );
+      }
+
+      for ( size_t span = 0; span < _firstSpan; span++ ) {
+        Node* statement = spans[span].statement;
+
+        if (
+          statement && statement->getNodeType() == NodeType::NodeFunction &&
+          getFunction( statement->getSymbol() )->provisional
+        ) {
+          addFunction( statement->getSymbol(), functionInfo( (FunctionNode*) statement ) );
+        }
+      }
+    }
+
+    static size_t shiftIndex( const size_t _index, const int64_t _shift ) {
+      return static_cast<size_t>( static_cast<int64_t>( _index ) + _shift );
+    }
+
+
+  public:
+    Document( const std::string _filename )
+      : source( sourceManager.load( _filename ) ), root( nullptr ), liveSize( 0 ) {
+      /* the whole source is lexed and parsed as an empty edit, which also leaves the file on disk free to change */
+      edit( 0, 0, "" );
+    }
+
+    Document( const Document& ) = delete;
+
+    Document& operator=( const Document& ) = delete;
+
+    Node* getRoot() {
+      for ( StatementSpan& span : spans ) {
+        if ( span.shift != 0 ) {
+          relocateNode( span.statement, span.shift );
+
+          for ( LogEntry& diagnostic : span.diagnostics ) {
+            diagnostic.setLocation( relocate( diagnostic.getLocation(), span.shift ) );
+          }
+
+          span.shift = 0;
+        }
+      }
+
+      if ( !root ) {
+        std::vector<Node*> statements;
+
+        for ( const StatementSpan& span : spans ) {
+          if ( span.statement ) statements.push_back( span.statement );
+        }
+
+        root = nodeArena.make<MultiStatementNode>(
+          statements.empty() ? SourceLocation() : statements[0]->getLocation(), statements
+        );
+      }
+
+      return root;
+    }
+
+    std::string_view getContent() const {
+      return source->getContent();
+    }
+
+    std::vector<LogEntry> getDiagnostics() const {
+      std::vector<LogEntry> diagnostics;
+
+      for ( bool parseErrors : { true, false } ) {
+        for ( const StatementSpan& span : spans ) {
+          size_t first = parseErrors ? 0 : span.parseDiagnostics;
+          size_t last = parseErrors ? span.parseDiagnostics : span.diagnostics.size();
+
+          for ( size_t index = first; index < last; index++ ) {
+            LogEntry diagnostic = span.diagnostics[index];
+            diagnostic.setLocation( relocate( diagnostic.getLocation(), span.shift ) );
+            diagnostics.push_back( diagnostic );
+          }
+        }
+      }
+
+      return diagnostics;
+    }
+
+    /* replaces _length characters from _offset with _text */
+    void edit( const uint32_t _offset, const uint32_t _length, const std::string_view _text ) {
+      const int64_t shift = static_cast<int64_t>( _text.length() ) - _length;
+      const uint32_t editEnd = _offset + _length;
+
+      /* a token ending right where the edit starts may be extended by it */
+      size_t firstToken = findToken( _offset );
+      uint32_t relexOffset = _offset;
+
+      /* and so may a word running into that token, as a '.' ends a word only when a range starts there */
+      if ( firstToken > 0 && firstToken < tokens.size() ) {
+        Token previous = tokens.at( firstToken - 1 );
+
+        if ( previous.getOffset() + previous.getLength() == tokens.at( firstToken ).getOffset() ) firstToken--;
+      }
+
+      if ( firstToken < tokens.size() ) {
+        relexOffset = std::min( relexOffset, tokens.at( firstToken ).getOffset() );
+      }
+
+      sourceManager.edit( source->getId(), _offset, _length, _text );
+
+      /*
+       * re-lex until a token starts where an old token past the edit now starts, lexing is stateless between
+       * tokens so the old tokens from there on are unchanged
+       */
+      Lexer lexer( source, relexOffset, false );
+      TokenBuffer relexed;
+      Token token;
+      size_t resumeToken = firstToken;
+      bool resynchronized = false;
+
+      while ( !resynchronized && lexer.next( token ) ) {
+        while (
+          resumeToken < tokens.size() && (
+            tokens.at( resumeToken ).getOffset() < editEnd ||
+            tokens.at( resumeToken ).getOffset() + shift < token.getOffset()
+          )
+        ) {
+          resumeToken++;
+        }
+
+        resynchronized =
+          resumeToken < tokens.size() && tokens.at( resumeToken ).getOffset() + shift == token.getOffset();
+
+        if ( !resynchronized ) {
+          relexed.push( token );
+        }
+      }
+
+      if ( !resynchronized ) {
+        resumeToken = tokens.size();
+      }
+
+      const int64_t tokenShift =
+        static_cast<int64_t>( relexed.size() ) - static_cast<int64_t>( resumeToken - firstToken );
+
+      tokens.splice( firstToken, resumeToken - firstToken, relexed, shift );
+
+      reparse( firstToken, firstToken + relexed.size(), resumeToken, tokenShift, shift );
+
+      /* a changed signature changes how calls anywhere are checked, those before the edit included */
+      if ( redeclare() ) {
+        reparse( 0, tokens.size(), tokens.size(), 0, 0 );
+      }
+
+      /* replaced statements are left behind in the arena, once they outweigh the live ones everything is parsed anew */
+      if ( nodeArena.size() > 2 * liveSize + ARENA_CHUNK_UNITS * ARENA_UNIT ) {
+        nodeArena.clear();
+        spans.clear();
+        liveSize = 0;
+        reparse( 0, tokens.size(), tokens.size(), 0, 0 );
+      }
+    }
+
+    /*
+     * re-parses the statements around the tokens [_firstToken, _relexedEnd) that replaced the old tokens before
+     * _resumeToken, the old tokens from there on having moved by _tokenShift tokens and _shift bytes
+     */
+    void reparse(
+      const size_t _firstToken,
+      const size_t _relexedEnd,
+      const size_t _resumeToken,
+      const int64_t _tokenShift,
+      const int64_t _shift
+    ) {
+      /* the statement before may have looked ahead into the edited one, as an if does for its else */
+      size_t firstSpan = findSpan( _firstToken );
+      firstSpan = firstSpan > 0 ? firstSpan - 1 : 0;
+
+      const size_t firstStatement = firstSpan < spans.size() ? spans[firstSpan].firstToken : 0;
+      const int environmentOffset = getBaseOffset();
+
+      if ( spans.empty() ) {
+        resetEnvironment();
+      } else {
+        rewindEnvironment( spans[firstSpan].environmentOffset );
+      }
+
+      declareFunctions( firstSpan );
+
+      takeErrors();
+
+      TokenStream stream( source, &tokens, firstStatement );
+      std::vector<StatementSpan> parsed;
+      std::vector<Declaration> oldDeclarations;
+      std::vector<Declaration> newDeclarations;
+      size_t lastSpan = firstSpan;
+      /* whether the old statements past the edit can still be reused */
+      bool reuse = true;
+      bool resumed = false;
+
+      while ( !resumed && !stream.empty() && stream.front().getGrouper() != '}' ) {
+        parsed.push_back( parseStatement( stream ) );
+        newDeclarations.insert(
+          newDeclarations.end(), parsed.back().declarations.begin(), parsed.back().declarations.end()
+        );
+
+        size_t index = stream.getIndex();
+
+        if ( !reuse || index < _relexedEnd ) {
+          continue;
+        }
+
+        /* past the edit, the old statements are reused from the first one starting where this one ended */
+        while ( lastSpan < spans.size() && (
+          spans[lastSpan].firstToken < _resumeToken || shiftIndex( spans[lastSpan].firstToken, _tokenShift ) < index
+        ) ) {
+          oldDeclarations.insert(
+            oldDeclarations.end(), spans[lastSpan].declarations.begin(), spans[lastSpan].declarations.end()
+          );
+          lastSpan++;
+        }
+
+        resumed = lastSpan < spans.size() && shiftIndex( spans[lastSpan].firstToken, _tokenShift ) == index;
+
+        if ( resumed && oldDeclarations != newDeclarations ) {
+          /* statements after a changed binding were typed against the old one, they are all parsed again */
+          resumed = false;
+          reuse = false;
+        }
+      }
+
+      if ( resumed ) {
+        /* the bindings of the statements after are unchanged, and still in place */
+        settleEnvironment( environmentOffset, true );
+      } else {
+        lastSpan = spans.size();
+        settleEnvironment( getBaseOffset(), false );
+
+        /* errors met before the first statement, when the source starts with an invalid token */
+        std::vector<LogEntry> diagnostics = takeErrors();
+
+        if ( !diagnostics.empty() ) {
+          parsed.push_back( { nullptr, firstStatement, getBaseOffset(), 0, 0, {}, diagnostics, diagnostics.size() } );
+        }
+      }
+
+      for ( size_t span = firstSpan; span < lastSpan; span++ ) {
+        liveSize -= spans[span].size;
+      }
+
+      for ( const StatementSpan& span : parsed ) {
+        liveSize += span.size;
+      }
+
+      root = nullptr;
+
+      for ( size_t span = lastSpan; span < spans.size(); span++ ) {
+        spans[span].firstToken = shiftIndex( spans[span].firstToken, _tokenShift );
+        spans[span].shift += _shift;
+      }
+
+      auto replaced = spans.erase(
+        spans.begin() + static_cast<std::ptrdiff_t>( firstSpan ),
+        spans.begin() + static_cast<std::ptrdiff_t>( lastSpan )
+      );
+      spans.insert( replaced, parsed.begin(), parsed.end() );
+    }
+};
+
+#endif
@@ -1,261 +1,528 @@
 #ifndef _NODE_HPP
 #define _NODE_HPP
 
+#include <cstdint>
 #include <sstream>
 #include <string>
-#include <tuple>
+#include <string_view>
+#include <vector>
 
-#include "shared/environment.hpp"
-#include "shared/errors.hpp"
+#include "parser/arena.hpp"
 #include "shared/position.hpp"
+#include "shared/symbols.hpp"
 #include "shared/types.hpp"
-#include "shared/utils.hpp"
-
-typedef std::tuple<std::string, ValueType> UnaryOperatorValue;
-
-typedef std::tuple<std::string, ValueType, ValueType> BinaryOperatorValue;
-
-const std::map<BinaryOperatorValue, ValueType> DERIVED_BINARY_VALUES = {
-  /* derived boolean binary values */
-  { BinaryOperatorValue( "&&", ValueType::ValueBoolean, ValueType::ValueBoolean ), ValueType::ValueBoolean },
-  { BinaryOperatorValue( "||", ValueType::ValueBoolean, ValueType::ValueBoolean ), ValueType::ValueBoolean },
-  { BinaryOperatorValue( "^", ValueType::ValueBoolean, ValueType::ValueBoolean ), ValueType::ValueBoolean },
-  { BinaryOperatorValue( "<", ValueType::ValueConstant, ValueType::ValueConstant ), ValueType::ValueBoolean },
-  { BinaryOperatorValue( ">", ValueType::ValueConstant, ValueType::ValueConstant ), ValueType::ValueBoolean },
-  { BinaryOperatorValue( "<=", ValueType::ValueConstant, ValueType::ValueConstant ), ValueType::ValueBoolean },
-  { BinaryOperatorValue( ">=", ValueType::ValueConstant, ValueType::ValueConstant ), ValueType::ValueBoolean },
-  { BinaryOperatorValue( "==", ValueType::ValueConstant, ValueType::ValueConstant ), ValueType::ValueBoolean },
-  { BinaryOperatorValue( "!=", ValueType::ValueConstant, ValueType::ValueConstant ), ValueType::ValueBoolean },
-
-  /* derived constant binary values */
-  { BinaryOperatorValue( "+", ValueType::ValueConstant, ValueType::ValueConstant ), ValueType::ValueConstant },
-  { BinaryOperatorValue( "-", ValueType::ValueConstant, ValueType::ValueConstant ), ValueType::ValueConstant },
-  { BinaryOperatorValue( "*", ValueType::ValueConstant, ValueType::ValueConstant ), ValueType::ValueConstant },
-  { BinaryOperatorValue( "/", ValueType::ValueConstant, ValueType::ValueConstant ), ValueType::ValueConstant },
-};
 
+typedef ArenaRef NodeRef;
+
+/*
+ * nodes live in the node arena ( see parser/arena.hpp ) and are never destroyed one by one, children are referenced
+ * by 32-bit arena refs and names by their interned symbol ( see shared/symbols.hpp ); value types and stack slots are
+ * left for the resolver ( see parser/resolver.hpp ) to fill in
+ */
 class Node {
+  friend class NodeArena;
+
   protected:
-    std::string text;
     NodeType nodeType;
     ValueType valueType;
-    Position position;
+    SourceLocation location;
+    NodeRef ref;
+    /* the name a variable, binding, call or import refers to, NO_SYMBOL for any other node */
+    Symbol symbol;
 
   public:
-    Node( const std::string _text, const NodeType _type, const Position _position )
-      : text( _text ), nodeType( _type ), position( _position ) {
-      valueType = ValueType::ValueVoid;
-    }
+    Node( const Symbol _symbol, const NodeType _type, const SourceLocation _location )
+      : nodeType( _type ), valueType( ValueType::ValueVoid ), location( _location ), ref( NO_REF ),
+        symbol( _symbol ) {}
 
-    virtual ~Node() {}
+    Symbol getSymbol() const {
+      return symbol;
+    }
 
-    std::string getText() const {
-      return text;
+    std::string_view getText() const {
+      return interner.getName( symbol );
     }
 
     NodeType getNodeType() const {
       return nodeType;
     }
 
-    virtual ValueType getValueType() const {
+    ValueType getValueType() const {
       return valueType;
     }
 
-    Position getPosition() const {
-      return position;
+    SourceLocation getLocation() const {
+      return location;
+    }
+
+    NodeRef getRef() const {
+      return ref;
     }
 
     void setValueType( const ValueType _valueType ) {
       valueType = _valueType;
     }
+
+    void setLocation( const SourceLocation _location ) {
+      location = _location;
+    }
+};
+
+NodeRef refOf( const Node* _node ) {
+  return _node ? _node->getRef() : NO_REF;
+}
+
+Node* getNode( const NodeRef _ref ) {
+  return nodeArena.get<Node>( _ref );
+}
+
+/* child list of a node, a run of refs in the arena */
+class NodeList {
+  private:
+    ArenaRef refs;
+    uint32_t count;
+
+  public:
+    NodeList( const std::vector<Node*> _nodes ) : count( static_cast<uint32_t>( _nodes.size() ) ) {
+      std::vector<NodeRef> nodeRefs;
+
+      for ( Node* node : _nodes ) {
+        nodeRefs.push_back( refOf( node ) );
+      }
+
+      refs = nodeArena.copy( nodeRefs.data(), nodeRefs.size() );
+    }
+
+    size_t size() const {
+      return count;
+    }
+
+    bool empty() const {
+      return count == 0;
+    }
+
+    Node* at( const size_t _index ) const {
+      return getNode( static_cast<const NodeRef*>( nodeArena.at( refs ) )[_index] );
+    }
+
+    class Iterator {
+      private:
+        const NodeList* list;
+        size_t index;
+
+      public:
+        Iterator( const NodeList* _list, const size_t _index ) : list( _list ), index( _index ) {}
+
+        Node* operator*() const {
+          return list->at( index );
+        }
+
+        Iterator& operator++() {
+          index++;
+          return *this;
+        }
+
+        bool operator!=( const Iterator& _other ) const {
+          return index != _other.index;
+        }
+    };
+
+    Iterator begin() const {
+      return Iterator( this, 0 );
+    }
+
+    Iterator end() const {
+      return Iterator( this, count );
+    }
 };
 
 class BooleanNode : public Node {
+  private:
+    bool value;
+
   public:
-    BooleanNode( const std::string _text, const Position _position )
-      : Node( _text, NodeType::NodeBoolean, _position ) {
+    BooleanNode( const SourceLocation _location, const bool _value )
+      : Node( NO_SYMBOL, NodeType::NodeBoolean, _location ), value( _value ) {
       setValueType( ValueType::ValueBoolean );
     }
+
+    bool getValue() const {
+      return value;
+    }
 };
 
 class ConstantNode : public Node {
+  private:
+    /* decoded by the lexer */
+    int64_t value;
+
   public:
-    ConstantNode( const std::string _text, const Position _position ) 
-      : Node( _text, NodeType::NodeConstant, _position ) {
+    ConstantNode( const SourceLocation _location, const int64_t _value )
+      : Node( NO_SYMBOL, NodeType::NodeConstant, _location ), value( _value ) {
       setValueType( ValueType::ValueConstant );
     }
+
+    int64_t getValue() const {
+      return value;
+    }
 };
 
 class VariableNode : public Node {
+  private:
+    /* stack slot of the binding the variable resolves to */
+    int slot;
+
   public:
-    VariableNode( const std::string _text, const Position _position )
-      : Node( _text, NodeType::NodeVariable, _position ) {}
-    
-    /* refer to environment to derive type */
-    ValueType getValueType() const {
-      return getVariableValueType( text );
+    VariableNode( const Symbol _symbol, const SourceLocation _location )
+      : Node( _symbol, NodeType::NodeVariable, _location ), slot( 0 ) {}
+
+    int getSlot() const {
+      return slot;
+    }
+
+    void setSlot( const int _slot ) {
+      slot = _slot;
     }
 };
 
 class BindingNode : public Node {
   private:
-    Node* bindingExpression;
+    NodeRef bindingExpression;
+    /* the declared type as written, and how far past the binding's own location it was written */
+    Symbol typeName;
+    uint32_t typeDistance;
+    int slot;
 
   public:
-    BindingNode( const std::string _text, const Position _position, Node* _bindingExpression )
-      : Node( _text, NodeType::NodeBinding, _position ), bindingExpression( _bindingExpression ) {
-      addVariable( text, bindingExpression->getValueType() );
+    BindingNode(
+      const Symbol _symbol,
+      const SourceLocation _location,
+      const Symbol _typeName,
+      const SourceLocation _typeLocation,
+      Node* _bindingExpression
+    ) : Node( _symbol, NodeType::NodeBinding, _location ), bindingExpression( refOf( _bindingExpression ) ),
+        typeName( _typeName ), typeDistance( _typeLocation.getOffset() - _location.getOffset() ), slot( 0 ) {}
+
+    Node* getBindingExpression() const {
+      return getNode( bindingExpression );
     }
 
-    ~BindingNode() {
-      if ( bindingExpression ) delete bindingExpression;
+    Symbol getTypeName() const {
+      return typeName;
     }
 
-    Node* getBindingExpression() const {
-      return bindingExpression;
+    SourceLocation getTypeLocation() const {
+      return SourceLocation( location.getFileId(), location.getOffset() + typeDistance );
+    }
+
+    int getSlot() const {
+      return slot;
+    }
+
+    void setSlot( const int _slot ) {
+      slot = _slot;
     }
 };
 
 class UnaryOperatorNode : public Node {
   private:
-    Node* operand;
+    OperatorId operatorId;
+    NodeRef operand;
 
   public:
-    UnaryOperatorNode( const std::string _text, const Position _position, Node* _operand )
-      : Node( _text, NodeType::NodeUnaryOperator, _position ), operand( _operand ) {
-      setValueType( operand->getValueType() );
-    }
+    UnaryOperatorNode( const SourceLocation _location, const OperatorId _operatorId, Node* _operand )
+      : Node( NO_SYMBOL, NodeType::NodeUnaryOperator, _location ), operatorId( _operatorId ),
+        operand( refOf( _operand ) ) {}
 
-    ~UnaryOperatorNode() {
-      if ( operand ) delete operand;
+    OperatorId getOperator() const {
+      return operatorId;
     }
 
     Node* getOperand() const {
-      return operand;
+      return getNode( operand );
     }
 };
 
 class BinaryOperatorNode : public Node {
   private:
-    Node* lOperand;
-    Node* rOperand;
+    OperatorId operatorId;
+    NodeRef lOperand;
+    NodeRef rOperand;
 
   public:
-    BinaryOperatorNode( const std::string _text, const Position _position, Node* _lOperand, Node* _rOperand )
-      : Node( _text, NodeType::NodeBinaryOperator, _position ), lOperand( _lOperand ), rOperand( _rOperand ) {
-      ValueType leftValueType = lOperand->getValueType();
-      ValueType rightValueType = rOperand->getValueType();
-
-      ValueType derivedValueType = mapping(
-        DERIVED_BINARY_VALUES,
-        BinaryOperatorValue( text, leftValueType, rightValueType ),
-        ValueType::ValueUndefined
-      );
-
-      if ( derivedValueType == ValueType::ValueUndefined ) {
-        log(
-          Severity::Error,
-          _position,
-          ERR_BINARY_VALUES_NOT_SUPPORTED,
-          _text,
-          _lOperand->getValueType(),
-          _rOperand->getValueType()
-        );
-      }
-
-      setValueType( derivedValueType );
-    }
-
-    ~BinaryOperatorNode() {
-      if ( lOperand ) delete lOperand;
-      if ( rOperand ) delete rOperand;
+    BinaryOperatorNode(
+      const SourceLocation _location,
+      const OperatorId _operatorId,
+      Node* _lOperand,
+      Node* _rOperand
+    ) : Node( NO_SYMBOL, NodeType::NodeBinaryOperator, _location ), operatorId( _operatorId ),
+        lOperand( refOf( _lOperand ) ), rOperand( refOf( _rOperand ) ) {}
+
+    OperatorId getOperator() const {
+      return operatorId;
     }
 
     Node* getLeftOperand() const {
-      return lOperand;
+      return getNode( lOperand );
     }
 
     Node* getRightOperand() const {
-      return rOperand;
+      return getNode( rOperand );
     }
 };
 
+/*
+ * the binary operators down the left of _node, _node first; a chain such as a + b + c nests as deep as it is long,
+ * so walks over one go along this instead of recursing into every left operand
+ */
+std::vector<BinaryOperatorNode*> leftSpine( BinaryOperatorNode* _node ) {
+  std::vector<BinaryOperatorNode*> spine = { _node };
+
+  while ( spine.back()->getLeftOperand()->getNodeType() == NodeType::NodeBinaryOperator ) {
+    spine.push_back( (BinaryOperatorNode*) spine.back()->getLeftOperand() );
+  }
+
+  return spine;
+}
+
 class MultiStatementNode : public Node {
   private:
-    std::vector<Node*> statements;
+    NodeList statements;
 
   public:
-    MultiStatementNode( const Position _position, std::vector<Node*> _statements )
-      : Node( "", NodeType::NodeMultiStatement, _position ), statements( _statements ) {}
+    MultiStatementNode( const SourceLocation _location, const std::vector<Node*> _statements )
+      : Node( NO_SYMBOL, NodeType::NodeMultiStatement, _location ), statements( _statements ) {}
 
-    ~MultiStatementNode() {
-      for ( Node* statement : statements ) {
-        delete statement;
-      }
-    }
-
-    std::vector<Node*> getStatements() const {
+    const NodeList& getStatements() const {
       return statements;
     }
 };
 
 class ConditionalNode : public Node {
   private:
-    Node* conditional;
-    Node* upperBody;
-    Node* lowerBody;
+    NodeRef conditional;
+    NodeRef upperBody;
+    NodeRef lowerBody;
 
   public:
-    ConditionalNode( const Position _position, Node* _conditional, Node* _upperBody, Node* _lowerBody )
-      : Node( "if-else", NodeType::NodeConditional, _position ),
-        conditional( _conditional ),
-        upperBody( _upperBody ),
-        lowerBody( _lowerBody ) {}
-    
-    ~ConditionalNode() {
-      if ( conditional ) delete conditional;
-      if ( upperBody ) delete upperBody;
-      if ( lowerBody ) delete lowerBody;
-    }
+    ConditionalNode( const SourceLocation _location, Node* _conditional, Node* _upperBody, Node* _lowerBody )
+      : Node( NO_SYMBOL, NodeType::NodeConditional, _location ),
+        conditional( refOf( _conditional ) ),
+        upperBody( refOf( _upperBody ) ),
+        lowerBody( refOf( _lowerBody ) ) {}
 
     Node* getConditional() const {
-      return conditional;
+      return getNode( conditional );
     }
 
     Node* getUpperBody() const {
-      return upperBody;
+      return getNode( upperBody );
     }
 
     Node* getLowerBody() const {
-      return lowerBody;
+      return getNode( lowerBody );
     }
 };
 
 class FunctionCallNode : public Node {
   private:
-    std::string name;
-    std::vector<Node*> arguments;
+    NodeList arguments;
 
   public:
-    FunctionCallNode( const Position _position, const std::string _name, std::vector<Node*> _arguments )
-      : Node( _name, NodeType::NodeFunctionCall, _position ), name( _name ), arguments( _arguments ) {}
-    
-    ~FunctionCallNode() {
-      for ( Node* argument : arguments ) {
-        delete argument;
-      }
-    }
-    
-    std::string getName() const {
-      return name;
+    FunctionCallNode(
+      const SourceLocation _location, const Symbol _name, const std::vector<Node*> _arguments
+    ) : Node( _name, NodeType::NodeFunctionCall, _location ), arguments( _arguments ) {}
+
+    std::string_view getName() const {
+      return getText();
     }
 
-    std::vector<Node*> getArguments() const {
+    const NodeList& getArguments() const {
       return arguments;
     }
 
     int getArgumentCount() const {
-      return arguments.size();
+      return static_cast<int>( arguments.size() );
+    }
+};
+
+/*
+ * function name( parameter :: type, ... ) :: type { body }, each parameter a binding without an expression; a
+ * function returning nothing has no return type written
+ */
+class FunctionNode : public Node {
+  private:
+    NodeList parameters;
+    NodeRef body;
+    /* NO_SYMBOL when no return type is written, and how far past the function's own location it was written */
+    Symbol returnTypeName;
+    uint32_t returnTypeDistance;
+    ValueType returnType;
+    Inlining inlining;
+
+  public:
+    FunctionNode(
+      const Symbol _name,
+      const SourceLocation _location,
+      const std::vector<Node*> _parameters,
+      const Symbol _returnTypeName,
+      const SourceLocation _returnTypeLocation,
+      Node* _body
+    ) : Node( _name, NodeType::NodeFunction, _location ), parameters( _parameters ), body( refOf( _body ) ),
+        returnTypeName( _returnTypeName ),
+        returnTypeDistance( _returnTypeLocation.getOffset() - _location.getOffset() ),
+        returnType( ValueType::ValueVoid ), inlining( Inlining::InlineByCost ) {}
+
+    std::string_view getName() const {
+      return getText();
+    }
+
+    const NodeList& getParameters() const {
+      return parameters;
+    }
+
+    Node* getBody() const {
+      return getNode( body );
+    }
+
+    Symbol getReturnTypeName() const {
+      return returnTypeName;
+    }
+
+    SourceLocation getReturnTypeLocation() const {
+      return SourceLocation( location.getFileId(), location.getOffset() + returnTypeDistance );
+    }
+
+    ValueType getReturnType() const {
+      return returnType;
+    }
+
+    void setReturnType( const ValueType _returnType ) {
+      returnType = _returnType;
+    }
+
+    Inlining getInlining() const {
+      return inlining;
+    }
+
+    void setInlining( const Inlining _inlining ) {
+      inlining = _inlining;
+    }
+};
+
+/* return, with the value of the expression unless there is none */
+class ReturnNode : public Node {
+  private:
+    NodeRef expression;
+
+  public:
+    ReturnNode( const SourceLocation _location, Node* _expression )
+      : Node( NO_SYMBOL, NodeType::NodeReturn, _location ), expression( refOf( _expression ) ) {}
+
+    Node* getExpression() const {
+      return getNode( expression );
+    }
+};
+
+/* name = expression, rebinding a variable already defined to a value of the same type */
+class AssignmentNode : public Node {
+  private:
+    NodeRef expression;
+    /* stack slot of the binding the variable resolves to */
+    int slot;
+
+  public:
+    AssignmentNode( const Symbol _symbol, const SourceLocation _location, Node* _expression )
+      : Node( _symbol, NodeType::NodeAssignment, _location ), expression( refOf( _expression ) ), slot( 0 ) {}
+
+    Node* getExpression() const {
+      return getNode( expression );
+    }
+
+    int getSlot() const {
+      return slot;
+    }
+
+    void setSlot( const int _slot ) {
+      slot = _slot;
+    }
+};
+
+/* while condition { body }, the condition is evaluated before every run of the body */
+class WhileNode : public Node {
+  private:
+    NodeRef conditional;
+    NodeRef body;
+
+  public:
+    WhileNode( const SourceLocation _location, Node* _conditional, Node* _body )
+      : Node( NO_SYMBOL, NodeType::NodeWhile, _location ), conditional( refOf( _conditional ) ),
+        body( refOf( _body ) ) {}
+
+    Node* getConditional() const {
+      return getNode( conditional );
+    }
+
+    Node* getBody() const {
+      return getNode( body );
+    }
+};
+
+/*
+ * for name in first..last { body }, the body runs with name bound to each integer from first up to but not including
+ * last; both bounds are evaluated once, before the first run, and assigning to name only changes it for that run
+ */
+class ForNode : public Node {
+  private:
+    NodeRef first;
+    NodeRef last;
+    NodeRef body;
+    /* stack slot of the loop variable */
+    int slot;
+
+  public:
+    ForNode( const Symbol _symbol, const SourceLocation _location, Node* _first, Node* _last, Node* _body )
+      : Node( _symbol, NodeType::NodeFor, _location ), first( refOf( _first ) ), last( refOf( _last ) ),
+        body( refOf( _body ) ), slot( 0 ) {}
+
+    Node* getFirst() const {
+      return getNode( first );
+    }
+
+    Node* getLast() const {
+      return getNode( last );
+    }
+
+    Node* getBody() const {
+      return getNode( body );
+    }
+
+    int getSlot() const {
+      return slot;
+    }
+
+    void setSlot( const int _slot ) {
+      slot = _slot;
+    }
+};
+
+/* import Name from 'path', the path is resolved against the importing file */
+class ImportNode : public Node {
+  private:
+    ArenaRef path;
+    uint32_t pathLength;
+
+  public:
+    ImportNode( const Symbol _name, const SourceLocation _location, const std::string _path )
+      : Node( _name, NodeType::NodeImport, _location ), path( nodeArena.copy( _path ) ),
+        pathLength( static_cast<uint32_t>( _path.length() ) ) {}
+
+    std::string_view getName() const {
+      return getText();
+    }
+
+    std::string_view getPath() const {
+      return nodeArena.getText( path, pathLength );
     }
 };
 
@@ -1,94 +1,147 @@
 #ifndef _PARSER_HPP
 #define _PARSER_HPP
 
-#include <map>
-#include <queue>
-#include <stack>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
 
-#include "parser/lexer.hpp"
 #include "parser/node.hpp"
+#include "parser/resolver.hpp"
 #include "parser/token.hpp"
+#include "parser/tokenstream.hpp"
 
+#include "shared/environment.hpp"
+#include "shared/errors.hpp"
 #include "shared/types.hpp"
-
-const std::map<std::string, unsigned int> OPERATOR_PRIORITY = {
-  { "(", 0 }, { ")", 0 },
-  { "+", 1 }, { "-", 1 },
-  { "*", 2 }, { "/", 2 },
-  { "<", 9 }, { ">", 9 }, { ">=", 9 }, { "<=", 9 },
-};
-
-bool higherPriority( const Token* _tokenA, const Token* _tokenB ) {
-  return OPERATOR_PRIORITY.at( _tokenA->getText() ) >= OPERATOR_PRIORITY.at( _tokenB->getText() );
+#include "shared/utils.hpp"
+
+/* calls and parenthesized groups nested any deeper are rejected instead of exhausting the stack */
+const unsigned int MAX_NESTING_DEPTH = 1024;
+
+/* binding power of binary operators, higher binds tighter; operators that cannot join two operands bind at 0 */
+constexpr unsigned int operatorPrecedence( const OperatorId _operator ) {
+  switch ( _operator ) {
+    case OperatorId::OperatorOr:
+      return 1;
+    case OperatorId::OperatorXor:
+      return 2;
+    case OperatorId::OperatorAnd:
+      return 3;
+    case OperatorId::OperatorEqual:
+    case OperatorId::OperatorNotEqual:
+      return 4;
+    case OperatorId::OperatorLess:
+    case OperatorId::OperatorGreater:
+    case OperatorId::OperatorLessEqual:
+    case OperatorId::OperatorGreaterEqual:
+      return 5;
+    case OperatorId::OperatorAdd:
+    case OperatorId::OperatorSubtract:
+      return 6;
+    case OperatorId::OperatorMultiply:
+    case OperatorId::OperatorDivide:
+    case OperatorId::OperatorModulo:
+      return 7;
+    default:
+      return 0;
+  }
 }
 
-Node* nodeify( std::queue<Token*>& _tokens );
+Node* nodeify( TokenStream& _tokens );
+
+Node* nodeifyExpression( TokenStream& _tokens, const unsigned int _precedence, const unsigned int _depth );
 
-std::vector<Node*> nodeifyCommaSeparatedExpressions( std::queue<Token*>& _tokens ) {
+/* null in place of an expression that failed to parse, which has been reported */
+std::vector<Node*> nodeifyCommaSeparatedExpressions( TokenStream& _tokens, const unsigned int _depth ) {
   std::vector<Node*> expressions;
   bool moreExpressions = true;
 
   do {
-    expressions.push_back( nodeify( _tokens ) );
+    while ( !_tokens.empty() && _tokens.front().getType() == TokenType::TokenNewline ) {
+      _tokens.pop();
+    }
 
-    if ( _tokens.empty() || _tokens.front()->getText() != "," ) {
+    uint32_t offset = _tokens.front().getOffset();
+    Node* expression = nodeifyExpression( _tokens, 1, _depth );
+
+    /* an expression that failed after it started has reported why */
+    if ( !expression && _tokens.front().getOffset() == offset ) {
+      log( Severity::Error, _tokens.front().getLocation(), ERR_UNEXPECTED_TOKEN, describeToken( _tokens.front() ) );
+    }
+
+    expressions.push_back( expression );
+
+    if ( _tokens.empty() || _tokens.front().getType() != TokenType::TokenComma ) {
       moreExpressions = false;
     } else {
       _tokens.pop();
-
-      while ( _tokens.front()->getText() == "\n" ) {
-        _tokens.pop();
-      }
     }
   } while ( moreExpressions );
 
   return expressions;
 }
 
-Node* nodeifyFunctionCall( std::queue<Token*>& _tokens, Token* _token ) {
-  Node* node = nullptr;
-  std::vector<Node*> arguments;
+/* skips the rest of a group whose '(' has been consumed, up to and including its ')' */
+void skipGroup( TokenStream& _tokens ) {
+  unsigned int groupDepth = 1;
 
-  Token* openArgument = _tokens.front();
-  _tokens.pop();
+  while ( !_tokens.empty() && groupDepth > 0 ) {
+    Token token = _tokens.front();
+    _tokens.pop();
 
-  if ( openArgument->getText() != "(" ) {
-    log( Severity::Error, openArgument->getPosition(), ERR_EXPECTED_OPEN_PAREN, openArgument->getText() );
+    if ( token.getGrouper() == '(' ) {
+      groupDepth++;
+    } else if ( token.getGrouper() == ')' ) {
+      groupDepth--;
+    }
   }
+}
 
-  int innerExpressionCount = 0;
+Node* nodeifyFunctionCall( TokenStream& _tokens, const Token& _token, const unsigned int _depth ) {
+  Node* node = nullptr;
+  std::vector<Node*> arguments;
 
-  std::queue<Token*> argumentTokens;
+  Token openArgument = _tokens.front();
+  _tokens.pop();
 
-  while ( !_tokens.empty() && ( _tokens.front()->getText() != ")" || innerExpressionCount ) ) {
-    if ( _tokens.front()->getText() == "(" ) {
-      innerExpressionCount++;
-    } else if ( _tokens.front()->getText() == ")" ) {
-      innerExpressionCount--;
-    }
+  if ( openArgument.getGrouper() != '(' ) {
+    log( Severity::Error, openArgument.getLocation(), ERR_EXPECTED_OPEN_PAREN, describeToken( openArgument ) );
+  }
 
-    argumentTokens.push( _tokens.front() );
-    _tokens.pop();
+  if ( _depth >= MAX_NESTING_DEPTH ) {
+    log( Severity::Error, openArgument.getLocation(), ERR_NESTING_DEPTH, std::to_string( MAX_NESTING_DEPTH ) );
+    skipGroup( _tokens );
+    return nullptr;
   }
 
-  arguments = nodeifyCommaSeparatedExpressions( argumentTokens );
+  /* arguments are parsed in place, each one stops at the ',' or ')' that follows it */
+  if ( !_tokens.empty() && _tokens.front().getGrouper() != ')' ) {
+    arguments = nodeifyCommaSeparatedExpressions( _tokens, _depth + 1 );
+  }
 
-  Token* closeArgument = _tokens.front();
+  Token closeArgument = _tokens.front();
   _tokens.pop();
 
-  if ( closeArgument->getText() != ")" ) {
-    log( Severity::Error, closeArgument->getPosition(), ERR_EXPECTED_CLOSE_PAREN, closeArgument->getText() );
+  if ( closeArgument.getGrouper() != ')' ) {
+    log( Severity::Error, closeArgument.getLocation(), ERR_EXPECTED_CLOSE_PAREN, describeToken( closeArgument ) );
+    return nullptr;
+  }
+
+  /* a call missing an argument would only go on to report the count of the ones left */
+  if ( std::find( arguments.begin(), arguments.end(), nullptr ) != arguments.end() ) {
+    return nullptr;
   }
 
-  node = new FunctionCallNode( _token->getPosition(), _token->getText(), arguments );
+  node = nodeArena.make<FunctionCallNode>( _token.getLocation(), _token.getSymbol(), arguments );
 
   return node;
 }
 
-Node* nodeifyStatements( std::queue<Token*>& _tokens ) {
+Node* nodeifyStatements( TokenStream& _tokens ) {
   std::vector<Node*> statements;
 
-  while ( !_tokens.empty() && _tokens.front()->getText() != "}" ) {
+  while ( !_tokens.empty() && _tokens.front().getGrouper() != '}' ) {
     Node* statement = nodeify( _tokens );
 
     if ( statement ) {
@@ -97,27 +150,37 @@ Node* nodeifyStatements( std::queue<Token*>& _tokens ) {
   }
 
   if ( statements.empty() ) {
-    return new MultiStatementNode( Position( 0, 0, "" ), statements );
+    return nodeArena.make<MultiStatementNode>( SourceLocation(), statements );
   } else {
-    return new MultiStatementNode( statements[0]->getPosition(), statements );
+    return nodeArena.make<MultiStatementNode>( statements[0]->getLocation(), statements );
   }
 }
 
-Node* nodeifyGroupedStatements( std::queue<Token*>& _tokens ) {
-  Token* openGroup = _tokens.front();
-  _tokens.pop();
-
-  while ( !_tokens.empty() && openGroup->getText() != "{" ) {
-    openGroup = _tokens.front();
+/* { statements }, anything before the '{' is passed over; null when there is no '{' before the end of the source */
+Node* nodeifyGroupedStatements( TokenStream& _tokens ) {
+  while ( !_tokens.empty() && _tokens.front().getGrouper() != '{' ) {
     _tokens.pop();
   }
 
+  Token openGroup = _tokens.front();
+
+  if ( openGroup.getGrouper() != '{' ) {
+    log( Severity::Error, openGroup.getLocation(), ERR_EXPECTED_OPEN_BRACE, describeToken( openGroup ) );
+    return nullptr;
+  }
+
+  _tokens.pop();
+
   Node* statements = nodeifyStatements( _tokens );
 
-  Token* closeGroup = _tokens.front();
+  Token closeGroup = _tokens.front();
   _tokens.pop();
 
-  while ( !_tokens.empty() && closeGroup->getText() == "\n" ) {
+  if ( closeGroup.getGrouper() != '}' ) {
+    log( Severity::Error, closeGroup.getLocation(), ERR_EXPECTED_CLOSE_BRACE, describeToken( closeGroup ) );
+  }
+
+  while ( !_tokens.empty() && closeGroup.getType() == TokenType::TokenNewline ) {
     closeGroup = _tokens.front();
     _tokens.pop();
   }
@@ -125,205 +188,530 @@ Node* nodeifyGroupedStatements( std::queue<Token*>& _tokens ) {
   return statements;
 }
 
-Node* nodeifyArithmetic( std::queue<Token*>& _tokens ) {
-  bool continueParsing = true;
-  std::stack<Node*> operands;
-  std::stack<Token*> operators;
+/* a literal, variable, call or parenthesized group; nothing is consumed when no operand starts here */
+Node* nodeifyOperand( TokenStream& _tokens, const unsigned int _depth ) {
+  if ( _tokens.empty() ) {
+    return nullptr;
+  }
 
-  Token* top = _tokens.empty() ? nullptr : _tokens.front();
+  Token top = _tokens.front();
 
-  while ( continueParsing && top ) {
-    if ( top->getType() == TokenType::TokenBoolean ) {
-      operands.push( new BooleanNode( top->getText(), top->getPosition() ) );
-      _tokens.pop();
-    } else if ( top->getType() == TokenType::TokenConstant ) {
-      operands.push( new ConstantNode( top->getText(), top->getPosition() ) );
-      _tokens.pop();
-    } else if ( top->getType() == TokenType::TokenVariable ) {
-      Token* variable = top;
-      _tokens.pop();
+  if ( top.getType() == TokenType::TokenBoolean ) {
+    _tokens.pop();
+    return nodeArena.make<BooleanNode>( top.getLocation(), top.getValue() );
+  } else if ( top.getType() == TokenType::TokenConstant ) {
+    _tokens.pop();
+    return nodeArena.make<ConstantNode>( top.getLocation(), top.getValue() );
+  } else if ( top.getType() == TokenType::TokenVariable ) {
+    _tokens.pop();
 
-      if ( contains( functions, variable->getText() ) &&  _tokens.front()->getText() == "(" ) {
-        operands.push( nodeifyFunctionCall( _tokens, variable ) );
-      } else {
-        operands.push( new VariableNode( variable->getText(), variable->getPosition() ) );
-      }
-    } else if ( top->getType() == TokenType::TokenOperator ) {
-      if ( !operators.empty() ) {
-        Token* topOperator = operators.top();
-
-        while ( topOperator && !higherPriority( top, topOperator ) ) {
-          Node* rOperand = operands.top();
-          operands.pop();
-          Node* lOperand = operands.top();
-          operands.pop();
-          Node* newOperand = new BinaryOperatorNode(
-            topOperator->getText(), topOperator->getPosition(), lOperand, rOperand
-          );
-          operands.push( newOperand );
-          operators.pop();
-          topOperator = operators.empty() ? nullptr : operators.top();
-        }
-      }
+    /* functions may be defined after the calls to them, the resolver looks each one up ( see parser/resolver.hpp ) */
+    if ( !_tokens.empty() && _tokens.front().getGrouper() == '(' ) {
+      return nodeifyFunctionCall( _tokens, top, _depth );
+    }
 
-      operators.push( top );
-      _tokens.pop();
-    } else if ( top->getType() == TokenType::TokenArithmeticGrouper ) {
-      if ( top->getText() == "(" ) {
-        operators.push( top );
-      } else {
-        Token* topOperator = operators.top();
-
-        while ( topOperator && topOperator->getText() != "(" ) {
-          Node* rOperand = operands.top();
-          operands.pop();
-          Node* lOperand = operands.top();
-          operands.pop();
-          Node* newOperand = new BinaryOperatorNode(
-            topOperator->getText(), topOperator->getPosition(), lOperand, rOperand
-          );
-          operands.push( newOperand );
-          operators.pop();
-          topOperator = operators.empty() ? nullptr : operators.top();
-        }
-
-        operators.pop();
-      }
+    return nodeArena.make<VariableNode>( top.getSymbol(), top.getLocation() );
+  } else if ( top.getType() != TokenType::TokenArithmeticGrouper || top.getGrouper() != '(' ) {
+    return nullptr;
+  }
 
-      _tokens.pop();
-    } else {
-      continueParsing = false;
-    }
+  _tokens.pop();
 
-    top = _tokens.empty() ? nullptr : _tokens.front();
+  if ( _depth >= MAX_NESTING_DEPTH ) {
+    log( Severity::Error, top.getLocation(), ERR_NESTING_DEPTH, std::to_string( MAX_NESTING_DEPTH ) );
+    skipGroup( _tokens );
+    return nullptr;
   }
 
-  while ( !operators.empty() ) {
-    Token* topOperator = operators.top();
-    operators.pop();
+  if ( _tokens.front().getGrouper() == ')' ) {
+    /* an empty group */
+    Token closeGroup = _tokens.front();
+    _tokens.pop();
 
-    Node* rOperand = operands.top();
-    operands.pop();
-    Node* lOperand = operands.top();
-    operands.pop();
-    Node* newOperand = new BinaryOperatorNode( topOperator->getText(), topOperator->getPosition(), lOperand, rOperand );
-    operands.push( newOperand );
+    log( Severity::Error, closeGroup.getLocation(), ERR_UNEXPECTED_TOKEN, describeToken( closeGroup ) );
+    return nullptr;
   }
 
-  Node* topOperand = operands.top();
-  operands.pop();
+  Node* node = nodeifyExpression( _tokens, 1, _depth + 1 );
+
+  Token closeGroup = _tokens.front();
 
-  if ( !operands.empty() ) {
-    /* TODO -- error :: should not have remaining nodes */
+  if ( closeGroup.getGrouper() != ')' ) {
+    log( Severity::Error, closeGroup.getLocation(), ERR_EXPECTED_CLOSE_PAREN, describeToken( closeGroup ) );
+  } else {
+    _tokens.pop();
   }
 
-  return topOperand;
+  return node;
 }
 
-Node* nodeifyBinding( std::queue<Token*>& _tokens ) {
+/*
+ * precedence climbing, binary operators binding at least as tight as _precedence are folded into the expression
+ * left to right, a tighter operator on the right recurses once for its own operand
+ */
+Node* nodeifyExpression( TokenStream& _tokens, const unsigned int _precedence, const unsigned int _depth ) {
+  Node* lOperand = nodeifyOperand( _tokens, _depth );
+
+  if ( !lOperand ) {
+    return nullptr;
+  }
+
+  while ( !_tokens.empty() ) {
+    Token binaryOperator = _tokens.front();
+    unsigned int precedence = operatorPrecedence( binaryOperator.getOperator() );
+
+    if ( precedence == 0 || precedence < _precedence ) {
+      break;
+    }
+
+    _tokens.pop();
+
+    uint32_t offset = _tokens.front().getOffset();
+    Node* rOperand = nodeifyExpression( _tokens, precedence + 1, _depth );
+
+    if ( !rOperand ) {
+      /* as in a list of expressions, an operand that started has reported why it failed */
+      if ( _tokens.front().getOffset() == offset ) {
+        log(
+          Severity::Error, binaryOperator.getLocation(), ERR_MISSING_OPERAND, std::string( binaryOperator.getText() )
+        );
+      }
+      break;
+    }
+
+    lOperand = nodeArena.make<BinaryOperatorNode>(
+      binaryOperator.getLocation(), binaryOperator.getOperator(), lOperand, rOperand
+    );
+  }
+
+  return lOperand;
+}
+
+/* a type that is not a name at all is interned only so the resolver can report it */
+Symbol typeSymbol( const Token& _type ) {
+  return _type.getSymbol() != NO_SYMBOL ? _type.getSymbol() : interner.intern( _type.getText() );
+}
+
+Node* nodeifyBinding( TokenStream& _tokens ) {
   Node* node = nullptr;
 
-  Token* variable = _tokens.front();
+  Token variable = _tokens.front();
   _tokens.pop();
 
-  Token* typeDefine = _tokens.front();
+  Token typeDefine = _tokens.front();
   _tokens.pop();
 
-  if ( typeDefine->getText() != "::" ) {
-    log( Severity::Error, typeDefine->getPosition(), ERR_EXPECTED_TYPE_DEFINER, typeDefine->getText() );
+  if ( typeDefine.getOperator() != OperatorId::OperatorTypeDefine ) {
+    log( Severity::Error, typeDefine.getLocation(), ERR_EXPECTED_TYPE_DEFINER, describeToken( typeDefine ) );
   }
 
-  Token* type = _tokens.front();
+  Token type = _tokens.front();
   _tokens.pop();
 
-  Token* assignOperator = _tokens.front();
+  Token assignOperator = _tokens.front();
   _tokens.pop();
 
-  if ( assignOperator->getText() != "=" ) {
-    log( Severity::Error, assignOperator->getPosition(), ERR_EXPECTED_ASSIGN_OP, assignOperator->getText() );
+  if ( assignOperator.getOperator() != OperatorId::OperatorAssign ) {
+    log( Severity::Error, assignOperator.getLocation(), ERR_EXPECTED_ASSIGN_OP, describeToken( assignOperator ) );
   }
 
   Node* bindingExpression = nodeify( _tokens );
 
-  if ( translateToValueType( type->getText() ) != bindingExpression->getValueType() ) {
-    log(
-      Severity::Error,
-      type->getPosition(),
-      ERR_BINDING_TYPE_MISMATCH,
-      bindingExpression->getValueType(),
-      type->getText()
-    );
+  if ( !bindingExpression ) {
+    log( Severity::Error, assignOperator.getLocation(), ERR_EXPECTED_EXPRESSION, std::string( variable.getText() ) );
+    return nullptr;
   }
 
-  node = new BindingNode( variable->getText(), variable->getPosition(), bindingExpression );
+  node = nodeArena.make<BindingNode>(
+    variable.getSymbol(), variable.getLocation(), typeSymbol( type ), type.getLocation(), bindingExpression
+  );
 
   return node;
 }
 
-Node* nodeifyIfElse( std::queue<Token*>& _tokens, Token* _token ) {
+/* name = expression, the expression is parsed the way a binding's is */
+Node* nodeifyAssignment( TokenStream& _tokens ) {
+  Token variable = _tokens.front();
+  _tokens.pop();
+
+  Token assignOperator = _tokens.front();
+  _tokens.pop();
+
+  Node* expression = nodeify( _tokens );
+
+  if ( !expression ) {
+    log( Severity::Error, assignOperator.getLocation(), ERR_EXPECTED_EXPRESSION, std::string( variable.getText() ) );
+    return nullptr;
+  }
+
+  return nodeArena.make<AssignmentNode>( variable.getSymbol(), variable.getLocation(), expression );
+}
+
+/* a conditional without a condition is reported and dropped, its bodies are still parsed past */
+Node* nodeifyIfElse( TokenStream& _tokens, const Token& _token ) {
   Node* node = nullptr;
 
   Node* conditional = nodeify( _tokens );
 
+  if ( !conditional ) {
+    log( Severity::Error, _token.getLocation(), ERR_EXPECTED_CONDITION, std::string( _token.getText() ) );
+  }
+
   Node* upperBody = nodeifyGroupedStatements( _tokens );
 
   Node* lowerBody = nullptr;
 
-  if ( !_tokens.empty() && _tokens.front()->getText() == "elif" ) {
-    Token* headToken = _tokens.front();
+  if ( !_tokens.empty() && _tokens.front().getKeyword() == KeywordId::KeywordElif ) {
+    Token headToken = _tokens.front();
     _tokens.pop();
 
     lowerBody = nodeifyIfElse( _tokens, headToken );
-  } else if ( !_tokens.empty() && _tokens.front()->getText() == "else" ) {
+  } else if ( !_tokens.empty() && _tokens.front().getKeyword() == KeywordId::KeywordElse ) {
     _tokens.pop();
 
     lowerBody = nodeifyGroupedStatements( _tokens );
   }
 
-  node = new ConditionalNode( _token->getPosition(), conditional, upperBody, lowerBody );
+  if ( !conditional || !upperBody ) {
+    return nullptr;
+  }
+
+  node = nodeArena.make<ConditionalNode>( _token.getLocation(), conditional, upperBody, lowerBody );
+
+  return node;
+}
+
+/* while condition { body }, a loop without a condition is dropped the way a conditional without one is */
+Node* nodeifyWhile( TokenStream& _tokens, const Token& _token ) {
+  Node* conditional = nodeify( _tokens );
+
+  if ( !conditional ) {
+    log( Severity::Error, _token.getLocation(), ERR_EXPECTED_CONDITION, std::string( _token.getText() ) );
+  }
+
+  Node* body = nodeifyGroupedStatements( _tokens );
+
+  if ( !conditional || !body ) {
+    return nullptr;
+  }
+
+  return nodeArena.make<WhileNode>( _token.getLocation(), conditional, body );
+}
+
+/* for name in first..last { body }, the bounds stop at the '..' and at the '{' as any expression does */
+Node* nodeifyFor( TokenStream& _tokens, const Token& _token ) {
+  Token variable = _tokens.front();
+
+  if ( variable.getType() != TokenType::TokenVariable ) {
+    log( Severity::Error, variable.getLocation(), ERR_EXPECTED_LOOP_VARIABLE, describeToken( variable ) );
+    return nullptr;
+  }
+
+  _tokens.pop();
+
+  Token in = _tokens.front();
+
+  if ( in.getKeyword() != KeywordId::KeywordIn ) {
+    log( Severity::Error, in.getLocation(), ERR_EXPECTED_IN, describeToken( in ) );
+    return nullptr;
+  }
+
+  _tokens.pop();
+
+  Node* first = nodeifyExpression( _tokens, 1, 0 );
+
+  Token range = _tokens.front();
+
+  if ( range.getOperator() != OperatorId::OperatorRange ) {
+    log( Severity::Error, range.getLocation(), ERR_EXPECTED_RANGE, describeToken( range ) );
+    return nullptr;
+  }
+
+  _tokens.pop();
+
+  Node* last = nodeifyExpression( _tokens, 1, 0 );
+
+  if ( !first || !last ) {
+    log( Severity::Error, range.getLocation(), ERR_MISSING_OPERAND, std::string( range.getText() ) );
+    return nullptr;
+  }
+
+  Node* body = nodeifyGroupedStatements( _tokens );
+
+  if ( !body ) {
+    return nullptr;
+  }
+
+  return nodeArena.make<ForNode>( variable.getSymbol(), _token.getLocation(), first, last, body );
+}
+
+Node* nodeifyImport( TokenStream& _tokens, const Token& _token ) {
+  Token name = _tokens.front();
+  _tokens.pop();
+
+  if ( name.getType() != TokenType::TokenVariable ) {
+    log( Severity::Error, name.getLocation(), ERR_EXPECTED_MODULE_NAME, describeToken( name ) );
+    return nullptr;
+  }
+
+  Token from = _tokens.front();
+  _tokens.pop();
+
+  if ( from.getKeyword() != KeywordId::KeywordFrom ) {
+    log( Severity::Error, from.getLocation(), ERR_EXPECTED_FROM, describeToken( from ) );
+    return nullptr;
+  }
+
+  Token path = _tokens.front();
+  _tokens.pop();
+
+  if ( path.getType() != TokenType::TokenString ) {
+    log( Severity::Error, path.getLocation(), ERR_EXPECTED_MODULE_PATH, describeToken( path ) );
+    return nullptr;
+  }
+
+  std::string_view quotedPath = path.getText();
+  std::string importer = sourceManager.getFile( path.getFileId() )->getFilename();
+
+  return nodeArena.make<ImportNode>(
+    name.getSymbol(), _token.getLocation(), resolveModule( importer, quotedPath.substr( 1, quotedPath.length() - 2 ) )
+  );
+}
+
+/*
+ * name :: type, a binding without an expression; null when the parameter list does not go on, in which case the
+ * token that ends it is left in place
+ */
+Node* nodeifyParameter( TokenStream& _tokens ) {
+  while ( !_tokens.empty() && _tokens.front().getType() == TokenType::TokenNewline ) {
+    _tokens.pop();
+  }
+
+  Token parameter = _tokens.front();
+
+  if ( parameter.getType() != TokenType::TokenVariable ) {
+    log( Severity::Error, parameter.getLocation(), ERR_EXPECTED_PARAMETER_NAME, describeToken( parameter ) );
+    return nullptr;
+  }
+
+  _tokens.pop();
+
+  Token typeDefine = _tokens.front();
+
+  if ( typeDefine.getOperator() != OperatorId::OperatorTypeDefine ) {
+    log( Severity::Error, typeDefine.getLocation(), ERR_EXPECTED_TYPE_DEFINER, describeToken( typeDefine ) );
+    return nullptr;
+  }
+
+  _tokens.pop();
+
+  Token type = _tokens.front();
+
+  if ( type.getType() == TokenType::TokenEnd ) {
+    log( Severity::Error, type.getLocation(), ERR_EXPECTED_TYPE, describeToken( type ) );
+    return nullptr;
+  }
+
+  _tokens.pop();
+
+  return nodeArena.make<BindingNode>(
+    parameter.getSymbol(), parameter.getLocation(), typeSymbol( type ), type.getLocation(), nullptr
+  );
+}
+
+Node* nodeifyFunction( TokenStream& _tokens, const Token& _token ) {
+  std::vector<Node*> parameters;
+  Symbol returnTypeName = NO_SYMBOL;
+  SourceLocation returnTypeLocation = _token.getLocation();
+
+  Token name = _tokens.front();
+  _tokens.pop();
+
+  if ( name.getType() != TokenType::TokenVariable ) {
+    log( Severity::Error, name.getLocation(), ERR_EXPECTED_FUNCTION_NAME, describeToken( name ) );
+    return nullptr;
+  }
+
+  Token openParameters = _tokens.front();
+  _tokens.pop();
+
+  if ( openParameters.getGrouper() != '(' ) {
+    log( Severity::Error, openParameters.getLocation(), ERR_EXPECTED_OPEN_PAREN, describeToken( openParameters ) );
+    return nullptr;
+  }
+
+  while ( !_tokens.empty() && _tokens.front().getGrouper() != ')' ) {
+    Node* parameter = nodeifyParameter( _tokens );
+
+    if ( !parameter ) {
+      skipGroup( _tokens );
+      return nullptr;
+    }
+
+    parameters.push_back( parameter );
+
+    if ( !_tokens.empty() && _tokens.front().getType() == TokenType::TokenComma ) {
+      _tokens.pop();
+    } else if ( !_tokens.empty() && _tokens.front().getGrouper() != ')' ) {
+      Token unexpected = _tokens.front();
+
+      log( Severity::Error, unexpected.getLocation(), ERR_EXPECTED_CLOSE_PAREN, describeToken( unexpected ) );
+      skipGroup( _tokens );
+      return nullptr;
+    }
+  }
+
+  Token closeParameters = _tokens.front();
+
+  if ( closeParameters.getGrouper() != ')' ) {
+    log( Severity::Error, closeParameters.getLocation(), ERR_EXPECTED_CLOSE_PAREN, describeToken( closeParameters ) );
+    return nullptr;
+  }
+
+  _tokens.pop();
+
+  /* a function returning nothing goes straight on to its body */
+  if ( !_tokens.empty() && _tokens.front().getOperator() == OperatorId::OperatorTypeDefine ) {
+    _tokens.pop();
+
+    Token returnType = _tokens.front();
+
+    if ( returnType.getType() == TokenType::TokenEnd ) {
+      log( Severity::Error, returnType.getLocation(), ERR_EXPECTED_TYPE, describeToken( returnType ) );
+      return nullptr;
+    }
+
+    _tokens.pop();
+
+    returnTypeName = typeSymbol( returnType );
+    returnTypeLocation = returnType.getLocation();
+  }
+
+  /* a function missing its body is still declared, so that calls to it are not reported as well */
+  Node* body = nodeifyGroupedStatements( _tokens );
+
+  return nodeArena.make<FunctionNode>(
+    name.getSymbol(), _token.getLocation(), parameters, returnTypeName, returnTypeLocation, body
+  );
+}
+
+/* inline or noinline, annotating the function that follows */
+Node* nodeifyAnnotatedFunction( TokenStream& _tokens, const Token& _token ) {
+  Token function = _tokens.front();
+
+  if ( function.getKeyword() != KeywordId::KeywordFunction ) {
+    log(
+      Severity::Error,
+      function.getLocation(),
+      ERR_EXPECTED_FUNCTION,
+      std::string( _token.getText() ),
+      describeToken( function )
+    );
+    return nullptr;
+  }
+
+  _tokens.pop();
+
+  Node* node = nodeifyFunction( _tokens, function );
+
+  if ( node ) {
+    bool always = _token.getKeyword() == KeywordId::KeywordInline;
+    ( (FunctionNode*) node )->setInlining( always ? Inlining::InlineAlways : Inlining::InlineNever );
+  }
 
   return node;
 }
 
-Node* nodeifyKeyword( std::queue<Token*>& _tokens ) {
+/* a value to return is on the same line as the return */
+Node* nodeifyReturn( TokenStream& _tokens, const Token& _token ) {
+  Node* expression = nullptr;
+
+  if (
+    !_tokens.empty() && _tokens.front().getType() != TokenType::TokenNewline && _tokens.front().getGrouper() != '}'
+  ) {
+    Token head = _tokens.front();
+    expression = nodeifyExpression( _tokens, 1, 0 );
+
+    if ( !expression && !_tokens.empty() && _tokens.front().getOffset() == head.getOffset() ) {
+      log( Severity::Error, head.getLocation(), ERR_UNEXPECTED_TOKEN, describeToken( head ) );
+      _tokens.pop();
+    }
+  }
+
+  return nodeArena.make<ReturnNode>( _token.getLocation(), expression );
+}
+
+Node* nodeifyKeyword( TokenStream& _tokens ) {
   Node* node = nullptr;
 
-  Token* token = _tokens.front();
+  Token token = _tokens.front();
   _tokens.pop();
 
-  if ( token->getText() == "define" ) {
+  if ( token.getKeyword() == KeywordId::KeywordDefine ) {
     node = nodeifyBinding( _tokens );
-  } else if ( token->getText() == "if" ) {
+  } else if ( token.getKeyword() == KeywordId::KeywordIf ) {
     node = nodeifyIfElse( _tokens, token );
+  } else if ( token.getKeyword() == KeywordId::KeywordImport ) {
+    node = nodeifyImport( _tokens, token );
+  } else if ( token.getKeyword() == KeywordId::KeywordFunction ) {
+    node = nodeifyFunction( _tokens, token );
+  } else if ( token.getKeyword() == KeywordId::KeywordReturn ) {
+    node = nodeifyReturn( _tokens, token );
+  } else if (
+    token.getKeyword() == KeywordId::KeywordInline || token.getKeyword() == KeywordId::KeywordNoInline
+  ) {
+    node = nodeifyAnnotatedFunction( _tokens, token );
+  } else if ( token.getKeyword() == KeywordId::KeywordWhile ) {
+    node = nodeifyWhile( _tokens, token );
+  } else if ( token.getKeyword() == KeywordId::KeywordFor ) {
+    node = nodeifyFor( _tokens, token );
   }
 
   return node;
 }
 
-Node* nodeify( std::queue<Token*>& _tokens ) {
+Node* nodeify( TokenStream& _tokens ) {
   if ( _tokens.empty() ) {
     return nullptr;
   }
 
-  Token* head = _tokens.front();
+  Token head = _tokens.front();
 
   Node* node = nullptr;
 
-  switch ( head->getType() ) {
+  switch ( head.getType() ) {
     case TokenType::TokenNewline:
       _tokens.pop();
       node = _tokens.empty() ? nullptr : nodeify( _tokens );
       break;
+    case TokenType::TokenVariable:
+      if ( _tokens.peek( 1 ).getOperator() == OperatorId::OperatorAssign ) {
+        node = nodeifyAssignment( _tokens );
+        break;
+      }
+      /* fall through */
     case TokenType::TokenBoolean:
     case TokenType::TokenConstant:
-    case TokenType::TokenVariable:
     case TokenType::TokenArithmeticGrouper:
-      node = nodeifyArithmetic( _tokens );
+      node = nodeifyExpression( _tokens, 1, 0 );
+
+      if ( !node && !_tokens.empty() && _tokens.front().getOffset() == head.getOffset() ) {
+        log( Severity::Error, head.getLocation(), ERR_UNEXPECTED_TOKEN, describeToken( head ) );
+        _tokens.pop();
+      }
       break;
     case TokenType::TokenKeyword:
       node = nodeifyKeyword( _tokens );
       break;
+    case TokenType::TokenStatementGrouper:
+      if ( head.getGrouper() == '}' ) {
+        /* closing '}' ends the enclosing group */
+        break;
+      }
+      /* fall through */
     default:
+      log( Severity::Error, head.getLocation(), ERR_UNEXPECTED_TOKEN, describeToken( head ) );
+      _tokens.pop();
       break;
   }
 
@@ -331,13 +719,19 @@ Node* nodeify( std::queue<Token*>& _tokens ) {
 }
 
 Node* parse( const std::string _filename ) {
-  std::queue<Token*> tokens = tokenize( _filename );
+  /* tokens are lexed on demand as the parser pulls them, lexing errors surface while parsing */
+  TokenStream tokens( sourceManager.load( _filename ) );
+
+  Node* root = nodeifyStatements( tokens );
+  tokens.dropErrorsPastStop();
+  resolve( root );
 
   if ( !emptyErrorsLog() ) {
+    /* the partial tree is left in the arena, it is freed along with the arena */
     return nullptr;
-  } else {
-    return nodeifyStatements( tokens );
   }
+
+  return root;
 }
 
 #endif
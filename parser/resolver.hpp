@@ -0,0 +1,412 @@
+#ifndef _RESOLVER_HPP
+#define _RESOLVER_HPP
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "parser/classifier.hpp"
+#include "parser/node.hpp"
+#include "shared/environment.hpp"
+#include "shared/errors.hpp"
+#include "shared/symbols.hpp"
+#include "shared/types.hpp"
+
+/* value type of a binary operator applied to the given operand types, undefined where the operator does not apply */
+constexpr ValueType deriveBinaryValue( const OperatorId _operator, const ValueType _left, const ValueType _right ) {
+  switch ( _operator ) {
+    case OperatorId::OperatorAnd:
+    case OperatorId::OperatorOr:
+    case OperatorId::OperatorXor:
+      return _left == ValueType::ValueBoolean && _right == ValueType::ValueBoolean
+        ? ValueType::ValueBoolean : ValueType::ValueUndefined;
+    case OperatorId::OperatorLess:
+    case OperatorId::OperatorGreater:
+    case OperatorId::OperatorLessEqual:
+    case OperatorId::OperatorGreaterEqual:
+    case OperatorId::OperatorEqual:
+    case OperatorId::OperatorNotEqual:
+      return _left == ValueType::ValueConstant && _right == ValueType::ValueConstant
+        ? ValueType::ValueBoolean : ValueType::ValueUndefined;
+    case OperatorId::OperatorAdd:
+    case OperatorId::OperatorSubtract:
+    case OperatorId::OperatorMultiply:
+    case OperatorId::OperatorDivide:
+      return _left == ValueType::ValueConstant && _right == ValueType::ValueConstant
+        ? ValueType::ValueConstant : ValueType::ValueUndefined;
+    default:
+      return ValueType::ValueUndefined;
+  }
+}
+
+/* the function whose body is being resolved, null outside of one */
+static thread_local const FunctionNode* enclosingFunction = nullptr;
+
+void resolve( Node* _node );
+
+void resolve( VariableNode* _node ) {
+  VariableInfo info = getVariable( _node->getSymbol() );
+
+  if ( std::get<0>( info ) == NO_SLOT ) {
+    log( Severity::Error, _node->getLocation(), ERR_UNDEFINED_VARIABLE, std::string( _node->getText() ) );
+    _node->setValueType( ValueType::ValueUndefined );
+    return;
+  }
+
+  _node->setSlot( std::get<0>( info ) );
+  _node->setValueType( std::get<1>( info ) );
+}
+
+void resolve( BindingNode* _node ) {
+  Node* bindingExpression = _node->getBindingExpression();
+
+  resolve( bindingExpression );
+
+  if ( translateToValueType( _node->getTypeName() ) != bindingExpression->getValueType() ) {
+    log(
+      Severity::Error,
+      _node->getTypeLocation(),
+      ERR_BINDING_TYPE_MISMATCH,
+      bindingExpression->getValueType(),
+      std::string( interner.getName( _node->getTypeName() ) )
+    );
+  }
+
+  _node->setSlot( getBaseOffset() );
+  addVariable( _node->getSymbol(), bindingExpression->getValueType() );
+}
+
+void resolve( UnaryOperatorNode* _node ) {
+  resolve( _node->getOperand() );
+  _node->setValueType( _node->getOperand()->getValueType() );
+}
+
+/* up a chain of operators from its innermost, see leftSpine() */
+void resolve( BinaryOperatorNode* _node ) {
+  std::vector<BinaryOperatorNode*> spine = leftSpine( _node );
+
+  resolve( spine.back()->getLeftOperand() );
+
+  for ( size_t index = spine.size(); index > 0; index-- ) {
+    BinaryOperatorNode* node = spine[index - 1];
+
+    resolve( node->getRightOperand() );
+
+    ValueType leftValueType = node->getLeftOperand()->getValueType();
+    ValueType rightValueType = node->getRightOperand()->getValueType();
+    ValueType derivedValueType = deriveBinaryValue( node->getOperator(), leftValueType, rightValueType );
+
+    if ( derivedValueType == ValueType::ValueUndefined ) {
+      log(
+        Severity::Error,
+        node->getLocation(),
+        ERR_BINARY_VALUES_NOT_SUPPORTED,
+        std::string( operatorText( node->getOperator() ) ),
+        leftValueType,
+        rightValueType
+      );
+    }
+
+    node->setValueType( derivedValueType );
+  }
+}
+
+/* a call to a function that returns nothing can only be a statement of its own */
+void checkValue( const Node* _node, const std::string _use ) {
+  if ( _node->getValueType() == ValueType::ValueVoid ) {
+    log( Severity::Error, _node->getLocation(), ERR_VOID_VALUE, _use );
+  }
+}
+
+/* a branch tests the sign bit, which only a boolean's word is meant to be read by */
+void checkCondition( const Node* _condition ) {
+  if ( !_condition ) {
+    return;
+  }
+
+  ValueType found = _condition->getValueType();
+
+  checkValue( _condition, "a condition" );
+
+  if ( found != ValueType::ValueVoid && found != ValueType::ValueUndefined && found != ValueType::ValueBoolean ) {
+    log( Severity::Error, _condition->getLocation(), ERR_CONDITION_TYPE_MISMATCH, found );
+  }
+}
+
+/* each branch is a scope of its own, its bindings are released when the branch ends */
+void resolve( ConditionalNode* _node ) {
+  resolve( _node->getConditional() );
+  checkCondition( _node->getConditional() );
+
+  enterScope();
+  resolve( _node->getUpperBody() );
+  exitScope();
+
+  enterScope();
+  resolve( _node->getLowerBody() );
+  exitScope();
+}
+
+/* a variable of the current frame takes a new value of its own type, the slot is the one its binding took */
+void resolve( AssignmentNode* _node ) {
+  Node* expression = _node->getExpression();
+  VariableInfo info = getVariable( _node->getSymbol() );
+
+  resolve( expression );
+  checkValue( expression, "an assigned value" );
+
+  if ( std::get<0>( info ) == NO_SLOT ) {
+    log( Severity::Error, _node->getLocation(), ERR_UNDEFINED_VARIABLE, std::string( _node->getText() ) );
+    return;
+  }
+
+  ValueType found = expression->getValueType();
+
+  if ( found != ValueType::ValueVoid && found != std::get<1>( info ) ) {
+    log(
+      Severity::Error,
+      expression->getLocation(),
+      ERR_ASSIGNMENT_TYPE_MISMATCH,
+      found,
+      translateFromValueType( std::get<1>( info ) ),
+      std::string( _node->getText() )
+    );
+  }
+
+  _node->setSlot( std::get<0>( info ) );
+}
+
+/* the body of a loop is a scope of its own, as a branch is */
+void resolve( WhileNode* _node ) {
+  resolve( _node->getConditional() );
+
+  checkCondition( _node->getConditional() );
+
+  enterScope();
+  resolve( _node->getBody() );
+  exitScope();
+}
+
+void checkBound( const Node* _bound ) {
+  ValueType found = _bound->getValueType();
+
+  if ( found != ValueType::ValueVoid && found != ValueType::ValueConstant ) {
+    log( Severity::Error, _bound->getLocation(), ERR_RANGE_TYPE_MISMATCH, found );
+  }
+}
+
+/* the bounds are resolved outside the loop, the loop variable is bound in the scope of the body */
+void resolve( ForNode* _node ) {
+  resolve( _node->getFirst() );
+  resolve( _node->getLast() );
+  checkValue( _node->getFirst(), "a range bound" );
+  checkValue( _node->getLast(), "a range bound" );
+  checkBound( _node->getFirst() );
+  checkBound( _node->getLast() );
+
+  enterScope();
+  _node->setSlot( getBaseOffset() );
+  addVariable( _node->getSymbol(), ValueType::ValueConstant );
+  resolve( _node->getBody() );
+  exitScope();
+}
+
+/* a call takes the return type of its function, whose parameters its arguments must match */
+void resolve( FunctionCallNode* _node ) {
+  const FunctionInfo* function = getFunction( _node->getSymbol() );
+  size_t parameter = 0;
+
+  for ( Node* argument : _node->getArguments() ) {
+    resolve( argument );
+    checkValue( argument, "an argument" );
+  }
+
+  if ( !function ) {
+    log( Severity::Error, _node->getLocation(), ERR_UNDEFINED_FUNCTION, std::string( _node->getName() ) );
+    _node->setValueType( ValueType::ValueUndefined );
+    return;
+  }
+
+  if ( function->parameters.size() != _node->getArguments().size() ) {
+    log(
+      Severity::Error,
+      _node->getLocation(),
+      ERR_ARGUMENT_COUNT,
+      std::string( _node->getName() ),
+      std::to_string( function->parameters.size() ),
+      std::to_string( _node->getArguments().size() )
+    );
+  } else {
+    for ( Node* argument : _node->getArguments() ) {
+      ValueType expected = function->parameters[parameter++];
+      ValueType found = argument->getValueType();
+
+      /* an argument without a value is reported as such */
+      if ( expected != ValueType::ValueUndefined && found != ValueType::ValueVoid && found != expected ) {
+        log( Severity::Error, argument->getLocation(), ERR_ARGUMENT_TYPE_MISMATCH, found, expected );
+      }
+    }
+  }
+
+  _node->setValueType( function->returnType );
+}
+
+/* parameter types and return type as written, a type that is not defined is left undefined */
+FunctionInfo functionInfo( const FunctionNode* _node ) {
+  FunctionInfo info = { {}, ValueType::ValueVoid, _node->getRef(), false };
+
+  for ( Node* parameter : _node->getParameters() ) {
+    info.parameters.push_back( translateToValueType( ( (BindingNode*) parameter )->getTypeName() ) );
+  }
+
+  if ( _node->getReturnTypeName() != NO_SYMBOL ) {
+    info.returnType = translateToValueType( _node->getReturnTypeName() );
+  }
+
+  return info;
+}
+
+/* every function defined among _statements, so calls may come before the definition they call */
+void declareFunctions( const MultiStatementNode* _statements ) {
+  for ( Node* statement : _statements->getStatements() ) {
+    if ( statement->getNodeType() == NodeType::NodeFunction && !getFunction( statement->getSymbol() ) ) {
+      addFunction( statement->getSymbol(), functionInfo( (FunctionNode*) statement ) );
+    }
+  }
+}
+
+/* whether running _node always ends in a return, so that nothing after it runs */
+bool alwaysReturns( const Node* _node ) {
+  if ( !_node ) {
+    return false;
+  } else if ( _node->getNodeType() == NodeType::NodeReturn ) {
+    return true;
+  } else if ( _node->getNodeType() == NodeType::NodeMultiStatement ) {
+    for ( Node* statement : ( (MultiStatementNode*) _node )->getStatements() ) {
+      if ( alwaysReturns( statement ) ) return true;
+    }
+  } else if ( _node->getNodeType() == NodeType::NodeConditional ) {
+    return alwaysReturns( ( (ConditionalNode*) _node )->getUpperBody() ) &&
+           alwaysReturns( ( (ConditionalNode*) _node )->getLowerBody() );
+  }
+
+  return false;
+}
+
+void checkType( const Symbol _typeName, const SourceLocation _location ) {
+  if ( translateToValueType( _typeName ) == ValueType::ValueUndefined ) {
+    log( Severity::Error, _location, ERR_UNDEFINED_TYPE, std::string( interner.getName( _typeName ) ) );
+  }
+}
+
+/*
+ * a function's body is resolved in a frame of its own, which sees its parameters and none of the module's bindings;
+ * functions are only defined at the top level, where they were all declared before anything was resolved unless the
+ * statements are resolved one at a time ( see parser/incremental.hpp )
+ */
+void resolve( FunctionNode* _node ) {
+  std::vector<std::tuple<Symbol, ValueType>> parameters;
+  FunctionInfo info = functionInfo( _node );
+  const FunctionInfo* declared = getFunction( _node->getSymbol() );
+  int slot = PARAMETER_BASE_SLOT;
+
+  if ( scopeDepth() > 0 ) {
+    log( Severity::Error, _node->getLocation(), ERR_NESTED_FUNCTION, std::string( _node->getName() ) );
+    return;
+  } else if ( declared && !declared->provisional && declared->definition != _node->getRef() ) {
+    log( Severity::Error, _node->getLocation(), ERR_FUNCTION_REDEFINED, std::string( _node->getName() ) );
+    return;
+  } else if ( !declared || declared->provisional ) {
+    addFunction( _node->getSymbol(), info );
+  }
+
+  for ( Node* parameter : _node->getParameters() ) {
+    BindingNode* binding = (BindingNode*) parameter;
+    ValueType type = translateToValueType( binding->getTypeName() );
+
+    checkType( binding->getTypeName(), binding->getTypeLocation() );
+    binding->setValueType( type );
+    binding->setSlot( slot-- );
+    parameters.push_back( { binding->getSymbol(), type } );
+  }
+
+  if ( _node->getReturnTypeName() != NO_SYMBOL ) {
+    checkType( _node->getReturnTypeName(), _node->getReturnTypeLocation() );
+  }
+
+  _node->setReturnType( info.returnType );
+
+  enclosingFunction = _node;
+  pushStack( parameters );
+  resolve( _node->getBody() );
+  popStack();
+  enclosingFunction = nullptr;
+
+  /* a function without a body has had its missing '{' reported */
+  if ( info.returnType != ValueType::ValueVoid && _node->getBody() && !alwaysReturns( _node->getBody() ) ) {
+    log( Severity::Error, _node->getLocation(), ERR_MISSING_RETURN, std::string( _node->getName() ) );
+  }
+}
+
+void resolve( ReturnNode* _node ) {
+  Node* expression = _node->getExpression();
+
+  resolve( expression );
+
+  if ( !enclosingFunction ) {
+    log( Severity::Error, _node->getLocation(), ERR_RETURN_OUTSIDE_FUNCTION );
+    return;
+  }
+
+  ValueType returned = expression ? expression->getValueType() : ValueType::ValueVoid;
+
+  if ( returned != enclosingFunction->getReturnType() ) {
+    log(
+      Severity::Error,
+      expression ? expression->getLocation() : _node->getLocation(),
+      ERR_RETURN_TYPE_MISMATCH,
+      returned,
+      enclosingFunction->getReturnType()
+    );
+  }
+}
+
+/*
+ * binds every variable to the stack slot of its binding and derives every value type, in one walk over a parsed
+ * tree in source order; the results are kept on the nodes, so nothing is looked up by name after this
+ */
+void resolve( Node* _node ) {
+  if ( !_node ) {
+    return;
+  } else if ( _node->getNodeType() == NodeType::NodeVariable ) {
+    resolve( (VariableNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeBinding ) {
+    resolve( (BindingNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeUnaryOperator ) {
+    resolve( (UnaryOperatorNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeBinaryOperator ) {
+    resolve( (BinaryOperatorNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeMultiStatement ) {
+    if ( scopeDepth() == 0 ) declareFunctions( (MultiStatementNode*) _node );
+
+    for ( Node* statement : ( (MultiStatementNode*) _node )->getStatements() ) {
+      resolve( statement );
+    }
+  } else if ( _node->getNodeType() == NodeType::NodeConditional ) {
+    resolve( (ConditionalNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeFunctionCall ) {
+    resolve( (FunctionCallNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeFunction ) {
+    resolve( (FunctionNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeReturn ) {
+    resolve( (ReturnNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeAssignment ) {
+    resolve( (AssignmentNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeWhile ) {
+    resolve( (WhileNode*) _node );
+  } else if ( _node->getNodeType() == NodeType::NodeFor ) {
+    resolve( (ForNode*) _node );
+  }
+}
+
+#endif
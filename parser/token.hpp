@@ -1,10 +1,15 @@
 #ifndef _TOKEN_HPP
 #define _TOKEN_HPP
 
+#include <cstdint>
 #include <set>
 #include <string>
+#include <string_view>
 
+#include "parser/classifier.hpp"
 #include "shared/position.hpp"
+#include "shared/source.hpp"
+#include "shared/symbols.hpp"
 #include "shared/types.hpp"
 
 const std::set<TokenType> ARITHMETIC_TYPES = {
@@ -15,35 +20,95 @@ const std::set<TokenType> ARITHMETIC_TYPES = {
   TokenType::TokenArithmeticGrouper,
 };
 
+/* a token is a span of a loaded source, its text is looked up through the SourceManager on demand */
 class Token {
   private:
-    std::string text;
     TokenType type;
-    Position position;
+    uint32_t offset;
+    uint32_t length;
+    uint32_t fileId;
+    /* keyword or operator id, or the grouping character itself, classified once by the lexer */
+    uint8_t code;
+    /* decoded value of boolean and constant literals, interned symbol of variables */
+    int64_t value;
 
   public:
-    Token( const std::string _text, const TokenType _type, const Position _position )
-      : text( _text ), type( _type ), position( _position ) {}
+    Token() : type( TokenType::TokenUndefined ), offset( 0 ), length( 0 ), fileId( NO_FILE ), code( 0 ), value( 0 ) {}
 
     Token(
-      const std::string _text,
       const TokenType _type,
-      const unsigned int _line,
-      const unsigned int _column,
-      const std::string _filename
-    ) : text( _text ), type( _type ), position( Position( _line, _column, _filename ) ) {}
+      const uint32_t _offset,
+      const uint32_t _length,
+      const uint32_t _fileId,
+      const uint8_t _code = 0,
+      const int64_t _value = 0
+    ) : type( _type ), offset( _offset ), length( _length ), fileId( _fileId ), code( _code ), value( _value ) {}
 
-    std::string getText() const {
-      return text;
+    std::string_view getText() const {
+      return sourceManager.getText( getLocation(), length );
     }
 
     TokenType getType() const {
       return type;
     }
 
-    Position getPosition() const {
-      return position;
+    uint8_t getCode() const {
+      return code;
+    }
+
+    KeywordId getKeyword() const {
+      return type == TokenType::TokenKeyword ? static_cast<KeywordId>( code ) : KeywordId::KeywordNone;
+    }
+
+    OperatorId getOperator() const {
+      return type == TokenType::TokenOperator ? static_cast<OperatorId>( code ) : OperatorId::OperatorNone;
+    }
+
+    /* '(', ')', '{' or '}' for grouping tokens, 0 otherwise */
+    char getGrouper() const {
+      bool grouper = type == TokenType::TokenArithmeticGrouper || type == TokenType::TokenStatementGrouper;
+      return grouper ? static_cast<char>( code ) : '\0';
+    }
+
+    int64_t getValue() const {
+      return value;
+    }
+
+    /* symbol of a variable or keyword, NO_SYMBOL for any other token */
+    Symbol getSymbol() const {
+      if ( type == TokenType::TokenVariable ) {
+        return static_cast<Symbol>( value );
+      } else if ( type == TokenType::TokenKeyword ) {
+        return KEYWORD_SYMBOLS[code];
+      }
+
+      return NO_SYMBOL;
+    }
+
+    SourceLocation getLocation() const {
+      return SourceLocation( fileId, offset );
+    }
+
+    uint32_t getOffset() const {
+      return offset;
+    }
+
+    uint32_t getLength() const {
+      return length;
+    }
+
+    uint32_t getFileId() const {
+      return fileId;
     }
 };
 
+/* _token as a diagnostic names it, the end of the source has no text to quote */
+std::string describeToken( const Token& _token ) {
+  if ( _token.getType() == TokenType::TokenEnd ) {
+    return "end of file";
+  }
+
+  return "token '" + std::string( _token.getText() ) + "'";
+}
+
 #endif
@@ -0,0 +1,129 @@
+#ifndef _TOKENBUFFER_HPP
+#define _TOKENBUFFER_HPP
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "parser/token.hpp"
+#include "shared/types.hpp"
+
+/*
+ * token store laid out as parallel arrays, a token costs 17 bytes here ( plus 8 per numeric literal, and up to twice
+ * that while the arrays have room left to grow ) where one holding its own position took about 100 ( see
+ * benchmarks/tokenbuffer.cpp ); tokens are rebuilt as lightweight values when read
+ */
+class TokenBuffer {
+  private:
+    std::vector<uint8_t> kinds;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+    std::vector<uint32_t> fileIds;
+    /* keyword or operator id, grouping character, symbol of a variable, or the index into literals of a constant */
+    std::vector<uint32_t> payloads;
+    std::vector<int64_t> literals;
+
+  public:
+    size_t size() const {
+      return kinds.size();
+    }
+
+    bool empty() const {
+      return kinds.empty();
+    }
+
+    void push( const Token& _token ) {
+      kinds.push_back( static_cast<uint8_t>( _token.getType() ) );
+      offsets.push_back( _token.getOffset() );
+      lengths.push_back( _token.getLength() );
+      fileIds.push_back( _token.getFileId() );
+
+      if ( _token.getType() == TokenType::TokenConstant ) {
+        payloads.push_back( static_cast<uint32_t>( literals.size() ) );
+        literals.push_back( _token.getValue() );
+      } else if ( _token.getType() == TokenType::TokenVariable ) {
+        payloads.push_back( _token.getSymbol() );
+      } else {
+        payloads.push_back( _token.getCode() );
+      }
+    }
+
+    Token at( const size_t _index ) const {
+      TokenType type = static_cast<TokenType>( kinds[_index] );
+
+      if ( type == TokenType::TokenConstant ) {
+        return Token( type, offsets[_index], lengths[_index], fileIds[_index], 0, literals[payloads[_index]] );
+      } else if ( type == TokenType::TokenVariable ) {
+        return Token( type, offsets[_index], lengths[_index], fileIds[_index], 0, payloads[_index] );
+      }
+
+      uint8_t code = static_cast<uint8_t>( payloads[_index] );
+      int64_t value = type == TokenType::TokenBoolean && code == KeywordId::KeywordTrue;
+
+      return Token( type, offsets[_index], lengths[_index], fileIds[_index], code, value );
+    }
+
+    TokenType getType( const size_t _index ) const {
+      return static_cast<TokenType>( kinds[_index] );
+    }
+
+    /* drops the first _count tokens */
+    void discard( const size_t _count ) {
+      TokenBuffer remaining;
+
+      for ( size_t index = _count; index < size(); index++ ) {
+        remaining.push( at( index ) );
+      }
+
+      *this = std::move( remaining );
+    }
+
+    /*
+     * replaces _count tokens from _first with the tokens of _replacement, the tokens that follow are moved by _shift;
+     * literals of replaced constants are left behind until the buffer is next rebuilt
+     */
+    void splice( const size_t _first, const size_t _count, const TokenBuffer& _replacement, const int64_t _shift ) {
+      auto position = [ _first ]( auto& _array ) {
+        return _array.begin() + static_cast<std::ptrdiff_t>( _first );
+      };
+      auto erase = [ _count, &position ]( auto& _array ) {
+        _array.erase( position( _array ), position( _array ) + static_cast<std::ptrdiff_t>( _count ) );
+      };
+
+      erase( kinds );
+      erase( offsets );
+      erase( lengths );
+      erase( fileIds );
+      erase( payloads );
+
+      for ( size_t index = _first; index < offsets.size(); index++ ) {
+        offsets[index] = static_cast<uint32_t>( offsets[index] + _shift );
+      }
+
+      std::vector<uint32_t> replacementPayloads = _replacement.payloads;
+
+      for ( size_t index = 0; index < _replacement.size(); index++ ) {
+        if ( _replacement.getType( index ) == TokenType::TokenConstant ) {
+          replacementPayloads[index] += static_cast<uint32_t>( literals.size() );
+        }
+      }
+
+      literals.insert( literals.end(), _replacement.literals.begin(), _replacement.literals.end() );
+      kinds.insert( position( kinds ), _replacement.kinds.begin(), _replacement.kinds.end() );
+      offsets.insert( position( offsets ), _replacement.offsets.begin(), _replacement.offsets.end() );
+      lengths.insert( position( lengths ), _replacement.lengths.begin(), _replacement.lengths.end() );
+      fileIds.insert( position( fileIds ), _replacement.fileIds.begin(), _replacement.fileIds.end() );
+      payloads.insert( position( payloads ), replacementPayloads.begin(), replacementPayloads.end() );
+    }
+
+    void clear() {
+      kinds.clear();
+      offsets.clear();
+      lengths.clear();
+      fileIds.clear();
+      payloads.clear();
+      literals.clear();
+    }
+};
+
+#endif
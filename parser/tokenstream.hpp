@@ -0,0 +1,152 @@
+#ifndef _TOKENSTREAM_HPP
+#define _TOKENSTREAM_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "parser/lexer.hpp"
+#include "parser/token.hpp"
+#include "parser/tokenbuffer.hpp"
+#include "shared/source.hpp"
+
+const size_t LOOKAHEAD_COMPACTION = 64;
+
+/*
+ * lazily lexed tokens, the parser pulls from the front and only the lookahead it has asked for is ever buffered,
+ * so memory stays bounded by the lookahead rather than the size of the source; a stream can also replay a range of
+ * an already lexed TokenBuffer, which is how the incremental parser re-parses single statements
+ */
+class TokenStream {
+  private:
+    Lexer lexer;
+    /* already lexed tokens the stream reads from instead of the lexer, if any */
+    const TokenBuffer* tokens;
+    size_t tokensIndex;
+    TokenBuffer lookahead;
+    /* index of the front token within lookahead */
+    size_t head;
+    bool exhausted;
+    /* the token read past the last one, at the end of the source */
+    Token end;
+    /* whether lexing stopped at an invalid token, and how many errors were logged once the parser read up to it */
+    bool stopped;
+    size_t errorsAtStop;
+
+    bool pull( Token& _token ) {
+      if ( !tokens ) {
+        return lexer.next( _token );
+      } else if ( tokensIndex < tokens->size() ) {
+        _token = tokens->at( tokensIndex++ );
+        return true;
+      }
+
+      return false;
+    }
+
+    /* logs the invalid _token and every invalid token after it, the lexer logs them itself as it lexes them */
+    void drain( Token& _token ) {
+      if ( !tokens ) {
+        while ( lexer.next( _token ) ) {}
+        return;
+      }
+
+      logInvalidToken( _token );
+
+      while ( pull( _token ) ) {
+        if ( _token.getType() == TokenType::TokenUndefined ) logInvalidToken( _token );
+      }
+    }
+
+    /* buffers tokens until _count are available, false if the source runs out first */
+    bool fill( const size_t _count ) {
+      while ( lookahead.size() - head < _count && !exhausted ) {
+        Token token;
+
+        if ( !pull( token ) ) {
+          exhausted = true;
+        } else if ( token.getType() != TokenType::TokenUndefined ) {
+          lookahead.push( token );
+        } else {
+          /* parsing stops at an invalid token, but the rest of the source is still checked */
+          drain( token );
+          exhausted = true;
+          stopped = true;
+        }
+      }
+
+      if ( lookahead.size() - head >= _count ) {
+        return true;
+      }
+
+      if ( stopped && errorsAtStop == SIZE_MAX ) errorsAtStop = countErrors();
+
+      return false;
+    }
+
+  public:
+    TokenStream( const SourceFile* _source ) : TokenStream( _source, nullptr, 0 ) {}
+
+    TokenStream( const SourceFile* _source, const TokenBuffer* _tokens, const size_t _index )
+      : lexer( _source ), tokens( _tokens ), tokensIndex( _index ), head( 0 ), exhausted( false ),
+        end( TokenType::TokenEnd, static_cast<uint32_t>( _source->getContent().length() ), 0, _source->getId() ),
+        stopped( false ), errorsAtStop( SIZE_MAX ) {}
+
+    /* index of the front token within the replayed TokenBuffer */
+    size_t getIndex() const {
+      return tokensIndex - ( lookahead.size() - head );
+    }
+
+    bool empty() {
+      return !fill( 1 );
+    }
+
+    Token front() {
+      return peek( 0 );
+    }
+
+    /* n-th token past the front, the end token past the end of the source */
+    Token peek( const size_t _offset ) {
+      if ( !fill( _offset + 1 ) ) {
+        return end;
+      }
+
+      return lookahead.at( head + _offset );
+    }
+
+    void pop() {
+      if ( !fill( 1 ) ) {
+        return;
+      }
+
+      head++;
+
+      /* consumed tokens are dropped once the lookahead drains, or in bulk if it never does */
+      if ( head == lookahead.size() ) {
+        lookahead.clear();
+        head = 0;
+      } else if ( head >= LOOKAHEAD_COMPACTION ) {
+        lookahead.discard( head );
+        head = 0;
+      }
+    }
+
+    /*
+     * drops the errors logged since the parser read up to an invalid token, what it finds there is the end of the
+     * source and whatever it reports of that only follows from the error the lexer already reported
+     */
+    void dropErrorsPastStop() {
+      if ( errorsAtStop == SIZE_MAX ) {
+        return;
+      }
+
+      std::vector<LogEntry> errors = takeErrors();
+      size_t kept = std::min( errors.size(), errorsAtStop );
+
+      errors.erase( errors.begin() + static_cast<std::ptrdiff_t>( kept ), errors.end() );
+      restoreErrors( errors );
+    }
+};
+
+#endif
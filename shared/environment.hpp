@@ -1,78 +1,303 @@
 #ifndef _ENVIRONMENT_HPP
 #define _ENVIRONMENT_HPP
 
-#include <boost/range/adaptor/reversed.hpp>
+#include <climits>
+#include <cstdint>
 #include <map>
 #include <string>
 #include <tuple>
+#include <utility>
 #include <vector>
 
+#include "shared/symbols.hpp"
 #include "shared/types.hpp"
 #include "shared/utils.hpp"
 
-typedef std::tuple<int, ValueType> VariableInfo;
+/* offset, value type and the rewind generation the binding was declared in */
+typedef std::tuple<int, ValueType, unsigned int> VariableInfo;
 
-static std::vector<std::map<std::string, VariableInfo>> bindings;
+const uint32_t NO_ENTRY = UINT32_MAX;
 
-static std::map<std::string, VariableInfo> currentBindings;
+struct BindingEntry {
+  Symbol symbol;
+  VariableInfo info;
+  /* entry of the same symbol this one shadows */
+  uint32_t shadowed;
+};
+
+/*
+ * every binding in scope, held in one open-addressing table from each symbol to its innermost binding, so a lookup
+ * costs the same however deeply scopes are nested; bindings are appended to a log as they are declared, leaving a
+ * scope truncates the log to where the scope began and points each name it declared back at what it shadowed
+ */
+class BindingTable {
+  private:
+    struct Slot {
+      Symbol symbol;
+      uint32_t entry;
+    };
+
+    /* a power of two in size, kept at most half full; symbols stay as keys once added, unbound or not */
+    std::vector<Slot> slots;
+    size_t keys;
+    std::vector<BindingEntry> entries;
+
+    size_t findSlot( const Symbol _symbol ) const {
+      size_t mask = slots.size() - 1;
+      size_t slot = ( _symbol * 0x9E3779B1u ) & mask;
+
+      while ( slots[slot].symbol != _symbol && slots[slot].symbol != NO_SYMBOL ) {
+        slot = ( slot + 1 ) & mask;
+      }
+
+      return slot;
+    }
+
+    void grow() {
+      std::vector<Slot> previous( std::move( slots ) );
+      slots.assign( previous.size() * 2, { NO_SYMBOL, NO_ENTRY } );
+
+      for ( const Slot& slot : previous ) {
+        if ( slot.symbol != NO_SYMBOL ) slots[findSlot( slot.symbol )] = slot;
+      }
+    }
+
+  public:
+    BindingTable() : slots( 64, { NO_SYMBOL, NO_ENTRY } ), keys( 0 ) {}
+
+    uint32_t lookup( const Symbol _symbol ) const {
+      return slots[findSlot( _symbol )].entry;
+    }
+
+    BindingEntry& at( const uint32_t _entry ) {
+      return entries[_entry];
+    }
+
+    size_t size() const {
+      return entries.size();
+    }
+
+    void bind( const Symbol _symbol, const VariableInfo _info ) {
+      if ( 2 * ( keys + 1 ) > slots.size() ) {
+        grow();
+      }
 
-static std::map<std::string, int> functions = {
-  { "print", 1 },
+      Slot& slot = slots[findSlot( _symbol )];
+
+      if ( slot.symbol == NO_SYMBOL ) {
+        slot.symbol = _symbol;
+        keys++;
+      }
+
+      entries.push_back( { _symbol, _info, slot.entry } );
+      slot.entry = static_cast<uint32_t>( entries.size() - 1 );
+    }
+
+    /* drops every binding past the first _size */
+    void truncate( const size_t _size ) {
+      while ( entries.size() > _size ) {
+        slots[findSlot( entries.back().symbol )].entry = entries.back().shadowed;
+        entries.pop_back();
+      }
+    }
+
+    /* drops every binding _keep rejects, bindings are rebound in their original order */
+    template<typename Predicate>
+    void retain( Predicate _keep ) {
+      std::vector<BindingEntry> previous;
+      previous.swap( entries );
+
+      for ( Slot& slot : slots ) {
+        slot.entry = NO_ENTRY;
+      }
+
+      for ( const BindingEntry& entry : previous ) {
+        if ( _keep( entry ) ) bind( entry.symbol, entry.info );
+      }
+    }
+
+    void clear() {
+      slots.assign( 64, { NO_SYMBOL, NO_ENTRY } );
+      keys = 0;
+      entries.clear();
+    }
 };
 
-static int baseOffset = 6;
+/* where a scope's bindings begin in the table, and the offset and frame to return to once it ends */
+struct Scope {
+  size_t firstEntry;
+  int baseOffset;
+  size_t frameEntry;
+};
 
-void addVariable( const std::string _variable, const ValueType _valueType ) {
-  currentBindings.insert( { _variable, VariableInfo( baseOffset++, _valueType ) } );
-}
+/* parameter types and return type of a function, and the node defining it, UINT32_MAX for an external one */
+struct FunctionInfo {
+  std::vector<ValueType> parameters;
+  ValueType returnType;
+  uint32_t definition;
+  /* declared ahead of its definition being resolved, which replaces it ( see parser/incremental.hpp ) */
+  bool provisional;
 
-VariableInfo getVariable( const std::string _variable ) {
-  if ( currentBindings.find( _variable ) != currentBindings.end() ) {
-    return currentBindings.at( _variable );
+  bool operator==( const FunctionInfo& _other ) const {
+    return parameters == _other.parameters && returnType == _other.returnType &&
+           definition == _other.definition && provisional == _other.provisional;
   }
+};
 
-  for ( std::map<std::string, VariableInfo> binding : boost::adaptors::reverse( bindings ) ) {
-    if ( binding.find( _variable ) != binding.end() ) {
-      return binding.at( _variable );
-    }
+/* a module is parsed and compiled start to finish on one thread, every thread keeps an environment of its own */
+static thread_local BindingTable bindings;
+
+static thread_local std::vector<Scope> scopes;
+
+/* functions the runtime defines, a parameter of undefined type takes a value of any type */
+const std::map<Symbol, FunctionInfo> EXTERNAL_FUNCTION_INFO = {
+  { interner.intern( "print" ), { { ValueType::ValueUndefined }, ValueType::ValueVoid, UINT32_MAX, false } },
+};
+
+static thread_local std::map<Symbol, FunctionInfo> functions = EXTERNAL_FUNCTION_INFO;
+
+/*
+ * slot of the first binding of a frame; slots only tell bindings apart now that lowering keeps values in virtual
+ * registers ( see compiler/lower.hpp ), parameters take the negative ones
+ */
+const int FRAME_BASE_SLOT = 6;
+
+/* slot of a function's first parameter, the others count down from it */
+const int PARAMETER_BASE_SLOT = -3;
+
+/* slot of a variable that is not bound */
+const int NO_SLOT = 0;
+
+static thread_local int baseOffset = FRAME_BASE_SLOT;
+
+/* first binding of the innermost function's frame, a function sees none of the bindings before it */
+static thread_local size_t frameEntry = 0;
+
+/*
+ * the incremental parser ( see parser/incremental.hpp ) rewinds the environment to the statement it re-parses from
+ * rather than rebuilding it; bindings from that offset on stay in place but are hidden until they are declared again
+ * in the current generation, or until the environment is settled
+ */
+static thread_local int rewindOffset = INT_MAX;
+
+static thread_local unsigned int rewindGeneration = 0;
+
+bool visibleVariable( const VariableInfo& _info ) {
+  return std::get<0>( _info ) < rewindOffset || std::get<2>( _info ) == rewindGeneration;
+}
+
+/* forgets every function other than the external ones */
+void resetFunctions() {
+  functions = EXTERNAL_FUNCTION_INFO;
+}
+
+/* forgets every binding and function */
+void resetEnvironment() {
+  bindings.clear();
+  scopes.clear();
+  resetFunctions();
+  baseOffset = FRAME_BASE_SLOT;
+  frameEntry = 0;
+  rewindOffset = INT_MAX;
+}
+
+int getBaseOffset() {
+  return baseOffset;
+}
+
+void rewindEnvironment( const int _offset ) {
+  baseOffset = _offset;
+  rewindOffset = _offset;
+  rewindGeneration++;
+}
+
+/* ends a rewind at _offset, the hidden bindings are either revealed again as they were or dropped */
+void settleEnvironment( const int _offset, const bool _revealHidden ) {
+  if ( !_revealHidden ) {
+    bindings.retain( []( const BindingEntry& _entry ) { return visibleVariable( _entry.info ); } );
   }
 
-  return VariableInfo( 0, ValueType::ValueVoid );;
+  baseOffset = _offset;
+  rewindOffset = INT_MAX;
+}
+
+/* how many scopes the current point is nested in, 0 at the top level of a module */
+size_t scopeDepth() {
+  return scopes.size();
+}
+
+void enterScope() {
+  scopes.push_back( { bindings.size(), baseOffset, frameEntry } );
+}
+
+/* leaves the innermost scope, returning how many stack slots its bindings took */
+int exitScope() {
+  Scope scope = scopes.back();
+  int slots = baseOffset - scope.baseOffset;
+
+  scopes.pop_back();
+  bindings.truncate( scope.firstEntry );
+  baseOffset = scope.baseOffset;
+  frameEntry = scope.frameEntry;
+
+  return slots;
 }
 
-int getVariableOffset( const std::string _variable ) {
-  return std::get<0>( getVariable( _variable ) );
+void addVariable( const Symbol _variable, const ValueType _valueType ) {
+  VariableInfo info( baseOffset++, _valueType, rewindGeneration );
+  uint32_t existing = bindings.lookup( _variable );
+  size_t scopeStart = scopes.empty() ? 0 : scopes.back().firstEntry;
+
+  if ( existing == NO_ENTRY || existing < scopeStart ) {
+    bindings.bind( _variable, info );
+  } else if ( !visibleVariable( bindings.at( existing ).info ) ) {
+    /* declared again in the same scope, the first binding is kept unless a rewind has hidden it */
+    bindings.at( existing ).info = info;
+  }
 }
 
-ValueType getVariableValueType( const std::string _variable ) {
-  return std::get<1>( getVariable( _variable ) );
+VariableInfo getVariable( const Symbol _variable ) {
+  uint32_t entry = bindings.lookup( _variable );
+
+  while ( entry != NO_ENTRY && entry >= frameEntry && !visibleVariable( bindings.at( entry ).info ) ) {
+    entry = bindings.at( entry ).shadowed;
+  }
+
+  /* a binding shadows only older ones, so none past the one outside the frame is inside it either */
+  if ( entry == NO_ENTRY || entry < frameEntry ) {
+    return VariableInfo( NO_SLOT, ValueType::ValueVoid, 0 );
+  }
+
+  return bindings.at( entry ).info;
 }
 
-void pushStack( std::vector<std::tuple<std::string, ValueType>> _parameters ) {
-  int parameterOffset = -3;
-  baseOffset = 6;
-  bindings.push_back( currentBindings );
-  currentBindings.clear();
+/* a function's frame is a scope of its own, its parameters take the slots from PARAMETER_BASE_SLOT down */
+void pushStack( const std::vector<std::tuple<Symbol, ValueType>> _parameters ) {
+  int parameterOffset = PARAMETER_BASE_SLOT;
 
-  for ( std::tuple<std::string, ValueType> parameter : _parameters ) {
-    std::string identifier = std::get<0>( parameter );
-    ValueType valueType = std::get<1>( parameter );
-    currentBindings.insert( { identifier, VariableInfo( parameterOffset--, valueType ) } );
+  enterScope();
+  baseOffset = FRAME_BASE_SLOT;
+  frameEntry = bindings.size();
+
+  for ( const std::tuple<Symbol, ValueType>& parameter : _parameters ) {
+    VariableInfo info( parameterOffset--, std::get<1>( parameter ), rewindGeneration );
+    bindings.bind( std::get<0>( parameter ), info );
   }
 }
 
 void popStack() {
-  currentBindings = bindings.back();
-  bindings.pop_back();
-  baseOffset = currentBindings.size();
+  exitScope();
 }
 
-void addFunction( const std::string _name, const int _argumentCount ) {
-  functions.insert( { _name, _argumentCount } );
+void addFunction( const Symbol _name, const FunctionInfo _info ) {
+  functions[_name] = _info;
 }
 
-int getFunction( const std::string _name ) {
-  return mapping( functions, _name, -1 );
+/* the function named _name, null if there is none */
+const FunctionInfo* getFunction( const Symbol _name ) {
+  auto function = functions.find( _name );
+
+  return function == functions.end() ? nullptr : &function->second;
 }
 
 #endif
@@ -5,8 +5,10 @@
 #include <queue>
 #include <stdarg.h>
 #include <string>
+#include <vector>
 
 #include "shared/position.hpp"
+#include "shared/source.hpp"
 #include "shared/types.hpp"
 
 const std::string
@@ -14,18 +16,64 @@ const std::string
 
 const std::string
   ERR_INVALID_TOKEN = "encountered invalid token '%1%'",
+  ERR_NUMERIC_OVERFLOW = "numeric literal '%1%' does not fit in an integer",
+  ERR_UNEXPECTED_TOKEN = "encountered unexpected %1%",
+  ERR_MISSING_OPERAND = "operator '%1%' is missing an operand",
+  ERR_NESTING_DEPTH = "expression is nested deeper than %1% levels",
+  ERR_EXPECTED_OPEN_BRACE = "expected token '{', instead found %1%",
+  ERR_EXPECTED_CLOSE_BRACE = "expected token '}', instead found %1%",
+
+  /* variable */
+  ERR_UNDEFINED_VARIABLE = "variable '%1%' is not defined",
+  ERR_VOID_VALUE = "expression has no value to use as %1%",
 
   /* binary op */
   ERR_BINARY_VALUES_NOT_SUPPORTED = "operator '%1%' does not support operation on left '%2%' and right '%3%' values",
 
   /* binding */
   ERR_BINDING_TYPE_MISMATCH = "binding expression type '%1%' does not match expected type '%2%'",
-  ERR_EXPECTED_TYPE_DEFINER = "expected token '::', instead found token '%1%'",
-  ERR_EXPECTED_ASSIGN_OP = "expected operator '=', instead found token '%1%'",
+  ERR_EXPECTED_TYPE_DEFINER = "expected token '::', instead found %1%",
+  ERR_EXPECTED_ASSIGN_OP = "expected operator '=', instead found %1%",
+  ERR_EXPECTED_EXPRESSION = "expected an expression bound to '%1%'",
+
+  /* conditional */
+  ERR_EXPECTED_CONDITION = "expected a condition after '%1%'",
+  ERR_CONDITION_TYPE_MISMATCH = "condition type '%1%' does not match type 'boolean'",
+
+  /* assignment */
+  ERR_ASSIGNMENT_TYPE_MISMATCH = "assigned type '%1%' does not match type '%2%' of variable '%3%'",
 
   /* function call */
-  ERR_EXPECTED_OPEN_PAREN = "expected token '(', instead found token '%1%'",
-  ERR_EXPECTED_CLOSE_PAREN = "expected token ')', instead found token '%1%'";
+  ERR_EXPECTED_OPEN_PAREN = "expected token '(', instead found %1%",
+  ERR_EXPECTED_CLOSE_PAREN = "expected token ')', instead found %1%",
+  ERR_UNDEFINED_FUNCTION = "function '%1%' is not defined",
+  ERR_ARGUMENT_COUNT = "function '%1%' takes %2% arguments, instead found %3%",
+  ERR_ARGUMENT_TYPE_MISMATCH = "argument type '%1%' does not match parameter type '%2%'",
+
+  /* function */
+  ERR_EXPECTED_FUNCTION_NAME = "expected a function name, instead found %1%",
+  ERR_EXPECTED_PARAMETER_NAME = "expected a parameter name, instead found %1%",
+  ERR_EXPECTED_TYPE = "expected a type, instead found %1%",
+  ERR_UNDEFINED_TYPE = "type '%1%' is not defined",
+  ERR_FUNCTION_REDEFINED = "function '%1%' is already defined",
+  ERR_NESTED_FUNCTION = "function '%1%' is not defined at the top level of its module",
+  ERR_EXPECTED_FUNCTION = "expected a function after '%1%', instead found %2%",
+  ERR_MISSING_RETURN = "function '%1%' can end without returning a value",
+  ERR_RETURN_OUTSIDE_FUNCTION = "return outside of a function",
+  ERR_RETURN_TYPE_MISMATCH = "returned type '%1%' does not match return type '%2%'",
+
+  /* loop */
+  ERR_EXPECTED_LOOP_VARIABLE = "expected a loop variable, instead found %1%",
+  ERR_EXPECTED_IN = "expected keyword 'in', instead found %1%",
+  ERR_EXPECTED_RANGE = "expected operator '..', instead found %1%",
+  ERR_RANGE_TYPE_MISMATCH = "range bound type '%1%' does not match type 'integer'",
+
+  /* import */
+  ERR_EXPECTED_MODULE_NAME = "expected a module name, instead found %1%",
+  ERR_EXPECTED_FROM = "expected keyword 'from', instead found %1%",
+  ERR_EXPECTED_MODULE_PATH = "expected a quoted module path, instead found %1%",
+  ERR_MODULE_NOT_FOUND = "cannot find module '%1%'",
+  ERR_IMPORT_CYCLE = "importing module '%1%' forms a cycle";
 
 enum Severity {
   Error,
@@ -35,22 +83,32 @@ enum Severity {
 class LogEntry {
   private:
     std::string message;
-    Position position;
+    SourceLocation location;
 
   public:
-    LogEntry( std::string _message, const Position _position )
-      : message( _message ), position( _position ) {}
+    LogEntry( std::string _message, const SourceLocation _location )
+      : message( _message ), location( _location ) {}
+
+    SourceLocation getLocation() const {
+      return location;
+    }
+
+    void setLocation( const SourceLocation _location ) {
+      location = _location;
+    }
 
+    /* the location is only resolved to a line, column and filename here, when the entry is printed */
     std::string getMessage() const {
       boost::format compound( "  %1% :: %2%" );
 
-      return ( compound % position.getPosition() % message ).str();
+      return ( compound % sourceManager.getPosition( location ).getPosition() % message ).str();
     }
 };
 
-static std::queue<LogEntry> warningsLog;
+/* per thread, the errors of a module are taken from the thread that compiled it */
+static thread_local std::queue<LogEntry> warningsLog;
 
-static std::queue<LogEntry> errorsLog;
+static thread_local std::queue<LogEntry> errorsLog;
 
 bool emptyWarningsLog() {
   return warningsLog.empty();
@@ -60,6 +118,28 @@ bool emptyErrorsLog() {
   return errorsLog.empty();
 }
 
+size_t countErrors() {
+  return errorsLog.size();
+}
+
+/* drains the errors logged so far, so they can be kept apart and logged again later */
+std::vector<LogEntry> takeErrors() {
+  std::vector<LogEntry> entries;
+
+  while ( !errorsLog.empty() ) {
+    entries.push_back( errorsLog.front() );
+    errorsLog.pop();
+  }
+
+  return entries;
+}
+
+void restoreErrors( const std::vector<LogEntry>& _entries ) {
+  for ( const LogEntry& entry : _entries ) {
+    errorsLog.push( entry );
+  }
+}
+
 void printWarnings() {
   std::cout << "Kubic encountered the following warnings --" << std::endl;
 
@@ -78,8 +158,8 @@ void printErrors() {
   }
 }
 
-void log( const Severity _severity, const Position _position, const std::string _message ) {
-  LogEntry logEntry( _message, _position );
+void log( const Severity _severity, const SourceLocation _location, const std::string _message ) {
+  LogEntry logEntry( _message, _location );
 
   if ( _severity == Severity::Warning ) {
     warningsLog.push( logEntry );
@@ -88,61 +168,71 @@ void log( const Severity _severity, const Position _position, const std::string
   }
 }
 
-void log( const Severity _severity, const Position _position, boost::format& _compound ) {
-  log( _severity, _position, _compound.str() );
+void log( const Severity _severity, const SourceLocation _location, boost::format& _compound ) {
+  log( _severity, _location, _compound.str() );
 }
 
-void log( const Severity _severity, const Position _position, boost::format& _compound, const std::string _message ) {
-  log( _severity, _position, _compound % _message );
+void log(
+  const Severity _severity,
+  const SourceLocation _location,
+  boost::format& _compound,
+  const std::string _message
+) {
+  log( _severity, _location, _compound % _message );
 }
 
 template<typename... Arguments>
 void log(
   const Severity _severity,
-  const Position _position,
+  const SourceLocation _location,
   boost::format& _compound,
   const std::string _message,
   Arguments... _arguments
 ) {
-  log( _severity, _position, _compound % _message, _arguments... );
+  log( _severity, _location, _compound % _message, _arguments... );
 }
 
 template<typename... Arguments>
 void log(
   const Severity _severity,
-  const Position _position,
+  const SourceLocation _location,
   boost::format& _compound,
   const ValueType _type,
   Arguments... _arguments
 ) {
-  log( _severity, _position, _compound % translateFromValueType( _type ), _arguments... );
+  log( _severity, _location, _compound % translateFromValueType( _type ), _arguments... );
 }
 
 template<typename... Arguments>
 void log(
   const Severity _severity,
-  const Position _position,
+  const SourceLocation _location,
   const std::string _message,
   const std::string _append,
   Arguments... _arguments
 ) {
-  log( _severity, _position, boost::format( _message ) % _append, _arguments... );
+  log( _severity, _location, boost::format( _message ) % _append, _arguments... );
 }
 
 template<typename... Arguments>
 void log(
   const Severity _severity,
-  const Position _position,
+  const SourceLocation _location,
   const std::string _message,
   const ValueType _type,
   Arguments... _arguments
 ) {
-  log( _severity, _position, boost::format( _message ) % translateFromValueType( _type ), _arguments... );
+  log( _severity, _location, boost::format( _message ) % translateFromValueType( _type ), _arguments... );
 }
 
 template<typename... Arguments>
-void log( const Severity _severity, const Position _position, const std::string _message, Arguments... _arguments ) {
-  log( _severity, _position, boost::format( _message ), _arguments... );
+void log(
+  const Severity _severity,
+  const SourceLocation _location,
+  const std::string _message,
+  Arguments... _arguments
+) {
+  log( _severity, _location, boost::format( _message ), _arguments... );
 }
 
 #endif
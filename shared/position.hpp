@@ -2,16 +2,46 @@
 #define _POSITION_HPP
 
 #include <boost/format.hpp>
+#include <cstdint>
 #include <string>
+#include <string_view>
 
+/* sentinel file id of locations that do not come from a source, such as the end of input */
+const uint32_t NO_FILE = UINT32_MAX;
+
+/* compact location carried by tokens, nodes and log entries, resolved through the SourceManager when printed */
+class SourceLocation {
+  private:
+    uint32_t fileId;
+    uint32_t offset;
+
+  public:
+    SourceLocation() : fileId( NO_FILE ), offset( 0 ) {}
+
+    SourceLocation( const uint32_t _fileId, const uint32_t _offset ) : fileId( _fileId ), offset( _offset ) {}
+
+    uint32_t getFileId() const {
+      return fileId;
+    }
+
+    uint32_t getOffset() const {
+      return offset;
+    }
+
+    bool isValid() const {
+      return fileId != NO_FILE;
+    }
+};
+
+/* resolved line and column of a location, only built for diagnostics */
 class Position {
   private:
     unsigned int line;
     unsigned int column;
-    std::string filename;
+    std::string_view filename;
 
   public:
-    Position( const unsigned int _line, const unsigned _column, const std::string _filename )
+    Position( const unsigned int _line, const unsigned _column, const std::string_view _filename )
       : line( _line ), column( _column ), filename( _filename ) {}
 
     unsigned int getLine() const {
@@ -22,7 +52,7 @@ class Position {
       return column;
     }
 
-    std::string getFilename() const {
+    std::string_view getFilename() const {
       return filename;
     }
 
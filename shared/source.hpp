@@ -0,0 +1,251 @@
+#ifndef _SOURCE_HPP
+#define _SOURCE_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "shared/position.hpp"
+
+class SourceFile {
+  private:
+    uint32_t id;
+    std::string filename;
+    /* mapped view of the file, when the file could be mapped */
+    void* mapping;
+    size_t mappingLength;
+    /* fallback copy for sources that cannot be mapped ( pipes, special files ) */
+    std::string buffer;
+    std::string_view content;
+    /* offset of the first character of every line, built the first time a position is resolved */
+    mutable std::vector<uint32_t> lineOffsets;
+
+    bool map() {
+      int descriptor = open( filename.c_str(), O_RDONLY );
+
+      if ( descriptor < 0 ) {
+        return false;
+      }
+
+      struct stat status;
+
+      if ( fstat( descriptor, &status ) != 0 || !S_ISREG( status.st_mode ) ) {
+        close( descriptor );
+        return false;
+      }
+
+      mappingLength = static_cast<size_t>( status.st_size );
+
+      if ( mappingLength == 0 ) {
+        /* empty files cannot be mapped, but are trivially lexed */
+        close( descriptor );
+        content = std::string_view();
+        return true;
+      }
+
+      mapping = mmap( nullptr, mappingLength, PROT_READ, MAP_PRIVATE, descriptor, 0 );
+      close( descriptor );
+
+      if ( mapping == MAP_FAILED ) {
+        mapping = nullptr;
+        mappingLength = 0;
+        return false;
+      }
+
+      /* the lexer walks the file front to back exactly once */
+      madvise( mapping, mappingLength, MADV_SEQUENTIAL );
+      content = std::string_view( static_cast<const char*>( mapping ), mappingLength );
+
+      return true;
+    }
+
+    void indexLines() const {
+      const char* cursor = content.data();
+      const char* end = cursor + content.length();
+
+      lineOffsets.push_back( 0 );
+
+      while ( cursor < end ) {
+        const void* newline = memchr( cursor, '\n', static_cast<size_t>( end - cursor ) );
+
+        if ( !newline ) {
+          break;
+        }
+
+        cursor = static_cast<const char*>( newline ) + 1;
+        lineOffsets.push_back( static_cast<uint32_t>( cursor - content.data() ) );
+      }
+    }
+
+    void read() {
+      std::ifstream file( filename, std::ios::binary );
+      buffer.assign( ( std::istreambuf_iterator<char>( file ) ), ( std::istreambuf_iterator<char>() ) );
+      content = std::string_view( buffer );
+    }
+
+  public:
+    SourceFile( const uint32_t _id, const std::string _filename )
+      : id( _id ), filename( _filename ), mapping( nullptr ), mappingLength( 0 ) {
+      if ( !map() ) {
+        read();
+      }
+    }
+
+    SourceFile( const SourceFile& ) = delete;
+
+    SourceFile& operator=( const SourceFile& ) = delete;
+
+    ~SourceFile() {
+      if ( mapping ) munmap( mapping, mappingLength );
+    }
+
+    uint32_t getId() const {
+      return id;
+    }
+
+    std::string getFilename() const {
+      return filename;
+    }
+
+    std::string_view getContent() const {
+      return content;
+    }
+
+    bool isMapped() const {
+      return mapping != nullptr;
+    }
+
+    std::string_view getText( const uint32_t _offset, const uint32_t _length ) const {
+      return content.substr( _offset, _length );
+    }
+
+    /* switches a mapped source over to an owned copy, so the file can change on disk underneath it */
+    void detach() {
+      if ( content.data() != buffer.data() ) {
+        buffer.assign( content );
+        content = std::string_view( buffer );
+      }
+
+      if ( mapping ) {
+        munmap( mapping, mappingLength );
+        mapping = nullptr;
+        mappingLength = 0;
+      }
+    }
+
+    /* views handed out before an edit are invalidated */
+    void replace( const uint32_t _offset, const uint32_t _length, const std::string_view _replacement ) {
+      detach();
+      buffer.replace( _offset, _length, _replacement );
+      content = std::string_view( buffer );
+      lineOffsets.clear();
+    }
+
+    /* line and column of an offset, looked up in the line table */
+    Position getPosition( const uint32_t _offset ) const {
+      if ( lineOffsets.empty() ) {
+        indexLines();
+      }
+
+      auto lineStart = std::upper_bound( lineOffsets.begin(), lineOffsets.end(), _offset ) - 1;
+      unsigned int line = static_cast<unsigned int>( lineStart - lineOffsets.begin() ) + 1;
+
+      return Position( line, _offset - *lineStart + 1, filename );
+    }
+};
+
+/* files are kept in segments of 2^10, at most 2^10 segments */
+const uint32_t SOURCE_SEGMENT_BITS = 10;
+
+const uint32_t SOURCE_SEGMENT_FILES = 1u << SOURCE_SEGMENT_BITS;
+
+/*
+ * owns every loaded source for the whole run, so token and node text can view into them; files are interned by
+ * name and handed out as small ids that locations refer to
+ *
+ * modules are loaded from several threads at once, loading is serialized but segments never move once allocated,
+ * so resolving an id handed out earlier takes no lock
+ */
+class SourceManager {
+  private:
+    std::array<std::unique_ptr<std::unique_ptr<SourceFile>[]>, SOURCE_SEGMENT_FILES> segments;
+    uint32_t fileCount;
+    std::map<std::string, uint32_t> fileIds;
+    std::mutex loading;
+
+    SourceFile* at( const uint32_t _fileId ) const {
+      return segments[_fileId >> SOURCE_SEGMENT_BITS][_fileId & ( SOURCE_SEGMENT_FILES - 1 )].get();
+    }
+
+  public:
+    SourceManager() : fileCount( 0 ) {}
+
+    const SourceFile* load( const std::string _filename ) {
+      std::lock_guard<std::mutex> lock( loading );
+      auto loaded = fileIds.find( _filename );
+
+      if ( loaded != fileIds.end() ) {
+        return getFile( loaded->second );
+      }
+
+      uint32_t id = fileCount++;
+      std::unique_ptr<std::unique_ptr<SourceFile>[]>& segment = segments.at( id >> SOURCE_SEGMENT_BITS );
+
+      if ( !segment ) {
+        segment.reset( new std::unique_ptr<SourceFile>[SOURCE_SEGMENT_FILES] );
+      }
+
+      segment[id & ( SOURCE_SEGMENT_FILES - 1 )] = std::make_unique<SourceFile>( id, _filename );
+      fileIds.insert( { _filename, id } );
+
+      return getFile( id );
+    }
+
+    const SourceFile* getFile( const uint32_t _fileId ) const {
+      return at( _fileId );
+    }
+
+    void edit( const uint32_t _fileId, const uint32_t _offset, const uint32_t _length, const std::string_view _text ) {
+      at( _fileId )->replace( _offset, _length, _text );
+    }
+
+    std::string_view getText( const SourceLocation _location, const uint32_t _length ) const {
+      if ( !_location.isValid() ) {
+        return std::string_view();
+      }
+
+      return getFile( _location.getFileId() )->getText( _location.getOffset(), _length );
+    }
+
+    Position getPosition( const SourceLocation _location ) const {
+      if ( !_location.isValid() ) {
+        return Position( 0, 0, "" );
+      }
+
+      return getFile( _location.getFileId() )->getPosition( _location.getOffset() );
+    }
+};
+
+static SourceManager sourceManager;
+
+/* an imported module is the .kbc file at its path relative to the importing file */
+std::string resolveModule( const std::string _importer, const std::string_view _path ) {
+  std::filesystem::path importer( _importer );
+
+  return ( importer.parent_path() / ( std::string( _path ) + ".kbc" ) ).lexically_normal().string();
+}
+
+#endif
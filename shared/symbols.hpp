@@ -0,0 +1,67 @@
+#ifndef _SYMBOLS_HPP
+#define _SYMBOLS_HPP
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/* a distinct name, names are compared and hashed by their symbol once interned */
+typedef uint32_t Symbol;
+
+const Symbol NO_SYMBOL = UINT32_MAX;
+
+/*
+ * every name of the run is interned once, as the lexer first meets it, and keeps its symbol for the whole run;
+ * modules are lexed on several threads at once, a name seen before is looked up under a shared lock and only a new
+ * name takes the lock exclusively
+ */
+class Interner {
+  private:
+    /* names never move once interned, the map keys view into them */
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, Symbol> symbols;
+    mutable std::shared_mutex guard;
+
+  public:
+    Symbol intern( const std::string_view _name ) {
+      {
+        std::shared_lock<std::shared_mutex> lock( guard );
+        auto interned = symbols.find( _name );
+
+        if ( interned != symbols.end() ) {
+          return interned->second;
+        }
+      }
+
+      std::unique_lock<std::shared_mutex> lock( guard );
+      auto interned = symbols.find( _name );
+
+      /* another thread may have interned the name since the shared lock was released */
+      if ( interned != symbols.end() ) {
+        return interned->second;
+      }
+
+      Symbol symbol = static_cast<Symbol>( names.size() );
+      names.emplace_back( _name );
+      symbols.insert( { std::string_view( names.back() ), symbol } );
+
+      return symbol;
+    }
+
+    std::string_view getName( const Symbol _symbol ) const {
+      if ( _symbol == NO_SYMBOL ) {
+        return std::string_view();
+      }
+
+      std::shared_lock<std::shared_mutex> lock( guard );
+      return names[_symbol];
+    }
+};
+
+static Interner interner;
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef _THREADPOOL_HPP
+#define _THREADPOOL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::function<void()> Task;
+
+/*
+ * work-stealing pool, every worker runs its own tasks newest first and steals the oldest task of another worker once
+ * it runs dry; tasks submitted from inside a task go to the submitting worker, so a task's follow-up work stays on
+ * its thread unless another thread is idle
+ */
+class ThreadPool {
+  private:
+    struct Worker {
+      std::deque<Task> tasks;
+      std::mutex lock;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    /* guards the counts below, idle workers and wait() sleep on it */
+    std::mutex state;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    size_t queued;
+    size_t pending;
+    size_t nextWorker;
+    bool stopping;
+
+    /* index of the worker running on this thread, past the last worker on threads outside any pool */
+    static inline thread_local size_t workerIndex = SIZE_MAX;
+
+    static inline thread_local const ThreadPool* workerPool = nullptr;
+
+    bool take( const size_t _index, Task& _task ) {
+      for ( size_t offset = 0; offset < workers.size(); offset++ ) {
+        Worker& worker = *workers[( _index + offset ) % workers.size()];
+        std::lock_guard<std::mutex> lock( worker.lock );
+
+        if ( worker.tasks.empty() ) {
+          continue;
+        }
+
+        if ( offset == 0 ) {
+          _task = std::move( worker.tasks.back() );
+          worker.tasks.pop_back();
+        } else {
+          _task = std::move( worker.tasks.front() );
+          worker.tasks.pop_front();
+        }
+
+        return true;
+      }
+
+      return false;
+    }
+
+    void run( const size_t _index ) {
+      workerIndex = _index;
+      workerPool = this;
+
+      while ( true ) {
+        {
+          std::unique_lock<std::mutex> lock( state );
+          wake.wait( lock, [ this ] { return stopping || queued > 0; } );
+
+          if ( queued == 0 ) {
+            return;
+          }
+
+          queued--;
+        }
+
+        /* a task is queued for every count taken, though another worker may have run it off this one's deque */
+        Task task;
+
+        while ( !take( _index, task ) ) {
+          std::this_thread::yield();
+        }
+
+        task();
+
+        std::lock_guard<std::mutex> lock( state );
+
+        if ( --pending == 0 ) {
+          finished.notify_all();
+        }
+      }
+    }
+
+  public:
+    ThreadPool( const size_t _threads )
+      : queued( 0 ), pending( 0 ), nextWorker( 0 ), stopping( false ) {
+      size_t threadCount = std::max( _threads, static_cast<size_t>( 1 ) );
+
+      for ( size_t index = 0; index < threadCount; index++ ) {
+        workers.push_back( std::make_unique<Worker>() );
+      }
+
+      for ( size_t index = 0; index < threadCount; index++ ) {
+        threads.emplace_back( &ThreadPool::run, this, index );
+      }
+    }
+
+    ThreadPool( const ThreadPool& ) = delete;
+
+    ThreadPool& operator=( const ThreadPool& ) = delete;
+
+    ~ThreadPool() {
+      {
+        std::lock_guard<std::mutex> lock( state );
+        stopping = true;
+      }
+
+      wake.notify_all();
+
+      for ( std::thread& thread : threads ) {
+        thread.join();
+      }
+    }
+
+    void submit( Task _task ) {
+      size_t index;
+
+      {
+        std::lock_guard<std::mutex> lock( state );
+        index = workerPool == this ? workerIndex : nextWorker++ % workers.size();
+        pending++;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock( workers[index]->lock );
+        workers[index]->tasks.push_back( std::move( _task ) );
+      }
+
+      {
+        std::lock_guard<std::mutex> lock( state );
+        queued++;
+      }
+
+      wake.notify_one();
+    }
+
+    /* blocks until every submitted task has run, including the tasks they submitted */
+    void wait() {
+      std::unique_lock<std::mutex> lock( state );
+      finished.wait( lock, [ this ] { return pending == 0; } );
+    }
+};
+
+#endif
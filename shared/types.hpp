@@ -4,6 +4,8 @@
 #include <map>
 #include <string>
 
+#include "shared/symbols.hpp"
+
 enum TokenType {
   TokenUndefined,
   TokenComma,
@@ -15,6 +17,52 @@ enum TokenType {
   TokenOperator,
   TokenArithmeticGrouper,
   TokenStatementGrouper,
+  TokenString,
+  /* what a token stream reads past its last token, with no text and at the end of the source */
+  TokenEnd,
+};
+
+enum KeywordId {
+  KeywordNone,
+  KeywordBoolean,
+  KeywordInteger,
+  KeywordDefine,
+  KeywordIf,
+  KeywordElif,
+  KeywordElse,
+  KeywordTrue,
+  KeywordFalse,
+  KeywordImport,
+  KeywordFrom,
+  KeywordFunction,
+  KeywordReturn,
+  KeywordInline,
+  KeywordNoInline,
+  KeywordFor,
+  KeywordIn,
+  KeywordWhile,
+};
+
+enum OperatorId {
+  OperatorNone,
+  OperatorTypeDefine,
+  OperatorAssign,
+  OperatorAdd,
+  OperatorSubtract,
+  OperatorMultiply,
+  OperatorDivide,
+  OperatorModulo,
+  OperatorLess,
+  OperatorGreater,
+  OperatorLessEqual,
+  OperatorGreaterEqual,
+  OperatorEqual,
+  OperatorNotEqual,
+  OperatorAnd,
+  OperatorOr,
+  OperatorXor,
+  OperatorNot,
+  OperatorRange,
 };
 
 enum NodeType {
@@ -28,6 +76,12 @@ enum NodeType {
   NodeMultiStatement,
   NodeConditional,
   NodeFunctionCall,
+  NodeImport,
+  NodeFunction,
+  NodeReturn,
+  NodeAssignment,
+  NodeWhile,
+  NodeFor,
 };
 
 enum ValueType {
@@ -37,17 +91,26 @@ enum ValueType {
   ValueConstant,
 };
 
-std::map<std::string, ValueType> VALUE_TYPE_NAME = {
-  { "boolean", ValueType::ValueBoolean },
-  { "integer", ValueType::ValueConstant },
+/* whether calls to a function are inlined ( see compiler/inline.hpp ), as its definition is annotated */
+enum Inlining {
+  InlineByCost,
+  InlineAlways,
+  InlineNever,
+};
+
+std::map<Symbol, ValueType> VALUE_TYPE_NAME = {
+  { interner.intern( "boolean" ), ValueType::ValueBoolean },
+  { interner.intern( "integer" ), ValueType::ValueConstant },
 };
 
-ValueType translateToValueType( const std::string _type ) {
-  if ( VALUE_TYPE_NAME.find( _type ) == VALUE_TYPE_NAME.end() ) {
+ValueType translateToValueType( const Symbol _type ) {
+  auto valueType = VALUE_TYPE_NAME.find( _type );
+
+  if ( valueType == VALUE_TYPE_NAME.end() ) {
     return ValueType::ValueUndefined;
   }
 
-  return VALUE_TYPE_NAME.at( _type );
+  return valueType->second;
 }
 
 std::string translateFromValueType( const ValueType _type ) {
@@ -0,0 +1,239 @@
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "compiler/compiler.hpp"
+
+/*
+ * strength reduction ( see compiler/strength.hpp ) checked by running what compileMultiply and compileDivide emit
+ * on a small model of the few x86 instructions they use, against the product and quotient of the integers the
+ * words stand for; every result must be a word again, with its tag bit clear
+ */
+
+const int64_t WORD_MIN = INT64_MIN / 2;
+const int64_t WORD_MAX = INT64_MAX / 2;
+
+/* registers and stack slots, by the operand naming them */
+struct Machine {
+  std::map<std::string, int64_t> locations;
+  std::vector<int64_t> stack;
+
+  static std::string location( const std::string& _operand ) {
+    return _operand.compare( 0, 6, "qword " ) == 0 ? _operand.substr( 6 ) : _operand;
+  }
+
+  int64_t read( const std::string& _operand ) {
+    std::string name = location( _operand );
+
+    if ( name[0] == '-' || isdigit( name[0] ) ) return std::stoll( name );
+
+    return locations[name];
+  }
+
+  void write( const std::string& _operand, const int64_t _value ) {
+    locations[location( _operand )] = _value;
+  }
+
+  /* an address of the form lea takes here, [base + index * scale] */
+  int64_t address( const std::string& _operand ) {
+    std::string inner = _operand.substr( 1, _operand.size() - 2 );
+    size_t plus = inner.find( " + " );
+    size_t times = inner.find( " * " );
+
+    return static_cast<int64_t>(
+      static_cast<uint64_t>( read( inner.substr( 0, plus ) ) ) +
+      static_cast<uint64_t>( read( inner.substr( plus + 3, times - plus - 3 ) ) ) *
+        static_cast<uint64_t>( std::stoll( inner.substr( times + 3 ) ) )
+    );
+  }
+
+  /* false for anything the model does not know */
+  bool run( const AsmCode& _code ) {
+    for ( const AsmInstruction& instruction : _code ) {
+      const std::string& mnemonic = instruction.mnemonic;
+      const std::string& target = instruction.destination;
+      uint64_t destination = static_cast<uint64_t>( target.empty() ? 0 : read( target ) );
+      uint64_t source = static_cast<uint64_t>( instruction.source.empty() ? 0 : read( instruction.source ) );
+      uint64_t result;
+
+      if ( mnemonic == "mov" ) {
+        result = source;
+      } else if ( mnemonic == "push" ) {
+        stack.push_back( read( instruction.destination ) );
+        continue;
+      } else if ( mnemonic == "pop" ) {
+        write( instruction.destination, stack.back() );
+        stack.pop_back();
+        continue;
+      } else if ( mnemonic == "lea" ) {
+        result = static_cast<uint64_t>( address( instruction.source ) );
+      } else if ( mnemonic == "add" ) {
+        result = destination + source;
+      } else if ( mnemonic == "sub" ) {
+        result = destination - source;
+      } else if ( mnemonic == "neg" ) {
+        result = 0 - destination;
+      } else if ( mnemonic == "shl" ) {
+        result = destination << source;
+      } else if ( mnemonic == "shr" ) {
+        result = destination >> source;
+      } else if ( mnemonic == "sar" ) {
+        result = static_cast<uint64_t>( static_cast<int64_t>( destination ) >> source );
+      } else if ( mnemonic == "cqo" ) {
+        write( "rdx", read( "rax" ) < 0 ? -1 : 0 );
+        continue;
+      } else if ( mnemonic == "idiv" ) {
+        __int128 dividend = static_cast<__int128>( static_cast<unsigned __int128>( read( "rdx" ) ) << 64 ) |
+                            static_cast<uint64_t>( read( "rax" ) );
+        int64_t divisor = static_cast<int64_t>( destination );
+
+        write( "rax", static_cast<int64_t>( dividend / divisor ) );
+        write( "rdx", static_cast<int64_t>( dividend % divisor ) );
+        continue;
+      } else if ( mnemonic == "imul" && instruction.source.empty() ) {
+        __int128 product = static_cast<__int128>( read( "rax" ) ) * static_cast<int64_t>( destination );
+
+        write( "rax", static_cast<int64_t>( product ) );
+        write( "rdx", static_cast<int64_t>( product >> 64 ) );
+        continue;
+      } else if ( mnemonic == "imul" ) {
+        result = source * static_cast<uint64_t>( read( instruction.immediate ) );
+      } else {
+        std::cerr << "unknown instruction '" << mnemonic << "'" << std::endl;
+        return false;
+      }
+
+      write( instruction.destination, static_cast<int64_t>( result ) );
+    }
+
+    return true;
+  }
+};
+
+int64_t word( const int64_t _value ) {
+  return static_cast<int64_t>( static_cast<uint64_t>( _value ) << 1 );
+}
+
+/* where an operand is kept, in a register and spilled */
+const std::vector<std::string> LOCATIONS = { "rcx", "[rbp - 8]" };
+
+unsigned int failures = 0;
+unsigned int checks = 0;
+
+void check( const bool _passed, const std::string& _operation, const int64_t _left, const int64_t _right ) {
+  checks++;
+
+  if ( !_passed ) {
+    failures++;
+    std::cerr << "failed: " << _left << " " << _operation << " " << _right << std::endl;
+  }
+}
+
+void checkMultiply( const int64_t _value, const int64_t _multiplier ) {
+  for ( const std::string& source : LOCATIONS ) {
+    Machine machine;
+    AsmCode code;
+
+    machine.write( source, word( _value ) );
+    compileMultiply( code, "rsi", source, _multiplier );
+
+    bool ran = machine.run( code );
+    int64_t product = machine.read( "rsi" );
+    /* wraps around as imul does */
+    int64_t expected = static_cast<int64_t>( static_cast<uint64_t>( _value ) * static_cast<uint64_t>( _multiplier ) );
+
+    check( ran && product == word( expected ) && ( product & 1 ) == 0, "*", _value, _multiplier );
+  }
+}
+
+void checkDivide( const int64_t _dividend, const int64_t _divisor ) {
+  /* the one quotient a word cannot hold, wrapping around as in idiv */
+  int64_t expected = _dividend == WORD_MIN && _divisor == -1 ? INT64_MIN : word( _dividend / _divisor );
+
+  for ( const std::string& dividend : LOCATIONS ) {
+    Machine reduced;
+    Machine divided;
+    AsmCode reducedCode;
+    AsmCode dividedCode;
+
+    reduced.write( dividend, word( _dividend ) );
+    divided.write( dividend, word( _dividend ) );
+    divided.write( "rbx", word( _divisor ) );
+
+    std::string quotient = compileDivide( reducedCode, dividend, word( _divisor ) );
+    std::string divisionQuotient = compileDivide( dividedCode, dividend, "rbx" );
+    bool ran = reduced.run( reducedCode ) && divided.run( dividedCode );
+
+    check(
+      ran && reduced.read( quotient ) == expected && divided.read( divisionQuotient ) == expected &&
+        ( expected & 1 ) == 0,
+      "/",
+      _dividend,
+      _divisor
+    );
+  }
+}
+
+int main() {
+  std::mt19937_64 random( 20 );
+  std::uniform_int_distribution<int64_t> anyWord( WORD_MIN, WORD_MAX );
+  std::vector<int64_t> divisors = { 3, 5, 6, 7, 9, 10, 11, 12, 25, 100, 125, 641, 1000, 1000000007, 6700417 };
+  std::vector<int64_t> values = { 0, 1, -1, 2, -2, 7, -7, WORD_MIN, WORD_MIN + 1, WORD_MAX, WORD_MAX - 1 };
+
+  /* every power of two, and one either side of it, a word holds */
+  for ( int exponent = 0; exponent < 62; exponent++ ) {
+    int64_t power = static_cast<int64_t>( 1 ) << exponent;
+
+    divisors.insert( divisors.end(), { power, power + 1, power - 1 } );
+  }
+
+  divisors.insert( divisors.end(), { WORD_MAX, WORD_MAX - 1, WORD_MIN, WORD_MIN + 1, WORD_MIN / 3 } );
+
+  for ( size_t index = 0; index < 60; index++ ) {
+    divisors.push_back( anyWord( random ) >> ( random() % 62 ) );
+  }
+
+  for ( size_t index = 0; index < 40; index++ ) {
+    values.push_back( anyWord( random ) );
+    values.push_back( anyWord( random ) >> ( random() % 62 ) );
+  }
+
+  for ( int64_t divisor : std::vector<int64_t>( divisors ) ) {
+    if ( divisor != WORD_MIN ) divisors.push_back( -divisor );
+  }
+
+  for ( int64_t divisor : divisors ) {
+    if ( divisor == 0 ) continue;
+
+    /* dividends around each multiple of the divisor, where the quotient changes */
+    std::vector<int64_t> dividends = values;
+
+    for ( int64_t times : { 1, 2, -3 } ) {
+      if ( magnitude( divisor ) > static_cast<uint64_t>( WORD_MAX / 4 ) ) break;
+
+      int64_t multiple = divisor * times;
+
+      dividends.insert( dividends.end(), { multiple - 1, multiple, multiple + 1 } );
+    }
+
+    for ( int64_t dividend : dividends ) {
+      checkDivide( dividend, divisor );
+    }
+  }
+
+  for ( int64_t multiplier : divisors ) {
+    for ( int64_t value : values ) {
+      checkMultiply( value, multiplier );
+    }
+  }
+
+  checkMultiply( WORD_MAX, 0 );
+  checkMultiply( WORD_MIN, -1 );
+
+  std::cout << checks - failures << " of " << checks << " checks passed" << std::endl;
+
+  return failures == 0 ? 0 : 1;
+}